@@ -0,0 +1,322 @@
+// Visco Correct Desktop - Correction factors for centrifugal pumps
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Visco-Correct-Desktop>
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <array>
+#include <random>
+#include <span>
+#include <thread>
+
+#include "benchmark_data.h"
+#include "spauly/vccore/calculator.h"
+#include "spauly/visco/batch/batch_engine.h"
+#include "spauly/visco/batch/result_index.h"
+#include "spauly/visco/batch/reverse_solver.h"
+#include "spauly/visco/batch/soa_batch.h"
+
+namespace spauly {
+namespace visco {
+namespace benchmarks {
+
+namespace {
+
+constexpr std::size_t kBatchSize = 1 << 20;
+
+/// @brief Column copy of the envelope in l/min and cP, so that the unit
+/// normalisation is part of every batch measurement.
+struct ColumnData {
+  ColumnData() : units(MakeUnits(1, 0, 2)) {
+    params = InUnits(EnvelopePoints(kBatchSize), units);
+    for (const auto &p : params) {
+      flowrate.push_back(p.flowrate);
+      total_head.push_back(p.total_head);
+      viscosity.push_back(p.viscosity);
+      density.push_back(p.density);
+    }
+  }
+
+  batch::SoaInput input() const {
+    return {flowrate, total_head, viscosity, density};
+  }
+
+  vccore::Units units;
+  std::vector<vccore::Parameters> params;
+  std::vector<double> flowrate, total_head, viscosity, density;
+};
+
+const ColumnData &Data() {
+  static const ColumnData data;
+  return data;
+}
+
+/// @brief The envelope in random ones of all unit combinations, like a file
+/// collected from several sources. Each source contributes runs of up to
+/// 2 * run_length points, a run_length of 1 changes units on every point.
+struct MixedData {
+  explicit MixedData(std::size_t run_length) {
+    const std::vector<vccore::Parameters> canonical =
+        EnvelopePoints(kBatchSize);
+    std::mt19937_64 rng(7);
+    points.resize(kBatchSize);
+    std::size_t run = 0;
+    vccore::Units units;
+    for (std::size_t i = 0; i < kBatchSize; i++) {
+      if (run-- == 0) {
+        units = batch::UnitsAt(rng() % batch::kUnitCombinations);
+        run = run_length > 1 ? rng() % (2 * run_length) : 0;
+      }
+      points[i].units = units;
+      points[i].params = InUnits({canonical[i]}, points[i].units).front();
+
+      // The same points as columns per unit combination
+      std::array<std::vector<double>, 4> &columns =
+          groups[batch::UnitIndex(points[i].units)];
+      columns[0].push_back(points[i].params.flowrate);
+      columns[1].push_back(points[i].params.total_head);
+      columns[2].push_back(points[i].params.viscosity);
+      columns[3].push_back(points[i].params.density);
+    }
+  }
+
+  std::vector<batch::OperatingPoint> points;
+  std::array<std::array<std::vector<double>, 4>, batch::kUnitCombinations>
+      groups;
+};
+
+// Average run of equal units for the per source data sets
+constexpr std::size_t kSourceRun = 256;
+
+const MixedData &Mixed(std::size_t run_length) {
+  static const MixedData per_point(1);
+  static const MixedData per_source(kSourceRun);
+  return run_length == 1 ? per_point : per_source;
+}
+
+}  // namespace
+
+// Baseline: the plain scalar loop the view uses per point
+void BM_BatchScalarLoop(benchmark::State &state) {
+  const ColumnData &data = Data();
+  std::vector<vccore::CorrectionFactors> out(kBatchSize);
+  vccore::Calculator calculator;
+  for (auto _ : state) {
+    for (std::size_t i = 0; i < kBatchSize; i++)
+      out[i] = calculator.Calculate(data.params[i], data.units);
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * kBatchSize);
+}
+BENCHMARK(BM_BatchScalarLoop)->Unit(benchmark::kMillisecond);
+
+// Single threaded SoA path
+void BM_BatchSoa(benchmark::State &state) {
+  const ColumnData &data = Data();
+  batch::SoaResults results;
+  results.resize(kBatchSize);
+  batch::SoaCalculator calculator;
+  for (auto _ : state) {
+    calculator.Calculate(data.input(), data.units, results.view());
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * kBatchSize);
+  state.SetLabel(batch::SoaKernelName());
+}
+BENCHMARK(BM_BatchSoa)->Unit(benchmark::kMillisecond);
+
+// Scaling of the BatchEngine from one thread to all hardware threads
+void BM_BatchEngine(benchmark::State &state) {
+  const ColumnData &data = Data();
+  std::vector<vccore::CorrectionFactors> out(kBatchSize);
+  batch::BatchEngine engine(static_cast<std::size_t>(state.range(0)));
+  for (auto _ : state) {
+    engine.Calculate(data.params, data.units, out);
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * kBatchSize);
+}
+BENCHMARK(BM_BatchEngine)
+    ->ArgName("threads")
+    ->RangeMultiplier(2)
+    ->Range(1, std::max(1u, std::thread::hardware_concurrency()))
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+// Scaling of the SoA path on the BatchEngine
+void BM_BatchEngineSoa(benchmark::State &state) {
+  const ColumnData &data = Data();
+  batch::SoaResults results;
+  results.resize(kBatchSize);
+  batch::BatchEngine engine(static_cast<std::size_t>(state.range(0)));
+  for (auto _ : state) {
+    engine.Calculate(data.input(), data.units, results.view());
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * kBatchSize);
+}
+BENCHMARK(BM_BatchEngineSoa)
+    ->ArgName("threads")
+    ->RangeMultiplier(2)
+    ->Range(1, std::max(1u, std::thread::hardware_concurrency()))
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+// Filtering and sorting the row index of a results table by eta, the columns
+// themselves stay in place
+void BM_SortResultRows(benchmark::State &state) {
+  const ColumnData &data = Data();
+  batch::SoaResults results;
+  results.resize(kBatchSize);
+  batch::BatchEngine engine;
+  engine.Calculate(data.input(), data.units, results.view());
+
+  batch::ThreadPool pool(static_cast<std::size_t>(state.range(0)));
+  batch::FlagFilter filter;
+  filter.mode = batch::FlagFilter::kValid;
+  for (auto _ : state) {
+    std::vector<std::uint32_t> rows =
+        batch::FilterRows(results.error_flag, filter);
+    batch::SortRows(rows, results.eta, true, &pool);
+    benchmark::DoNotOptimize(rows.data());
+  }
+  state.SetItemsProcessed(state.iterations() * kBatchSize);
+}
+BENCHMARK(BM_SortResultRows)
+    ->ArgName("threads")
+    ->RangeMultiplier(2)
+    ->Range(1, std::max(1u, std::thread::hardware_concurrency()))
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+// Cost of one reverse query (highest viscosity with eta >= target) compared
+// to the sweep a user would otherwise run
+void BM_ReverseSolve(benchmark::State &state) {
+  batch::ReverseSolver solver;
+  batch::SolverQuery query;
+  query.params = {300.0, 50.0, 0.0, 1000.0};
+  std::size_t evaluations = 0;
+  std::size_t solved = 0;
+  for (auto _ : state) {
+    query.target = 0.3 + 0.6 * static_cast<double>(solved % 64) / 64.0;
+    const batch::SolverResult result = solver.Solve(query);
+    evaluations += result.evaluations;
+    solved++;
+    benchmark::DoNotOptimize(result.value);
+  }
+  state.SetItemsProcessed(state.iterations());
+  state.counters["evaluations"] =
+      static_cast<double>(evaluations) / static_cast<double>(solved);
+}
+BENCHMARK(BM_ReverseSolve)->Unit(benchmark::kMicrosecond);
+
+// Mixed units, one calculator call per point that converts its own units.
+// This pair includes the core's chart evaluation, so the gain of the grouped
+// path depends on how much of the call the conversion is; no numbers for it
+// are recorded yet. BM_Normalise* below measure the conversion alone
+void BM_BatchMixedUnitsScalar(benchmark::State &state) {
+  const MixedData &data = Mixed(state.range(0));
+  std::vector<vccore::CorrectionFactors> out(kBatchSize);
+  vccore::Calculator calculator;
+  for (auto _ : state) {
+    for (std::size_t i = 0; i < kBatchSize; i++)
+      out[i] = calculator.Calculate(data.points[i].params,
+                                    data.points[i].units);
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * kBatchSize);
+}
+BENCHMARK(BM_BatchMixedUnitsScalar)
+    ->Arg(1)
+    ->Arg(kSourceRun)
+    ->Unit(benchmark::kMillisecond);
+
+// Mixed units grouped by combination, one specialised kernel per group.
+// Long runs are calculated in place, short ones sorted by units first
+void BM_BatchMixedUnitsGrouped(benchmark::State &state) {
+  const MixedData &data = Mixed(state.range(0));
+  std::vector<vccore::CorrectionFactors> out(kBatchSize);
+  batch::SoaCalculator calculator;
+  for (auto _ : state) {
+    calculator.Calculate(data.points, out);
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * kBatchSize);
+}
+BENCHMARK(BM_BatchMixedUnitsGrouped)
+    ->Arg(1)
+    ->Arg(kSourceRun)
+    ->Unit(benchmark::kMillisecond);
+
+// Normalisation alone: factors looked up and applied per point...
+void BM_NormaliseRuntimeUnits(benchmark::State &state) {
+  const MixedData &data = Mixed(state.range(0));
+  std::vector<double> flowrate(kBatchSize), total_head(kBatchSize),
+      viscosity(kBatchSize);
+  std::vector<std::int32_t> flags(kBatchSize);
+  for (auto _ : state) {
+    for (std::size_t i = 0; i < kBatchSize; i++) {
+      const batch::OperatingPoint &point = data.points[i];
+      const vccore::Parameters canonical =
+          batch::Normalise(point.params, batch::GetUnitScale(point.units));
+      flowrate[i] = canonical.flowrate;
+      total_head[i] = canonical.total_head;
+      viscosity[i] = canonical.viscosity;
+      flags[i] = batch::CheckRanges(canonical);
+    }
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * kBatchSize);
+}
+BENCHMARK(BM_NormaliseRuntimeUnits)
+    ->Arg(1)
+    ->Arg(kSourceRun)
+    ->Unit(benchmark::kMillisecond);
+
+// ...and per unit combination with the kernel specialised for it
+void BM_NormaliseStaticUnits(benchmark::State &state) {
+  const MixedData &data = Mixed(state.range(0));
+  std::vector<double> flowrate(kBatchSize), total_head(kBatchSize),
+      viscosity(kBatchSize);
+  std::vector<std::int32_t> flags(kBatchSize);
+  for (auto _ : state) {
+    std::size_t offset = 0;
+    for (std::size_t i = 0; i < batch::kUnitCombinations; i++) {
+      const auto &columns = data.groups[i];
+      const std::size_t size = columns[0].size();
+      batch::NormaliseColumns(
+          {columns[0], columns[1], columns[2], columns[3]}, batch::UnitsAt(i),
+          std::span(flowrate).subspan(offset, size),
+          std::span(total_head).subspan(offset, size),
+          std::span(viscosity).subspan(offset, size),
+          std::span(flags).subspan(offset, size));
+      offset += size;
+    }
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * kBatchSize);
+}
+BENCHMARK(BM_NormaliseStaticUnits)
+    ->Arg(1)
+    ->Arg(kSourceRun)
+    ->Unit(benchmark::kMillisecond);
+
+}  // namespace benchmarks
+
+}  // namespace visco
+
+}  // namespace spauly
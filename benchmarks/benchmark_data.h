@@ -0,0 +1,85 @@
+// Visco Correct Desktop - Correction factors for centrifugal pumps
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Visco-Correct-Desktop>
+#ifndef SPAULY_VISCO_BENCHMARKS_BENCHMARK_DATA_H
+#define SPAULY_VISCO_BENCHMARKS_BENCHMARK_DATA_H
+
+#include <cmath>
+#include <cstddef>
+#include <random>
+#include <vector>
+
+#include "spauly/vccore/data.h"
+#include "spauly/visco/batch/unit_conversion.h"
+
+namespace spauly {
+namespace visco {
+namespace benchmarks {
+
+/// @brief Returns count operating points in canonical units, spread
+/// log-uniformly over the valid envelope of the chart. The sequence is
+/// deterministic so runs stay comparable.
+inline std::vector<vccore::Parameters> EnvelopePoints(std::size_t count) {
+  std::mt19937_64 rng(42);
+  std::uniform_real_distribution<double> unit(0.0, 1.0);
+  auto log_uniform = [&](double min, double max) {
+    return min * std::pow(max / min, unit(rng));
+  };
+
+  std::vector<vccore::Parameters> points(count);
+  for (auto &point : points) {
+    point.flowrate = log_uniform(batch::kMinFlowrate, batch::kMaxFlowrate);
+    point.total_head = log_uniform(batch::kMinTotalHead, batch::kMaxTotalHead);
+    point.viscosity = log_uniform(batch::kMinViscosity, batch::kMaxViscosity);
+    point.density = 850.0 + 150.0 * unit(rng);
+  }
+  return points;
+}
+
+/// @brief Converts canonical points into units, so the same envelope can be
+/// measured for every unit combination.
+inline std::vector<vccore::Parameters> InUnits(
+    std::vector<vccore::Parameters> points, const vccore::Units &units) {
+  const batch::UnitScale scale = batch::GetUnitScale(units);
+  for (auto &point : points) {
+    point.flowrate /= scale.flowrate;
+    point.total_head /= scale.total_head;
+    point.viscosity /= scale.viscosity;
+    if (scale.dynamic_viscosity) point.viscosity *= point.density;
+    point.density /= scale.density;
+  }
+  return points;
+}
+
+/// @brief Builds the unit combination from combo indices.
+inline vccore::Units MakeUnits(long flowrate, long total_head, long viscosity,
+                               long density = 1) {
+  vccore::Units units;
+  units.flowrate = static_cast<vccore::FlowrateUnit>(flowrate);
+  units.total_head = static_cast<vccore::TotalHeadUnit>(total_head);
+  units.viscosity = static_cast<vccore::ViscosityUnit>(viscosity);
+  units.density = static_cast<vccore::DensityUnit>(density);
+  return units;
+}
+
+}  // namespace benchmarks
+
+}  // namespace visco
+
+}  // namespace spauly
+
+#endif  // SPAULY_VISCO_BENCHMARKS_BENCHMARK_DATA_H
@@ -0,0 +1,48 @@
+// Visco Correct Desktop - Correction factors for centrifugal pumps
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Visco-Correct-Desktop>
+//
+// libFuzzer entry point for the calculation path. Every input is decoded
+// into operating points with raw doubles and checked by PropertyChecker,
+// a violation aborts with its description. Built with -DVCD_FUZZ=ON and
+// Clang, run e.g. with
+//   vcd_calculation_fuzzer -max_len=3300 corpus/
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "calculation_properties.h"
+
+extern "C" int LLVMFuzzerTestOneInput(const std::uint8_t *data,
+                                      std::size_t size) {
+  using namespace spauly::visco;
+
+  static benchmarks::PropertyChecker checker;
+  static std::vector<batch::OperatingPoint> points;
+  static std::string failure;
+
+  benchmarks::DecodePoints(std::span(data, size), points);
+  if (!checker.Check(points, failure)) {
+    std::fprintf(stderr, "%s\n", failure.c_str());
+    std::abort();
+  }
+  return 0;
+}
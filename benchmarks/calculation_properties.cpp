@@ -0,0 +1,399 @@
+// Visco Correct Desktop - Correction factors for centrifugal pumps
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Visco-Correct-Desktop>
+#include "calculation_properties.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+
+namespace spauly {
+namespace visco {
+namespace benchmarks {
+
+namespace {
+
+constexpr double kTolerance = 1e-9;
+
+// Bytes DecodePoints() consumes per point
+constexpr std::size_t kPointBytes = 4 * sizeof(double) + 1;
+
+// UnitsAt() of this index has a flow rate unit past the enum
+constexpr std::size_t kUnknownUnitsIndex = batch::kUnitCombinations;
+
+constexpr const char *kFactorNames[6] = {"q",      "eta",    "h(0.6)",
+                                         "h(0.8)", "h(1.0)", "h(1.2)"};
+
+constexpr double kSpecialValues[] = {
+    std::numeric_limits<double>::quiet_NaN(),
+    std::numeric_limits<double>::infinity(),
+    -std::numeric_limits<double>::infinity(),
+    0.0,
+    -0.0,
+    std::numeric_limits<double>::denorm_min(),
+    std::numeric_limits<double>::min(),
+    std::numeric_limits<double>::max(),
+    std::numeric_limits<double>::lowest(),
+    -1.0,
+};
+
+std::array<double, 6> Factors(const vccore::CorrectionFactors &factors) {
+  return {factors.q,    factors.eta,  factors.h[0],
+          factors.h[1], factors.h[2], factors.h[3]};
+}
+
+bool Close(double a, double b) {
+  return a == b || std::abs(a - b) <= kTolerance * std::max({1.0, std::abs(a),
+                                                             std::abs(b)});
+}
+
+bool Identical(double a, double b) {
+  return a == b || (std::isnan(a) && std::isnan(b));
+}
+
+bool NearLimit(double value, double min, double max) {
+  return std::abs(value - min) <= kTolerance * min ||
+         std::abs(value - max) <= kTolerance * max;
+}
+
+bool NearLimits(const vccore::Parameters &canonical) {
+  return NearLimit(canonical.flowrate, batch::kMinFlowrate,
+                   batch::kMaxFlowrate) ||
+         NearLimit(canonical.total_head, batch::kMinTotalHead,
+                   batch::kMaxTotalHead) ||
+         NearLimit(canonical.viscosity, batch::kMinViscosity,
+                   batch::kMaxViscosity);
+}
+
+bool Fail(std::string &failure, const char *path, const char *what,
+          const batch::OperatingPoint &point,
+          const vccore::CorrectionFactors &result) {
+  const vccore::Parameters &params = point.params;
+  char text[512];
+  std::snprintf(text, sizeof(text),
+                "%s: %s at Q=%.17g H=%.17g v=%.17g density=%.17g (units "
+                "%d/%d/%d/%d), got q=%.17g eta=%.17g h=%.17g/%.17g/%.17g/"
+                "%.17g error=%d",
+                path, what, params.flowrate, params.total_head,
+                params.viscosity, params.density,
+                static_cast<int>(point.units.flowrate),
+                static_cast<int>(point.units.total_head),
+                static_cast<int>(point.units.viscosity),
+                static_cast<int>(point.units.density), result.q, result.eta,
+                result.h[0], result.h[1], result.h[2], result.h[3],
+                result.error_flag);
+  failure = text;
+  return false;
+}
+
+/// @brief Picks a special value or one at a chart limit given in the units
+/// of the point.
+double SpecialValue(std::mt19937_64 &rng, double min, double max) {
+  const std::size_t pick = rng() % (std::size(kSpecialValues) + 6);
+  if (pick < std::size(kSpecialValues)) return kSpecialValues[pick];
+  const double limit = (pick % 2 == 0) ? min : max;
+  switch ((pick - std::size(kSpecialValues)) / 2) {
+    case 0:
+      return limit;
+    case 1:
+      return std::nextafter(limit, 0.0);
+    default:
+      return std::nextafter(limit, std::numeric_limits<double>::infinity());
+  }
+}
+
+}  // namespace
+
+void RandomPoints(std::mt19937_64 &rng,
+                  std::vector<batch::OperatingPoint> &points) {
+  std::uniform_real_distribution<double> unit(0.0, 1.0);
+  // Half an octave beyond the envelope on both sides
+  auto around = [&](double min, double max) {
+    return min * 0.5 * std::pow(4.0 * max / min, unit(rng));
+  };
+  auto value = [&](double min, double max) {
+    return unit(rng) < 0.25 ? SpecialValue(rng, min, max) : around(min, max);
+  };
+
+  for (batch::OperatingPoint &point : points) {
+    point.units = batch::UnitsAt(rng() % batch::kUnitCombinations);
+    const batch::UnitScale scale = batch::GetUnitScale(point.units);
+    vccore::Parameters &params = point.params;
+
+    params.flowrate = value(batch::kMinFlowrate / scale.flowrate,
+                            batch::kMaxFlowrate / scale.flowrate);
+    params.total_head = value(batch::kMinTotalHead / scale.total_head,
+                              batch::kMaxTotalHead / scale.total_head);
+    params.density = unit(rng) < 0.25 ? SpecialValue(rng, 500.0, 2000.0)
+                                      : (500.0 + 1500.0 * unit(rng));
+    params.density /= scale.density;
+
+    // Dynamic viscosities are divided by the density
+    double viscosity_scale = 1.0 / scale.viscosity;
+    if (scale.dynamic_viscosity)
+      viscosity_scale *= params.density * scale.density;
+    params.viscosity = value(batch::kMinViscosity * viscosity_scale,
+                             batch::kMaxViscosity * viscosity_scale);
+
+    // A few rows carry units outside of the enums, as decoded from files
+    if (rng() % 64 == 0) point.units = batch::UnitsAt(kUnknownUnitsIndex);
+  }
+}
+
+void DecodePoints(std::span<const std::uint8_t> data,
+                  std::vector<batch::OperatingPoint> &points) {
+  points.resize(data.size() / kPointBytes);
+  for (batch::OperatingPoint &point : points) {
+    double values[4];
+    std::memcpy(values, data.data(), sizeof(values));
+    point.params.flowrate = values[0];
+    point.params.total_head = values[1];
+    point.params.viscosity = values[2];
+    point.params.density = values[3];
+    point.units = batch::UnitsAt(data[sizeof(values)] %
+                                 (kUnknownUnitsIndex + 1));
+    data = data.subspan(kPointBytes);
+  }
+}
+
+PropertyChecker::PropertyChecker() : engine_(2) {
+  // Small chunks so that even short inputs are split between the workers
+  engine_.set_chunk_size(256);
+}
+
+bool PropertyChecker::Check(std::span<const batch::OperatingPoint> points,
+                            std::string &failure) {
+  const std::size_t count = points.size();
+  scalar_.resize(count);
+  mixed_.resize(count);
+  engine_mixed_.resize(count);
+
+  for (std::size_t i = 0; i < count; i++)
+    scalar_[i] = calculator_.Calculate(points[i].params, points[i].units);
+  evaluations_ += count;
+  for (std::size_t i = 0; i < count; i++)
+    if (!CheckScalar(points[i], scalar_[i], failure)) return false;
+
+  soa_.Calculate(points, mixed_);
+  engine_.Calculate(points, engine_mixed_);
+  evaluations_ += 2 * count;
+  for (std::size_t i = 0; i < count; i++) {
+    if (!CheckBatch(points[i], scalar_[i], mixed_[i],
+                    "SoaCalculator (mixed units)", failure) ||
+        !CheckBatch(points[i], scalar_[i], engine_mixed_[i],
+                    "BatchEngine (mixed units)", failure))
+      return false;
+  }
+
+  for (std::vector<std::uint32_t> &group : groups_) group.clear();
+  unknown_.clear();
+  for (std::size_t i = 0; i < count; i++) {
+    const auto row = static_cast<std::uint32_t>(i);
+    if (batch::IsValidUnits(points[i].units))
+      groups_[batch::UnitIndex(points[i].units)].push_back(row);
+    else
+      unknown_.push_back(row);
+  }
+  for (std::size_t g = 0; g < groups_.size(); g++) {
+    if (!groups_[g].empty() &&
+        !CheckGroup(points, groups_[g], batch::UnitsAt(g), failure))
+      return false;
+  }
+  // Unknown units differ from row to row, each is a group of its own
+  for (std::size_t j = 0; j < unknown_.size(); j++) {
+    if (!CheckGroup(points, std::span(unknown_).subspan(j, 1),
+                    points[unknown_[j]].units, failure))
+      return false;
+  }
+  return true;
+}
+
+bool PropertyChecker::CheckUnitTables(std::string &failure) {
+  // Far above the rounding of the conversion, far below any difference in
+  // the published conversion factors
+  constexpr double kOffset = 1e-10;
+  constexpr double kDensities[] = {800.0, 1000.0, 1250.0};  // kg/m^3
+  constexpr double kLimits[3][2] = {
+      {batch::kMinFlowrate, batch::kMaxFlowrate},
+      {batch::kMinTotalHead, batch::kMaxTotalHead},
+      {batch::kMinViscosity, batch::kMaxViscosity}};
+
+  for (std::size_t index = 0; index < batch::kUnitCombinations; index++) {
+    batch::OperatingPoint point;
+    point.units = batch::UnitsAt(index);
+    const batch::UnitScale scale = batch::GetUnitScale(point.units);
+
+    for (double density : kDensities) {
+      for (std::size_t field = 0; field < 3; field++) {
+        for (double limit : kLimits[field]) {
+          for (double offset : {-kOffset, kOffset}) {
+            // A point in the middle of the chart with one field moved to
+            // the limit, in canonical units
+            double values[3] = {100.0, 50.0, 200.0};
+            values[field] = limit * (1.0 + offset);
+
+            double viscosity_scale = 1.0 / scale.viscosity;
+            if (scale.dynamic_viscosity) viscosity_scale *= density;
+            point.params.flowrate = values[0] / scale.flowrate;
+            point.params.total_head = values[1] / scale.total_head;
+            point.params.viscosity = values[2] * viscosity_scale;
+            point.params.density = density / scale.density;
+
+            const int flags =
+                batch::CheckRanges(batch::Normalise(point.params, scale));
+            const vccore::CorrectionFactors result =
+                calculator_.Calculate(point.params, point.units);
+            evaluations_++;
+            if (result.error_flag != flags)
+              return Fail(failure, "Calculator",
+                          "unit conversion differs from unit_conversion.h",
+                          point, result);
+          }
+        }
+      }
+    }
+  }
+  return true;
+}
+
+bool PropertyChecker::CheckScalar(const batch::OperatingPoint &point,
+                                  const vccore::CorrectionFactors &result,
+                                  std::string &failure) {
+  const char *path = "Calculator";
+  if (result.error_flag != 0) return true;
+
+  const std::array<double, 6> factors = Factors(result);
+  for (double factor : factors)
+    if (!(factor >= 0.0 && factor <= 1.0))
+      return Fail(failure, path, "factor outside [0, 1]", point, result);
+
+  // A thicker fluid never has higher factors
+  batch::OperatingPoint thicker = point;
+  thicker.params.viscosity *= 1.05;
+  const vccore::CorrectionFactors higher =
+      calculator_.Calculate(thicker.params, thicker.units);
+  evaluations_++;
+  if (higher.error_flag != 0) return true;
+  const std::array<double, 6> higher_factors = Factors(higher);
+  for (std::size_t k = 0; k < factors.size(); k++) {
+    if (higher_factors[k] > factors[k] + kTolerance) {
+      const std::string what =
+          std::string(kFactorNames[k]) + " rises with the viscosity";
+      return Fail(failure, path, what.c_str(), point, higher);
+    }
+  }
+  return true;
+}
+
+bool PropertyChecker::CheckBatch(const batch::OperatingPoint &point,
+                                 const vccore::CorrectionFactors &scalar,
+                                 const vccore::CorrectionFactors &result,
+                                 const char *path,
+                                 std::string &failure) const {
+  if (result.error_flag != scalar.error_flag) {
+    if (batch::IsValidUnits(point.units) &&
+        NearLimits(batch::Normalise(point.params,
+                                    batch::GetUnitScale(point.units))))
+      return true;
+    return Fail(failure, path, "error flags differ from Calculator", point,
+                result);
+  }
+
+  const std::array<double, 6> factors = Factors(result);
+  const std::array<double, 6> expected = Factors(scalar);
+  for (std::size_t k = 0; k < factors.size(); k++) {
+    const bool same = scalar.error_flag != 0
+                          ? Identical(factors[k], expected[k])
+                          : Close(factors[k], expected[k]);
+    if (!same)
+      return Fail(failure, path, "differs from Calculator", point, result);
+  }
+  return true;
+}
+
+bool PropertyChecker::CheckGroup(std::span<const batch::OperatingPoint> points,
+                                 std::span<const std::uint32_t> rows,
+                                 const vccore::Units &units,
+                                 std::string &failure) {
+  const std::size_t count = rows.size();
+  flowrate_.resize(count);
+  total_head_.resize(count);
+  viscosity_.resize(count);
+  density_.resize(count);
+  params_.resize(count);
+  group_out_.resize(count);
+  soa_out_.resize(count);
+  engine_out_.resize(count);
+
+  for (std::size_t j = 0; j < count; j++) {
+    const vccore::Parameters &params = points[rows[j]].params;
+    flowrate_[j] = params.flowrate;
+    total_head_[j] = params.total_head;
+    viscosity_[j] = params.viscosity;
+    density_[j] = params.density;
+    params_[j] = params;
+  }
+
+  const batch::SoaInput in{flowrate_, total_head_, viscosity_, density_};
+  if (!soa_.Calculate(in, units, soa_out_.view()) ||
+      !engine_.Calculate(in, units, engine_out_.view()) ||
+      !engine_.Calculate(params_, units, group_out_)) {
+    failure = "a batch path rejected columns of equal size";
+    return false;
+  }
+  evaluations_ += 3 * count;
+
+  auto row = [](const batch::SoaResults &results, std::size_t j) {
+    vccore::CorrectionFactors factors;
+    factors.q = results.q[j];
+    factors.eta = results.eta[j];
+    for (std::size_t k = 0; k < factors.h.size(); k++)
+      factors.h[k] = results.h[k][j];
+    factors.error_flag = results.error_flag[j];
+    return factors;
+  };
+
+  for (std::size_t j = 0; j < count; j++) {
+    const batch::OperatingPoint &point = points[rows[j]];
+    const vccore::CorrectionFactors &scalar = scalar_[rows[j]];
+
+    // Runs the same calculator per point, so it has to match bit for bit
+    const std::array<double, 6> expected = Factors(scalar);
+    const std::array<double, 6> shared = Factors(group_out_[j]);
+    bool identical = group_out_[j].error_flag == scalar.error_flag;
+    for (std::size_t k = 0; k < expected.size(); k++)
+      identical = identical && Identical(shared[k], expected[k]);
+    if (!identical)
+      return Fail(failure, "BatchEngine (shared units)",
+                  "differs from Calculator", point, group_out_[j]);
+
+    if (!CheckBatch(point, scalar, row(soa_out_, j), "SoaCalculator (columns)",
+                    failure) ||
+        !CheckBatch(point, scalar, row(engine_out_, j),
+                    "BatchEngine (columns)", failure))
+      return false;
+  }
+  return true;
+}
+
+}  // namespace benchmarks
+
+}  // namespace visco
+
+}  // namespace spauly
@@ -0,0 +1,131 @@
+// Visco Correct Desktop - Correction factors for centrifugal pumps
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Visco-Correct-Desktop>
+#ifndef SPAULY_VISCO_BENCHMARKS_CALCULATION_PROPERTIES_H
+#define SPAULY_VISCO_BENCHMARKS_CALCULATION_PROPERTIES_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "spauly/vccore/calculator.h"
+#include "spauly/vccore/data.h"
+#include "spauly/visco/batch/batch_engine.h"
+#include "spauly/visco/batch/row_io.h"
+#include "spauly/visco/batch/soa_batch.h"
+#include "spauly/visco/batch/unit_conversion.h"
+
+namespace spauly {
+namespace visco {
+namespace benchmarks {
+
+/// @brief Fills points with random operating points in random units. About
+/// a quarter of the values are special: NaN, infinities, zeros, denormals,
+/// the extremes of double and the chart limits themselves or their
+/// neighbouring doubles. The rest lies around the chart envelope. One in 64
+/// points has units outside of the enums.
+void RandomPoints(std::mt19937_64 &rng,
+                  std::vector<batch::OperatingPoint> &points);
+
+/// @brief Decodes fuzzer input into points, 33 bytes per point: four raw
+/// doubles and a unit combination, where kUnitCombinations stands for
+/// unknown units. A trailing partial point is ignored.
+void DecodePoints(std::span<const std::uint8_t> data,
+                  std::vector<batch::OperatingPoint> &points);
+
+/// @brief Runs operating points through the scalar calculator and every
+/// batch path and checks the properties the UI and the CLI rely on:
+///
+/// - Every batch path returns the error flags of the calculator for every
+///   row, NaN, infinities and unknown units included.
+/// - Rows the calculator flags get its factors unchanged. BatchEngine with
+///   shared units matches the calculator exactly on all rows, the SoA and
+///   mixed unit paths within a relative 1e-9 on unflagged rows.
+/// - Rows without error flag get finite factors in [0, 1] that do not
+///   increase with the viscosity.
+///
+/// Rows within 1e-9 of a chart limit may be flagged differently, the unit
+/// conversion of the batch paths may round them to either side.
+class PropertyChecker {
+ public:
+  PropertyChecker();
+  ~PropertyChecker() = default;
+
+  /// @brief Checks all points.
+  /// @return Returns false and describes the first violation in failure.
+  bool Check(std::span<const batch::OperatingPoint> points,
+             std::string &failure);
+
+  /// @brief Checks the conversion tables of unit_conversion.h against the
+  /// core: points just inside and just outside of every chart limit, given
+  /// in every unit combination, must get the flags CheckRanges() derives
+  /// from the tables.
+  /// @return Returns false and describes the first disagreement in failure.
+  bool CheckUnitTables(std::string &failure);
+
+  /// @brief Returns the number of calculated points over all paths.
+  std::uint64_t evaluations() const { return evaluations_; }
+
+ private:
+  bool CheckScalar(const batch::OperatingPoint &point,
+                   const vccore::CorrectionFactors &result,
+                   std::string &failure);
+  bool CheckBatch(const batch::OperatingPoint &point,
+                  const vccore::CorrectionFactors &scalar,
+                  const vccore::CorrectionFactors &result, const char *path,
+                  std::string &failure) const;
+
+  /// @brief Runs the points of one unit combination through the column and
+  /// the shared unit paths.
+  bool CheckGroup(std::span<const batch::OperatingPoint> points,
+                  std::span<const std::uint32_t> rows,
+                  const vccore::Units &units, std::string &failure);
+
+  vccore::Calculator calculator_;
+  batch::SoaCalculator soa_;
+  batch::BatchEngine engine_;
+
+  std::vector<vccore::CorrectionFactors> scalar_;
+  std::vector<vccore::CorrectionFactors> mixed_;
+  std::vector<vccore::CorrectionFactors> engine_mixed_;
+  std::array<std::vector<std::uint32_t>, batch::kUnitCombinations> groups_;
+  std::vector<std::uint32_t> unknown_;
+
+  // Columns of one group
+  std::vector<double> flowrate_;
+  std::vector<double> total_head_;
+  std::vector<double> viscosity_;
+  std::vector<double> density_;
+  std::vector<vccore::Parameters> params_;
+  std::vector<vccore::CorrectionFactors> group_out_;
+  batch::SoaResults soa_out_;
+  batch::SoaResults engine_out_;
+
+  std::uint64_t evaluations_ = 0;
+};
+
+}  // namespace benchmarks
+
+}  // namespace visco
+
+}  // namespace spauly
+
+#endif  // SPAULY_VISCO_BENCHMARKS_CALCULATION_PROPERTIES_H
@@ -0,0 +1,98 @@
+// Visco Correct Desktop - Correction factors for centrifugal pumps
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Visco-Correct-Desktop>
+#include <benchmark/benchmark.h>
+
+#include "benchmark_data.h"
+#include "spauly/vccore/calculator.h"
+#include "spauly/visco/batch/correction_grid.h"
+
+namespace spauly {
+namespace visco {
+namespace benchmarks {
+
+namespace {
+
+constexpr std::size_t kPoints = 4096;
+
+void RunCalculate(benchmark::State &state,
+                  const std::vector<vccore::Parameters> &points,
+                  const vccore::Units &units) {
+  vccore::Calculator calculator;
+  std::size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(calculator.Calculate(points[i], units));
+    i = (i + 1 == points.size()) ? 0 : i + 1;
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+}  // namespace
+
+// Cost of one call spread over the whole valid envelope in canonical units
+void BM_CalculateEnvelope(benchmark::State &state) {
+  static const auto points = EnvelopePoints(kPoints);
+  RunCalculate(state, points, MakeUnits(0, 0, 0));
+}
+BENCHMARK(BM_CalculateEnvelope);
+
+// Same envelope for every flowrate, head and viscosity unit combination
+void BM_CalculateUnits(benchmark::State &state) {
+  const vccore::Units units =
+      MakeUnits(state.range(0), state.range(1), state.range(2));
+  const auto points = InUnits(EnvelopePoints(kPoints), units);
+  RunCalculate(state, points, units);
+}
+BENCHMARK(BM_CalculateUnits)
+    ->ArgNames({"flow", "head", "visc"})
+    ->ArgsProduct({{0, 1, 2}, {0, 1}, {0, 1, 2, 3}});
+
+// Points outside the chart only run through the range checks
+void BM_CalculateOutOfRange(benchmark::State &state) {
+  auto points = EnvelopePoints(kPoints);
+  for (auto &point : points) point.total_head *= 10.0;
+  RunCalculate(state, points, MakeUnits(0, 0, 0));
+}
+BENCHMARK(BM_CalculateOutOfRange);
+
+// Interpolated lookup in the precomputed grid, including unit handling
+void BM_CalculateGrid(benchmark::State &state) {
+  static const batch::CorrectionGrid grid = [] {
+    batch::CorrectionGrid result;
+    result.Build();
+    return result;
+  }();
+  const auto points = EnvelopePoints(kPoints);
+  const vccore::Units units = MakeUnits(0, 0, 0);
+
+  batch::GridCalculator calculator(&grid);
+  std::size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(calculator.Calculate(
+        points[i], units, batch::CalculationMode::kGrid));
+    i = (i + 1 == points.size()) ? 0 : i + 1;
+  }
+  state.SetItemsProcessed(state.iterations());
+  state.counters["max_eta_error"] = grid.error().eta;
+}
+BENCHMARK(BM_CalculateGrid);
+
+}  // namespace benchmarks
+
+}  // namespace visco
+
+}  // namespace spauly
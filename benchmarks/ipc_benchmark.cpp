@@ -0,0 +1,122 @@
+// Visco Correct Desktop - Correction factors for centrifugal pumps
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Visco-Correct-Desktop>
+#include <benchmark/benchmark.h>
+
+#ifndef _WIN32
+
+#include <algorithm>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "benchmark_data.h"
+#include "spauly/visco/batch/ipc_client.h"
+#include "spauly/visco/batch/ipc_server.h"
+
+namespace spauly {
+namespace visco {
+namespace benchmarks {
+
+namespace {
+
+/// @brief Column copy of the envelope in l/min and cP for the requests.
+struct RequestData {
+  RequestData() : units(MakeUnits(1, 0, 2)) {
+    for (const auto &p :
+         InUnits(EnvelopePoints(batch::kIpcMaxFrameRows), units)) {
+      flowrate.push_back(p.flowrate);
+      total_head.push_back(p.total_head);
+      viscosity.push_back(p.viscosity);
+      density.push_back(p.density);
+    }
+  }
+
+  batch::SoaInput input(std::size_t rows) const {
+    return {std::span(flowrate).first(rows),
+            std::span(total_head).first(rows),
+            std::span(viscosity).first(rows), std::span(density).first(rows)};
+  }
+
+  vccore::Units units;
+  std::vector<double> flowrate, total_head, viscosity, density;
+};
+
+}  // namespace
+
+// A local client keeping up to depth requests of rows points in flight on
+// a server with one worker. Reports the points per second round trip.
+void BM_IpcCalculate(benchmark::State &state) {
+  const std::size_t rows = static_cast<std::size_t>(state.range(0));
+  const std::size_t depth =
+      std::min(static_cast<std::size_t>(state.range(1)),
+               batch::kIpcMaxFrameRows / rows);
+  const RequestData data;
+  const batch::SoaInput input = data.input(rows);
+
+  const std::string path =
+      (std::filesystem::temp_directory_path() / "vcd_benchmark.sock")
+          .string();
+  batch::IpcServer server(1);
+  if (!server.Listen(path)) {
+    state.SkipWithError("Could not listen on the benchmark socket");
+    return;
+  }
+  std::thread serving([&server] { server.Serve(); });
+
+  batch::IpcClient client;
+  if (!client.Connect(path)) {
+    state.SkipWithError("Could not connect to the benchmark server");
+  } else {
+    std::uint32_t id = 0;
+    batch::IpcStatus status;
+    batch::ResultColumns columns;
+    for (std::size_t i = 0; i < depth; i++)
+      client.Send(id++, input, data.units);
+    for (auto _ : state) {
+      if (!client.Receive(id, status, columns) ||
+          !client.Send(id, input, data.units)) {
+        state.SkipWithError("The connection failed");
+        break;
+      }
+      benchmark::DoNotOptimize(columns.eta.data());
+    }
+    for (std::size_t i = 0; i < depth; i++)
+      client.Receive(id, status, columns);
+  }
+
+  client.Close();
+  server.Stop();
+  serving.join();
+  state.SetItemsProcessed(state.iterations() * rows);
+}
+BENCHMARK(BM_IpcCalculate)
+    ->ArgNames({"rows", "depth"})
+    ->Args({64, 1})
+    ->Args({64, 16})
+    ->Args({4096, 1})
+    ->Args({4096, 4})
+    ->UseRealTime();
+
+}  // namespace benchmarks
+
+}  // namespace visco
+
+}  // namespace spauly
+
+#endif
@@ -0,0 +1,123 @@
+// Visco Correct Desktop - Correction factors for centrifugal pumps
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Visco-Correct-Desktop>
+#include <benchmark/benchmark.h>
+#include <imgui.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "spauly/visco/utils/layerstack.h"
+
+namespace spauly {
+namespace visco {
+namespace benchmarks {
+
+namespace {
+
+// Stands in for a view, only counts its frames
+class CountingLayer : public utils::Layer {
+ public:
+  virtual void OnUIRender(const ImGuiWindowFlags &flags) override {
+    frames_++;
+  }
+
+  std::uint64_t frames() const { return frames_; }
+
+ private:
+  std::uint64_t frames_ = 0;
+};
+
+// Creates one layer per project and pushes them, every fourth is hidden
+// like docked projects whose tab is not selected
+struct Layers {
+  utils::LayerStack stack;
+  std::vector<std::shared_ptr<utils::Layer>> layers;
+  std::vector<utils::LayerHandle> handles;
+
+  explicit Layers(std::size_t count) {
+    layers.reserve(count);
+    handles.reserve(count);
+    for (std::size_t i = 0; i < count; i++) {
+      layers.push_back(std::make_shared<CountingLayer>());
+      handles.push_back(stack.PushLayer(layers.back()));
+      if (i % 4 == 3) stack.HideLayer(handles.back());
+    }
+  }
+};
+
+// Cheap, repeatable walk over the handles
+std::size_t NextIndex(std::uint32_t &state, std::size_t count) {
+  state = state * 1664525u + 1013904223u;
+  return state % count;
+}
+
+}  // namespace
+
+// Cost of walking the render order once, i.e. the per-frame overhead of the
+// stack itself
+void BM_LayerStackRender(benchmark::State &state) {
+  Layers layers(static_cast<std::size_t>(state.range(0)));
+
+  const ImGuiWindowFlags flags = 0;
+  for (auto _ : state) {
+    layers.stack.ForEachVisible(
+        [&flags](utils::Layer &layer) { layer.OnUIRender(flags); });
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_LayerStackRender)->Arg(1 << 10)->Arg(1 << 13);
+
+// Hiding and showing a layer, e.g. switching the tab of a project
+void BM_LayerStackHideShow(benchmark::State &state) {
+  Layers layers(static_cast<std::size_t>(state.range(0)));
+
+  std::uint32_t random = 1;
+  for (auto _ : state) {
+    const utils::LayerHandle handle =
+        layers.handles[NextIndex(random, layers.handles.size())];
+    layers.stack.HideLayer(handle);
+    layers.stack.ShowLayer(handle);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_LayerStackHideShow)->Arg(1 << 10)->Arg(1 << 13);
+
+// Closing a project and opening another one per frame. The layers stay
+// alive in the fixture, so only the stack is measured
+void BM_LayerStackPopPush(benchmark::State &state) {
+  Layers layers(static_cast<std::size_t>(state.range(0)));
+
+  std::uint32_t random = 1;
+  for (auto _ : state) {
+    const std::size_t i = NextIndex(random, layers.handles.size());
+    layers.stack.PopLayer(layers.handles[i]);
+    layers.handles[i] = layers.stack.PushLayer(layers.layers[i]);
+    layers.stack.EndFrame();
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_LayerStackPopPush)->Arg(1 << 10)->Arg(1 << 13);
+
+}  // namespace benchmarks
+
+}  // namespace visco
+
+}  // namespace spauly
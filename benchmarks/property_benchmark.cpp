@@ -0,0 +1,60 @@
+// Visco Correct Desktop - Correction factors for centrifugal pumps
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Visco-Correct-Desktop>
+#include <benchmark/benchmark.h>
+
+#include <cstddef>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "calculation_properties.h"
+
+namespace spauly {
+namespace visco {
+namespace benchmarks {
+
+// Random and special operating points through the scalar and every batch
+// path with the invariants of PropertyChecker. Fails on the first violation,
+// so a fast path that breaks the results cannot report a speedup
+void BM_CalculationProperties(benchmark::State &state) {
+  PropertyChecker checker;
+  std::vector<batch::OperatingPoint> points(
+      static_cast<std::size_t>(state.range(0)));
+  std::mt19937_64 rng(42);
+  std::string failure;
+
+  for (auto _ : state) {
+    state.PauseTiming();
+    RandomPoints(rng, points);
+    state.ResumeTiming();
+    if (!checker.Check(points, failure)) {
+      state.SkipWithError(failure.c_str());
+      return;
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+  state.counters["evaluations"] = benchmark::Counter(
+      static_cast<double>(checker.evaluations()), benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_CalculationProperties)->Arg(4096)->Unit(benchmark::kMicrosecond);
+
+}  // namespace benchmarks
+
+}  // namespace visco
+
+}  // namespace spauly
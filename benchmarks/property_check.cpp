@@ -0,0 +1,56 @@
+// Visco Correct Desktop - Correction factors for centrifugal pumps
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Visco-Correct-Desktop>
+//
+// Checks the unit tables against the core and runs PropertyChecker on a
+// fixed sequence of random operating points. Exits with 1 on the first
+// violation, so CTest catches a batch path that breaks the results.
+// BM_CalculationProperties measures the same checks.
+#include <cstddef>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "calculation_properties.h"
+
+int main() {
+  using namespace spauly::visco;
+
+  constexpr std::size_t kRounds = 64;
+  constexpr std::size_t kPoints = 4096;
+
+  benchmarks::PropertyChecker checker;
+  std::vector<batch::OperatingPoint> points(kPoints);
+  std::mt19937_64 rng(42);
+  std::string failure;
+
+  if (!checker.CheckUnitTables(failure)) {
+    std::fprintf(stderr, "Unit tables: %s\n", failure.c_str());
+    return 1;
+  }
+  for (std::size_t round = 0; round < kRounds; round++) {
+    benchmarks::RandomPoints(rng, points);
+    if (!checker.Check(points, failure)) {
+      std::fprintf(stderr, "Round %zu: %s\n", round, failure.c_str());
+      return 1;
+    }
+  }
+  std::printf("%zu points passed, %llu evaluations\n", kRounds * kPoints,
+              static_cast<unsigned long long>(checker.evaluations()));
+  return 0;
+}
@@ -0,0 +1,153 @@
+// Visco Correct Desktop - Correction factors for centrifugal pumps
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Visco-Correct-Desktop>
+#include <benchmark/benchmark.h>
+#include <imgui.h>
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <thread>
+
+#include "spauly/visco/application.h"
+#include "spauly/visco/backend/headless_backend.h"
+#include "spauly/visco/results_view.h"
+#include "spauly/visco/utils/job_system.h"
+#ifdef VCD_PROFILING
+#include "spauly/visco/utils/allocation_counter.h"
+#endif
+
+namespace spauly {
+namespace visco {
+namespace benchmarks {
+
+// CPU cost of one complete frame: NewFrame, Application::Render, Render.
+// Profiling builds also report the heap allocations per frame
+void BM_ApplicationRender(benchmark::State &state) {
+  backend::HeadlessBackend backend;
+  if (!backend.Init({})) {
+    state.SkipWithError("HeadlessBackend::Init failed");
+    return;
+  }
+  Application app;
+  if (!app.Init()) {
+    state.SkipWithError("Application::Init failed");
+    return;
+  }
+  app.set_autosave(false);
+
+#ifdef VCD_PROFILING
+  const std::uint64_t allocations = utils::ThreadAllocationCount();
+#endif
+  for (auto _ : state) {
+    backend.BeginFrame();
+    app.Render();
+    ImGui::Render();
+    app.EndFrame();
+    backend.EndFrame();
+    benchmark::DoNotOptimize(ImGui::GetDrawData());
+  }
+  state.SetItemsProcessed(state.iterations());
+  state.counters["vertices"] = backend.stats().vertices;
+#ifdef VCD_PROFILING
+  state.counters["allocations"] = benchmark::Counter(
+      static_cast<double>(utils::ThreadAllocationCount() - allocations),
+      benchmark::Counter::kAvgIterations);
+#endif
+}
+BENCHMARK(BM_ApplicationRender)->Unit(benchmark::kMicrosecond);
+
+// Frame cost with many docked projects, only the selected tab is visible
+void BM_ApplicationRenderProjects(benchmark::State &state) {
+  backend::HeadlessBackend backend;
+  if (!backend.Init({})) {
+    state.SkipWithError("HeadlessBackend::Init failed");
+    return;
+  }
+  Application app;
+  if (!app.Init()) {
+    state.SkipWithError("Application::Init failed");
+    return;
+  }
+  app.set_autosave(false);
+  for (std::int64_t i = 1; i < state.range(0); i++)
+    app.calculator_view().AddProject();
+
+  for (auto _ : state) {
+    backend.BeginFrame();
+    app.Render();
+    ImGui::Render();
+    app.EndFrame();
+    backend.EndFrame();
+    benchmark::DoNotOptimize(ImGui::GetDrawData());
+  }
+  state.SetItemsProcessed(state.iterations());
+  state.counters["vertices"] = backend.stats().vertices;
+}
+BENCHMARK(BM_ApplicationRenderProjects)
+    ->Arg(1)
+    ->Arg(16)
+    ->Arg(128)
+    ->Unit(benchmark::kMicrosecond);
+
+// Frame cost of the results table while it scrolls through a large result
+// set, should not grow with the number of rows
+void BM_ResultsViewScroll(benchmark::State &state) {
+  backend::HeadlessBackend backend;
+  if (!backend.Init({})) {
+    state.SkipWithError("HeadlessBackend::Init failed");
+    return;
+  }
+  const auto rows = static_cast<std::size_t>(state.range(0));
+  auto table = std::make_shared<ResultTable>();
+  table->results.resize(rows);
+  for (std::size_t i = 0; i < rows; i++) {
+    table->results.eta[i] = static_cast<double>(i % 1000) * 1e-3;
+    table->results.error_flag[i] = static_cast<std::int32_t>(i % 8 == 0);
+  }
+
+  utils::JobSystem jobs(1);
+  ResultsView view(jobs);
+  view.SetTable(table);
+  while (view.indexing()) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    jobs.Poll();
+  }
+
+  std::size_t position = 0;
+  for (auto _ : state) {
+    position = (position + 7919) % rows;
+    view.ScrollTo(position);
+    backend.BeginFrame();
+    view.OnUIRender(0);
+    ImGui::Render();
+    backend.EndFrame();
+    benchmark::DoNotOptimize(ImGui::GetDrawData());
+  }
+  state.SetItemsProcessed(state.iterations());
+  state.counters["vertices"] = backend.stats().vertices;
+}
+BENCHMARK(BM_ResultsViewScroll)
+    ->Arg(1 << 10)
+    ->Arg(10'000'000)
+    ->Unit(benchmark::kMicrosecond);
+
+}  // namespace benchmarks
+
+}  // namespace visco
+
+}  // namespace spauly
@@ -20,7 +20,20 @@
 
 #include <imgui.h>
 
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "spauly/visco/calculator_view.h"
+#include "spauly/visco/graph_view.h"
+#include "spauly/visco/project_file.h"
+#include "spauly/visco/results_view.h"
+#include "spauly/visco/solver_view.h"
+#include "spauly/visco/study_view.h"
+#include "spauly/visco/utils/frame_scheduler.h"
+#include "spauly/visco/utils/job_system.h"
 #include "spauly/visco/utils/layerstack.h"
+#include "spauly/visco/utils/object_pool.h"
 
 namespace spauly {
 namespace visco {
@@ -48,10 +61,57 @@ class Application {
   /// @return Returns false if the application should be closed.
   bool Render();
 
+  /// @brief Releases the memory the layers used for the frame. This should be
+  /// called after ImGui::Render().
+  void EndFrame() { layer_stack_.EndFrame(); }
+
+  /// @brief Returns the scheduler the main loop uses to decide whether the
+  /// next frame has to be rendered or if it can wait for events.
+  utils::FrameScheduler &scheduler() { return scheduler_; }
+
+  /// @brief Returns the job system that runs calculations off the UI thread.
+  /// Completed jobs are handed back at the start of every Render().
+  utils::JobSystem &jobs() { return jobs_; }
+
+  /// @brief Returns the view that holds the open projects.
+  CalculatorView &calculator_view() { return *calculator_view_; }
+
+  /// @brief Returns the arena the layers allocate their per-frame memory
+  /// from, e.g. to read its peak use.
+  const utils::FrameArena &frame_arena() const {
+    return layer_stack_.frame_arena();
+  }
+
+  /// @brief Enables or disables the periodic autosave of the projects.
+  void set_autosave(bool enabled) { autosave_ = enabled; }
+
  private:
+  /// @brief Tells the scheduler about UI states that change without input
+  /// events, e.g. the blinking text cursor or running jobs.
+  void UpdateScheduler();
+
   /// @brief Displays the menu bar.
   void MenuBar();
 
+  /// @brief Handles the keyboard shortcuts of the menu items.
+  void Shortcuts();
+
+  /// @brief Replaces the projects with the ones stored at path. The outcome
+  /// is shown in the menu bar.
+  void OpenWorkspace(const char *path);
+
+  /// @brief Writes a copy of the projects on a job, either as project file
+  /// or as JSON. While a save runs, further saves are queued once per path.
+  void SaveWorkspace(const char *path, bool json);
+
+  /// @brief Submits the save job for a snapshot of the current projects. When
+  /// it completes, its outcome is shown in the menu bar and the next queued
+  /// save starts.
+  void StartSave(std::string path, bool json);
+
+  /// @brief Shows or hides one of the optional layers.
+  void SetLayerVisible(utils::LayerHandle layer, bool visible);
+
   /// @brief Configures the window layout.
   void ConfigWindow();
 
@@ -68,7 +128,12 @@ class Application {
   // config
   bool use_open_workspace = false;
   bool show_graph_ = false;
+  bool show_study_ = false;
+  bool show_results_ = false;
+  bool show_solver_ = false;
   bool use_dark_mode = false;
+  bool power_saving_ = true;
+  bool autosave_ = true;
 
   // internal use
   bool submitting_feedback_ = false;
@@ -85,7 +150,7 @@ class Application {
                                              ImGuiWindowFlags_NoResize;
   ImGuiWindowFlags open_workspace_flags_ =
       ImGuiWindowFlags_NoCollapse | ImGuiWindowFlags_NoResize;
-  ImGuiWindowFlags &current_flags_ = closed_workspace_flags_;
+  ImGuiWindowFlags current_flags_ = closed_workspace_flags_;
   const float rounding_ = 2.0;
 
   // Style
@@ -93,7 +158,32 @@ class Application {
   ImVec4 *colors_ = nullptr;
   ImGuiStyle *style_ = nullptr;
 
+  struct SaveRequest {
+    std::string path;
+    bool json = false;
+  };
+
+  utils::JobSystem jobs_;
+  ProjectAutosaver autosaver_{jobs_, "autosave.vcproj"};
+  // Saves run one at a time, two writes to the same temporary file would
+  // interleave
+  utils::JobHandle save_job_;
+  std::vector<SaveRequest> queued_saves_;
+  // Outcome of the last open or save, shown in the menu bar
+  std::string status_;
+  // The layers are allocated from the pool, which has to outlive them
+  utils::ObjectPool layer_pool_;
   utils::LayerStack layer_stack_;
+  utils::FrameScheduler scheduler_;
+  std::shared_ptr<CalculatorView> calculator_view_;
+  std::shared_ptr<GraphView> graph_view_;
+  std::shared_ptr<StudyView> study_view_;
+  std::shared_ptr<ResultsView> results_view_;
+  std::shared_ptr<SolverView> solver_view_;
+  utils::LayerHandle graph_layer_;
+  utils::LayerHandle study_layer_;
+  utils::LayerHandle results_layer_;
+  utils::LayerHandle solver_layer_;
 };
 
 }  // namespace visco
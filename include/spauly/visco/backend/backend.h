@@ -0,0 +1,89 @@
+// Visco Correct Desktop - Correction factors for centrifugal pumps
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Visco-Correct-Desktop>
+#ifndef SPAULY_VISCO_BACKEND_BACKEND_H
+#define SPAULY_VISCO_BACKEND_BACKEND_H
+
+#include <imgui.h>
+
+#include "spauly/visco/application.h"
+#include "spauly/visco/utils/frame_scheduler.h"
+
+namespace spauly {
+namespace visco {
+namespace backend {
+
+/// @brief Window and renderer settings shared by all backends.
+struct BackendConfig {
+  const char *title = "Visco Correct";
+  int width = 445;
+  int height = 650;
+  bool vsync = true;
+  ImVec4 clear_color = ImVec4(0.45f, 0.55f, 0.60f, 1.00f);
+};
+
+/// @brief A platform and renderer combination the application runs on. A
+/// backend owns the window, the graphics device and the ImGui context, the
+/// frame loop itself is shared (see RunMainLoop()).
+class Backend {
+ public:
+  virtual ~Backend() = default;
+
+  /// @brief Creates the window, the device and the ImGui context and
+  /// initializes the ImGui platform and renderer backends.
+  /// @return Returns false if any of them could not be created.
+  virtual bool Init(const BackendConfig &config) = 0;
+
+  /// @brief Releases everything Init() created. Safe to call after a failed
+  /// Init().
+  virtual void Shutdown() = 0;
+
+  /// @brief Waits for at most scheduler.WaitTimeout() for events, dispatches
+  /// them and reports them to the scheduler.
+  /// @return Returns false if the window was closed.
+  virtual bool ProcessEvents(utils::FrameScheduler &scheduler) = 0;
+
+  /// @brief Makes a ProcessEvents() that blocks on another thread return as
+  /// if an event arrived. Safe to call from any thread.
+  virtual void Wake() {}
+
+  /// @brief Starts a new ImGui frame.
+  /// @return Returns false if the frame should be skipped, e.g. because the
+  /// window is minimized.
+  virtual bool BeginFrame() = 0;
+
+  /// @brief Renders the draw data of the finished frame and presents it.
+  /// ImGui::Render() must have been called.
+  virtual void EndFrame() = 0;
+};
+
+/// @brief Runs app on backend until the window is closed or app.Render()
+/// returns false. Frames are only rendered when app.scheduler() asks for one.
+void RunMainLoop(Backend &backend, Application &app);
+
+/// @brief Initializes backend and an Application, runs the main loop and shuts
+/// both down again.
+/// @return Returns the exit code for main().
+int RunApplication(Backend &backend, const BackendConfig &config = {});
+
+}  // namespace backend
+
+}  // namespace visco
+
+}  // namespace spauly
+
+#endif  // SPAULY_VISCO_BACKEND_BACKEND_H
@@ -0,0 +1,90 @@
+// Visco Correct Desktop - Correction factors for centrifugal pumps
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Visco-Correct-Desktop>
+#ifndef SPAULY_VISCO_BACKEND_HEADLESS_BACKEND_H
+#define SPAULY_VISCO_BACKEND_HEADLESS_BACKEND_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "spauly/visco/backend/backend.h"
+
+namespace spauly {
+namespace visco {
+namespace backend {
+
+/// @brief Size of the draw data of the last frame.
+struct FrameStats {
+  int draw_lists = 0;
+  int vertices = 0;
+  int indices = 0;
+  // Digest of the vertex, index and command streams, zero unless enabled
+  // with set_hash_draw_data()
+  std::uint64_t hash = 0;
+};
+
+/// @brief A backend without window and GPU. Frames are built completely by
+/// ImGui but the draw data is never submitted, so Application::Render() can
+/// be run, profiled and tested on machines without a display. Every frame is
+/// treated as if an input event arrived and advances the time by a fixed
+/// delta, which keeps runs reproducible.
+class HeadlessBackend : public Backend {
+ public:
+  /// @param frame_limit Number of frames after which ProcessEvents() reports
+  /// the window as closed. Zero runs until the application stops.
+  explicit HeadlessBackend(std::uint64_t frame_limit = 0)
+      : frame_limit_(frame_limit) {}
+  ~HeadlessBackend() override { Shutdown(); }
+
+  bool Init(const BackendConfig &config) override;
+  void Shutdown() override;
+  bool ProcessEvents(utils::FrameScheduler &scheduler) override;
+  bool BeginFrame() override;
+  void EndFrame() override;
+
+  /// @brief Sets the time every frame advances, the default is 1/60 s.
+  void set_delta_time(float delta_time) { delta_time_ = delta_time; }
+
+  void set_frame_limit(std::uint64_t frame_limit) {
+    frame_limit_ = frame_limit;
+  }
+
+  /// @brief Enables the digest of the draw data in stats(), e.g. to compare
+  /// frames with golden files. Positions are rounded to 1/16 pixel and
+  /// texture ids are left out, so the digest only changes with what would be
+  /// drawn.
+  void set_hash_draw_data(bool enabled) { hash_draw_data_ = enabled; }
+
+  std::uint64_t frame_count() const { return frame_count_; }
+  const FrameStats &stats() const { return stats_; }
+
+ private:
+  bool initialized_ = false;
+  float delta_time_ = 1.0f / 60.0f;
+  std::uint64_t frame_limit_ = 0;
+  std::uint64_t frame_count_ = 0;
+  bool hash_draw_data_ = false;
+  FrameStats stats_;
+};
+
+}  // namespace backend
+
+}  // namespace visco
+
+}  // namespace spauly
+
+#endif  // SPAULY_VISCO_BACKEND_HEADLESS_BACKEND_H
@@ -0,0 +1,111 @@
+// Visco Correct Desktop - Correction factors for centrifugal pumps
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Visco-Correct-Desktop>
+#ifndef SPAULY_VISCO_BACKEND_SCENARIO_H
+#define SPAULY_VISCO_BACKEND_SCENARIO_H
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "spauly/visco/application.h"
+#include "spauly/visco/backend/headless_backend.h"
+
+namespace spauly {
+namespace visco {
+namespace backend {
+
+/// @brief Replays a scripted input sequence into an Application on a
+/// HeadlessBackend and records what it produced, so runs can be compared
+/// with golden files.
+///
+/// A script has one command per line, '#' starts a comment:
+///
+///     frames <n>         Renders n frames.
+///     mouse <x> <y>      Moves the mouse.
+///     click <x> <y>      Moves the mouse, presses and releases the left
+///                        button.
+///     text <characters>  Types the rest of the line.
+///     key [ctrl+]<name>  Presses and releases Enter, Tab, Backspace,
+///                        Delete, Escape or a letter.
+///     inputs <Q> <H> <v> <density> [<Q unit> <H unit> <v unit> <d unit>]
+///                        Sets the inputs of the active project. Units are
+///                        the indices in the unit combos.
+///     calculate          Calculates the active project.
+///     project            Adds a project.
+///     wait               Waits for all jobs, e.g. the sweep of the graph,
+///                        and hands their results to the layers.
+///     check              Records the draw data of the last frame.
+///
+/// Input is queued and handled by the following frames, ImGui spreads a
+/// press and its release over two frames. After the last command the
+/// results of all projects are recorded.
+class ScenarioRunner {
+ public:
+  /// @param backend Must be initialized. The digest of the draw data is
+  /// enabled on it.
+  ScenarioRunner(HeadlessBackend &backend, Application &app);
+  ~ScenarioRunner() = default;
+
+  /// @brief Runs script from its first line.
+  /// @return Returns false if a command is invalid, see error().
+  bool Run(std::string_view script);
+
+  /// @brief Returns the recorded checks and project results, one per line.
+  const std::string &snapshot() const { return snapshot_; }
+
+  /// @brief Returns the CPU time of every rendered frame in microseconds.
+  const std::vector<double> &frame_times() const { return frame_times_; }
+
+  /// @brief Returns the line and reason of the last failed Run().
+  const std::string &error() const { return error_; }
+
+ private:
+  /// @brief Executes one line of a script.
+  /// @return Returns false with error_ set if it is invalid.
+  bool Execute(std::string_view line);
+
+  void RenderFrames(std::size_t count);
+  bool WaitForJobs();
+  void RecordDrawData();
+  void RecordResults();
+
+  HeadlessBackend &backend_;
+  Application &app_;
+
+  std::string snapshot_;
+  std::vector<double> frame_times_;
+  std::string error_;
+  std::size_t checks_ = 0;
+};
+
+/// @brief Compares a snapshot with its golden file line by line. Numbers
+/// are equal within a relative tolerance of 1e-9, everything else has to
+/// match exactly.
+/// @param message Set to the first difference.
+/// @return Returns true if both match.
+bool CompareSnapshot(std::string_view golden, std::string_view snapshot,
+                     std::string &message);
+
+}  // namespace backend
+
+}  // namespace visco
+
+}  // namespace spauly
+
+#endif  // SPAULY_VISCO_BACKEND_SCENARIO_H
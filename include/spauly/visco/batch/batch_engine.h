@@ -0,0 +1,104 @@
+// Visco Correct Desktop - Correction factors for centrifugal pumps
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Visco-Correct-Desktop>
+#ifndef SPAULY_VISCO_BATCH_BATCH_ENGINE_H
+#define SPAULY_VISCO_BATCH_BATCH_ENGINE_H
+
+#include <cstddef>
+#include <span>
+#include <vector>
+
+#include "spauly/vccore/calculator.h"
+#include "spauly/vccore/data.h"
+#include "spauly/visco/batch/correction_grid.h"
+#include "spauly/visco/batch/row_io.h"
+#include "spauly/visco/batch/soa_batch.h"
+#include "spauly/visco/batch/thread_pool.h"
+
+namespace spauly {
+namespace visco {
+namespace batch {
+
+/// @brief Runs vccore::Calculator over large inputs on a work-stealing thread
+/// pool. Every worker uses its own calculator instance and writes its results
+/// directly to the output index of the input, so the output order always
+/// matches the input order regardless of the thread count.
+class BatchEngine {
+ public:
+  static constexpr std::size_t kDefaultChunkSize = 4096;
+
+  /// @param thread_count The number of worker threads. Zero uses one worker
+  /// per hardware thread.
+  explicit BatchEngine(std::size_t thread_count = 0);
+  ~BatchEngine() = default;
+
+  /// @brief Calculates the correction factors for params that all share the
+  /// same units.
+  /// @return Returns false if out is smaller than params.
+  bool Calculate(std::span<const vccore::Parameters> params,
+                 const vccore::Units &units,
+                 std::span<vccore::CorrectionFactors> out);
+
+  /// @brief Calculates the correction factors for operating points with
+  /// individual units.
+  /// @return Returns false if out is smaller than points.
+  bool Calculate(std::span<const OperatingPoint> points,
+                 std::span<vccore::CorrectionFactors> out);
+
+  /// @brief Calculates the correction factors for column batches using the
+  /// SoA path (or the grid, see SetMode()) on every worker.
+  /// @return Returns false if the column sizes do not match.
+  bool Calculate(const SoaInput &in, const vccore::Units &units,
+                 const SoaOutput &out);
+
+  /// @brief Selects exact or grid interpolated calculation for all following
+  /// batches. The grid must outlive the engine or be reset to null.
+  void SetMode(CalculationMode mode, const CorrectionGrid *grid = nullptr);
+  CalculationMode mode() const { return mode_; }
+
+  /// @brief Sets the number of points each task processes.
+  void set_chunk_size(std::size_t chunk_size) {
+    chunk_size_ = (chunk_size == 0) ? kDefaultChunkSize : chunk_size;
+  }
+  std::size_t chunk_size() const { return chunk_size_; }
+
+  /// @brief Returns the number of worker threads.
+  std::size_t thread_count() const { return pool_.size(); }
+
+  /// @brief Gives access to the pool, e.g. to run related work on it.
+  ThreadPool &pool() { return pool_; }
+
+ private:
+  // Padded so that neighbouring workers do not share a cache line
+  struct alignas(64) WorkerCalculator {
+    vccore::Calculator calculator;
+    GridCalculator grid;
+  };
+
+  ThreadPool pool_;
+  std::vector<WorkerCalculator> calculators_;
+  std::size_t chunk_size_ = kDefaultChunkSize;
+  CalculationMode mode_ = CalculationMode::kExact;
+};
+
+}  // namespace batch
+
+}  // namespace visco
+
+}  // namespace spauly
+
+#endif  // SPAULY_VISCO_BATCH_BATCH_ENGINE_H
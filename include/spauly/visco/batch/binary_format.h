@@ -0,0 +1,185 @@
+// Visco Correct Desktop - Correction factors for centrifugal pumps
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Visco-Correct-Desktop>
+#ifndef SPAULY_VISCO_BATCH_BINARY_FORMAT_H
+#define SPAULY_VISCO_BATCH_BINARY_FORMAT_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "spauly/vccore/data.h"
+#include "spauly/visco/batch/mapped_file.h"
+#include "spauly/visco/batch/row_io.h"
+#include "spauly/visco/batch/soa_batch.h"
+
+namespace spauly {
+namespace visco {
+namespace batch {
+
+// Binary datasets (.vcdb) store operating points or results column by column
+// so that a mapped file can be handed to SoaCalculator without any parsing.
+// All values are little-endian:
+//
+//   file header   magic "VCDB", uint32 version, uint32 kind,
+//                 uint32 block rows, uint64 rows, uint64 blocks  (32 bytes)
+//   block header  uint32 rows, uint8 units[4], uint64 column bytes (16 bytes)
+//   columns       inputs:  flowrate, total_head, viscosity, density (double)
+//                 results: eta, q, h[0..3] (double), error_flag (int32)
+//
+// Every block is followed by its columns, each padded to 8 bytes so that all
+// doubles stay aligned inside the mapping. All rows of an input block share
+// the units stored in the block header.
+
+constexpr std::uint32_t kDatasetVersion = 1;
+
+/// @brief The default maximum number of rows per block.
+constexpr std::size_t kDefaultBlockRows = 1 << 16;
+
+/// @brief What a dataset file contains.
+enum class DatasetKind : std::uint32_t { kInputs = 1, kResults = 2 };
+
+/// @brief Read-only result columns of one block.
+struct ResultColumns {
+  std::span<const double> eta;
+  std::span<const double> q;
+  std::array<std::span<const double>, 4> h;
+  std::span<const std::int32_t> error_flag;
+
+  std::size_t size() const { return eta.size(); }
+
+  /// @brief Returns the factors of a single row.
+  vccore::CorrectionFactors at(std::size_t row) const;
+};
+
+/// @brief Returns true if the file at path starts with the dataset magic.
+bool IsDatasetFile(const std::string &path);
+
+/// @brief Streams rows into a dataset file. Only one block is buffered at a
+/// time, so the memory use does not depend on the number of rows. Input rows
+/// with different units than the current block start a new block.
+class DatasetWriter {
+ public:
+  DatasetWriter() = default;
+  ~DatasetWriter() { Close(); }
+
+  DatasetWriter(const DatasetWriter &) = delete;
+  DatasetWriter &operator=(const DatasetWriter &) = delete;
+
+  /// @brief Creates or truncates the file at path.
+  /// @return Returns false if the file can not be created or the host is not
+  /// little-endian.
+  bool Open(const std::string &path, DatasetKind kind,
+            std::size_t block_rows = kDefaultBlockRows);
+
+  /// @brief Appends one operating point to an inputs dataset.
+  bool Append(const OperatingPoint &point);
+
+  /// @brief Appends column data that shares units to an inputs dataset.
+  bool Append(const SoaInput &in, const vccore::Units &units);
+
+  /// @brief Appends one result row to a results dataset.
+  bool Append(const vccore::CorrectionFactors &factors);
+
+  /// @brief Appends all rows of out to a results dataset.
+  bool Append(const SoaOutput &out);
+
+  /// @brief Writes the last block and the final row count.
+  /// @return Returns false if any write failed.
+  bool Close();
+
+  std::uint64_t rows() const { return rows_; }
+  bool is_open() const { return file_ != nullptr; }
+
+ private:
+  bool FlushBlock();
+
+  std::FILE *file_ = nullptr;
+  DatasetKind kind_ = DatasetKind::kInputs;
+  std::size_t block_rows_ = kDefaultBlockRows;
+  vccore::Units units_;
+  std::array<std::vector<double>, 6> columns_;
+  std::vector<std::int32_t> flags_;
+  std::size_t pending_ = 0;
+  std::uint64_t rows_ = 0;
+  std::uint64_t blocks_ = 0;
+  bool failed_ = false;
+};
+
+/// @brief Reads a dataset through a memory mapping. The blocks are returned as
+/// spans into the mapping (zero copy) and the pages of a block are released
+/// once the reader moves on, so even datasets larger than the RAM stream with
+/// flat memory use. The spans stay valid until the next call to NextBlock().
+class DatasetReader {
+ public:
+  DatasetReader() = default;
+  ~DatasetReader() = default;
+
+  /// @brief Maps the file and checks its header.
+  /// @return Returns false if the file is missing or not a dataset.
+  bool Open(const std::string &path);
+
+  /// @brief Returns the next block of an inputs dataset.
+  /// @return Returns false at the end of the file or if the block is
+  /// malformed, use Failed() to distinguish both.
+  bool NextBlock(vccore::Units &units, SoaInput &columns);
+
+  /// @brief Returns the next block of a results dataset.
+  bool NextBlock(ResultColumns &columns);
+
+  /// @brief Starts again at the first block.
+  void Rewind();
+
+  DatasetKind kind() const { return kind_; }
+  std::size_t block_rows() const { return block_rows_; }
+
+  /// @brief Returns the row count stored in the header. It is zero for files
+  /// whose writer was not closed.
+  std::uint64_t rows() const { return rows_; }
+
+  bool Failed() const { return failed_; }
+
+ private:
+  /// @brief Validates the block at offset_ and advances to the next one.
+  /// @return Returns a pointer to the columns or null.
+  const unsigned char *Advance(DatasetKind kind, std::uint32_t &rows,
+                               vccore::Units &units);
+
+  MappedFile file_;
+  DatasetKind kind_ = DatasetKind::kInputs;
+  std::size_t block_rows_ = 0;
+  std::uint64_t rows_ = 0;
+  std::size_t offset_ = 0;
+  std::size_t released_ = 0;
+  bool failed_ = false;
+};
+
+/// @brief Converts CSV/TSV rows into an inputs dataset.
+/// @return Returns false if the input is malformed or writing failed.
+bool ConvertRows(RowReader &reader, DatasetWriter &writer);
+
+}  // namespace batch
+
+}  // namespace visco
+
+}  // namespace spauly
+
+#endif  // SPAULY_VISCO_BATCH_BINARY_FORMAT_H
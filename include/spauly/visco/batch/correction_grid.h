@@ -0,0 +1,187 @@
+// Visco Correct Desktop - Correction factors for centrifugal pumps
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Visco-Correct-Desktop>
+#ifndef SPAULY_VISCO_BATCH_CORRECTION_GRID_H
+#define SPAULY_VISCO_BATCH_CORRECTION_GRID_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "spauly/vccore/calculator.h"
+#include "spauly/vccore/data.h"
+#include "spauly/visco/batch/soa_batch.h"
+
+namespace spauly {
+namespace visco {
+namespace batch {
+
+class BatchEngine;
+
+/// @brief Selects how a GridCalculator evaluates a point.
+enum class CalculationMode {
+  kExact,  ///< Always call vccore::Calculator.
+  kGrid    ///< Interpolate in the precomputed grid where possible.
+};
+
+/// @brief Largest deviation of the interpolated factors from the exact
+/// calculator over a set of sample points. It is an estimate, not a bound:
+/// points between the samples may deviate further.
+struct GridError {
+  double eta = 0.0;
+  double q = 0.0;
+  double h = 0.0;  ///< Maximum over the four h factors.
+  std::size_t samples = 0;
+};
+
+/// @brief Correction factors tabulated over the valid domain of the chart.
+/// The nodes are spaced logarithmically in Q (6 - 2000 m^3/h), H (5 - 200 m)
+/// and v (10 - 4000 mm^2/s), matching the log scales of the Hydraulic
+/// Institute chart, and looked up with trilinear interpolation in log space.
+/// The log coordinate is the piecewise linear log2 read from the IEEE 754
+/// bits, so a lookup needs no transcendental function. The axes start at a
+/// power of two and use a whole number of cells per octave, so the kinks of
+/// that coordinate always fall onto nodes.
+///
+/// Error estimate: the interpolation is exact at the nodes and usually
+/// deviates most near the cell centres. Build() therefore evaluates the exact
+/// calculator in the centre of every cell and stores the largest absolute
+/// deviation per factor, see error(). This is a sampled estimate, not a
+/// guaranteed bound; Validate() samples further points and a finer grid can
+/// be built if it is too coarse for a use case. Cells whose corners carry an
+/// error flag of the core are never interpolated, Lookup() reports them as
+/// misses so the caller falls back to the exact calculator.
+class CorrectionGrid {
+ public:
+  static constexpr std::size_t kDefaultCellsPerOctave = 8;
+
+  CorrectionGrid() = default;
+  ~CorrectionGrid() = default;
+
+  /// @brief Tabulates the chart. With an engine the nodes are calculated on
+  /// its thread pool.
+  /// @param cells_per_octave The resolution, the default yields 73 x 49 x 73
+  /// nodes (8.4 MB).
+  /// @return Returns false if cells_per_octave is zero or too large.
+  bool Build(std::size_t cells_per_octave = kDefaultCellsPerOctave,
+             BatchEngine *engine = nullptr);
+
+  /// @brief Compares samples random points against the exact calculator.
+  GridError Validate(std::size_t samples, std::uint64_t seed = 42) const;
+
+  /// @brief Writes the grid to a little-endian binary file.
+  /// @return Returns false if the file could not be written.
+  bool Save(const std::string &path) const;
+
+  /// @brief Loads a grid written by Save().
+  /// @return Returns false if the file is missing or malformed.
+  bool Load(const std::string &path);
+
+  /// @brief Interpolates the factors of a point given in canonical units
+  /// (m^3/h, m, mm^2/s). The point must be inside the chart.
+  /// @return Returns false if the cell can not be interpolated.
+  bool Lookup(double flowrate, double total_head, double viscosity,
+              vccore::CorrectionFactors &result) const;
+
+  bool empty() const { return nodes_.empty(); }
+  /// @brief Returns the error sampled at the cell centres by Build().
+  const GridError &error() const { return error_; }
+  std::array<std::size_t, 3> dimensions() const {
+    return {axes_[0].count, axes_[1].count, axes_[2].count};
+  }
+  std::size_t cells_per_octave() const { return cells_per_octave_; }
+
+ private:
+  // eta, q, h[0..3], error flag and padding to 32 bytes per node
+  static constexpr std::size_t kNodeStride = 8;
+  static constexpr std::size_t kFlagOffset = 6;
+
+  struct Axis {
+    double log_min = 0.0;
+    double inv_step = 0.0;  // nodes per unit of log2(x)
+    double step = 0.0;
+    std::size_t count = 0;
+
+    void Init(double min, double max, std::size_t cells_per_octave);
+    /// @brief Returns x at the (fractional) node index.
+    double Value(double index) const;
+    /// @brief Returns the lower node index and the fraction within the cell.
+    std::size_t Locate(double x, double &fraction) const;
+  };
+
+  std::size_t NodeIndex(std::size_t i, std::size_t j, std::size_t k) const {
+    return ((i * axes_[1].count + j) * axes_[2].count + k) * kNodeStride;
+  }
+
+  void InitAxes(std::size_t cells_per_octave);
+
+  std::size_t cells_per_octave_ = 0;
+  std::array<Axis, 3> axes_;
+  std::vector<float> nodes_;
+  GridError error_;
+};
+
+/// @brief Calculates correction factors either exactly or from a
+/// CorrectionGrid, selected per call. Only points inside the chart are
+/// interpolated, all others are handed to vccore::Calculator in their own
+/// units, so both modes report the same error flags.
+class GridCalculator {
+ public:
+  /// @param grid The grid to use for CalculationMode::kGrid. May be null or
+  /// empty, in which case every call is exact.
+  explicit GridCalculator(const CorrectionGrid *grid = nullptr) : grid_(grid) {}
+  ~GridCalculator() = default;
+
+  vccore::CorrectionFactors Calculate(const vccore::Parameters &params,
+                                      const vccore::Units &units,
+                                      CalculationMode mode);
+
+  /// @brief Column batch version, see SoaCalculator.
+  /// @return Returns false if the column sizes do not match.
+  bool Calculate(const SoaInput &in, const vccore::Units &units,
+                 const SoaOutput &out, CalculationMode mode);
+
+  /// @brief Operating points with individual units, see SoaCalculator.
+  /// @return Returns false if out is smaller than points.
+  bool Calculate(std::span<const OperatingPoint> points,
+                 std::span<vccore::CorrectionFactors> out,
+                 CalculationMode mode);
+
+  void set_grid(const CorrectionGrid *grid) { grid_ = grid; }
+
+ private:
+  const CorrectionGrid *grid_ = nullptr;
+  vccore::Calculator calculator_;
+  SoaCalculator soa_calculator_;
+
+  // Normalised block of the grid path
+  std::vector<double> flowrate_;
+  std::vector<double> total_head_;
+  std::vector<double> viscosity_;
+  std::vector<std::int32_t> flags_;
+};
+
+}  // namespace batch
+
+}  // namespace visco
+
+}  // namespace spauly
+
+#endif  // SPAULY_VISCO_BATCH_CORRECTION_GRID_H
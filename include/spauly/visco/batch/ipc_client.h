@@ -0,0 +1,81 @@
+// Visco Correct Desktop - Correction factors for centrifugal pumps
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Visco-Correct-Desktop>
+#ifndef SPAULY_VISCO_BATCH_IPC_CLIENT_H
+#define SPAULY_VISCO_BATCH_IPC_CLIENT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "spauly/vccore/data.h"
+#include "spauly/visco/batch/binary_format.h"
+#include "spauly/visco/batch/ipc_protocol.h"
+#include "spauly/visco/batch/soa_batch.h"
+
+namespace spauly {
+namespace visco {
+namespace batch {
+
+/// @brief Blocking client for IpcServer. Requests are sent straight from the
+/// caller's columns and responses received into a buffer that is allocated
+/// once, so neither direction copies or allocates per request.
+class IpcClient {
+ public:
+  IpcClient();
+  ~IpcClient() { Close(); }
+
+  IpcClient(const IpcClient &) = delete;
+  IpcClient &operator=(const IpcClient &) = delete;
+
+  /// @brief Connects to the server listening at path.
+  /// @return Returns false if no server is listening there.
+  bool Connect(const std::string &path);
+
+  void Close();
+
+  /// @brief Sends one request of at most kIpcMaxFrameRows rows. Further
+  /// requests may be sent before the responses are received, see
+  /// kIpcMaxFrameRows for the limit. Density may be empty for kinematic
+  /// viscosity units.
+  /// @return Returns false if in is too large, the column sizes do not match
+  /// or the connection failed.
+  bool Send(std::uint32_t id, const SoaInput &in, const vccore::Units &units);
+
+  /// @brief Waits for the next response. The columns point into the
+  /// receive buffer and stay valid until the next call.
+  /// @return Returns false if the connection failed or the server sent a
+  /// malformed frame.
+  bool Receive(std::uint32_t &id, IpcStatus &status, ResultColumns &columns);
+
+  bool is_connected() const { return fd_ >= 0; }
+
+ private:
+  int fd_ = -1;
+  std::vector<std::uint64_t> buffer_;
+  // Sent in place of a missing density column
+  std::vector<double> zeros_;
+};
+
+}  // namespace batch
+
+}  // namespace visco
+
+}  // namespace spauly
+
+#endif  // SPAULY_VISCO_BATCH_IPC_CLIENT_H
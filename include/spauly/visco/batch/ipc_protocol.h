@@ -0,0 +1,114 @@
+// Visco Correct Desktop - Correction factors for centrifugal pumps
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Visco-Correct-Desktop>
+#ifndef SPAULY_VISCO_BATCH_IPC_PROTOCOL_H
+#define SPAULY_VISCO_BATCH_IPC_PROTOCOL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+
+#include "spauly/vccore/data.h"
+#include "spauly/visco/batch/unit_conversion.h"
+
+namespace spauly {
+namespace visco {
+namespace batch {
+
+// Other tools request correction factors from IpcServer over a Unix domain
+// socket. Every request and response is one frame of a 16 byte header
+// followed by its columns, all values little-endian:
+//
+//   request   magic "VCRQ", uint32 id, uint32 rows, uint8 units[4]
+//             flowrate, total_head, viscosity, density (double)
+//   response  magic "VCRS", uint32 id, uint32 rows, uint32 status
+//             eta, q, h[0..3] (double), error_flag (int32)
+//
+// The columns use the same layout as a dataset block (see binary_format.h),
+// the error flags are padded to 8 bytes. Requests are pipelined: a client may
+// send further requests before reading the responses, the server answers
+// every request in order and repeats its id.
+
+/// @brief The maximum number of rows per frame. The server buffers twice the
+/// results of a maximum frame per connection, so clients that pipeline should
+/// keep the rows of all unanswered requests at or below this limit.
+constexpr std::size_t kIpcMaxFrameRows = 1 << 14;
+
+/// @brief Outcome of one request, responses with an error carry no rows.
+enum class IpcStatus : std::uint32_t { kOk = 0, kInvalidUnits = 1 };
+
+struct IpcRequestHeader {
+  char magic[4];
+  std::uint32_t id;
+  std::uint32_t rows;
+  std::uint8_t units[4];
+};
+
+struct IpcResponseHeader {
+  char magic[4];
+  std::uint32_t id;
+  std::uint32_t rows;
+  std::uint32_t status;
+};
+
+static_assert(sizeof(IpcRequestHeader) == 16 &&
+                  sizeof(IpcResponseHeader) == 16,
+              "The frame headers must not contain padding");
+
+constexpr char kIpcRequestMagic[4] = {'V', 'C', 'R', 'Q'};
+constexpr char kIpcResponseMagic[4] = {'V', 'C', 'R', 'S'};
+
+/// @brief Returns the size of a request frame including its header.
+constexpr std::size_t IpcRequestBytes(std::size_t rows) {
+  return sizeof(IpcRequestHeader) + 4 * rows * sizeof(double);
+}
+
+/// @brief Returns the size of a response frame including its header.
+constexpr std::size_t IpcResponseBytes(std::size_t rows) {
+  return sizeof(IpcResponseHeader) + 6 * rows * sizeof(double) +
+         ((rows * sizeof(std::int32_t) + 7) & ~std::size_t{7});
+}
+
+/// @brief Encodes units in the order of the header bytes.
+constexpr void EncodeUnits(const vccore::Units &units, std::uint8_t out[4]) {
+  out[0] = static_cast<std::uint8_t>(units.flowrate);
+  out[1] = static_cast<std::uint8_t>(units.total_head);
+  out[2] = static_cast<std::uint8_t>(units.viscosity);
+  out[3] = static_cast<std::uint8_t>(units.density);
+}
+
+/// @brief Decodes the units of a request header.
+/// @return Returns false if any of the bytes is not a valid unit.
+constexpr bool DecodeUnits(const std::uint8_t in[4], vccore::Units &units) {
+  if (in[0] >= std::size(kFlowrateScale) ||
+      in[1] >= std::size(kTotalHeadScale) ||
+      in[2] >= std::size(kViscosityScale) || in[3] >= std::size(kDensityScale))
+    return false;
+  units.flowrate = static_cast<vccore::FlowrateUnit>(in[0]);
+  units.total_head = static_cast<vccore::TotalHeadUnit>(in[1]);
+  units.viscosity = static_cast<vccore::ViscosityUnit>(in[2]);
+  units.density = static_cast<vccore::DensityUnit>(in[3]);
+  return true;
+}
+
+}  // namespace batch
+
+}  // namespace visco
+
+}  // namespace spauly
+
+#endif  // SPAULY_VISCO_BATCH_IPC_PROTOCOL_H
@@ -0,0 +1,136 @@
+// Visco Correct Desktop - Correction factors for centrifugal pumps
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Visco-Correct-Desktop>
+#ifndef SPAULY_VISCO_BATCH_IPC_SERVER_H
+#define SPAULY_VISCO_BATCH_IPC_SERVER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "spauly/visco/batch/batch_engine.h"
+#include "spauly/visco/batch/correction_grid.h"
+#include "spauly/visco/batch/ipc_protocol.h"
+
+namespace spauly {
+namespace visco {
+namespace batch {
+
+/// @brief Serves Calculate requests from other local tools over a Unix domain
+/// socket (see ipc_protocol.h). A single thread multiplexes all connections
+/// with poll(), large frames are calculated on the BatchEngine pool. The
+/// request columns are calculated in place in the receive buffer and the
+/// results written directly into the send buffer, both are allocated once per
+/// connection slot and reused by later connections.
+///
+/// Unix domain sockets are not supported on Windows, there Listen() fails.
+class IpcServer {
+ public:
+  /// @brief The maximum number of clients served at the same time, further
+  /// connections are closed right away.
+  static constexpr std::size_t kMaxConnections = 32;
+
+  /// @param thread_count The number of BatchEngine workers, zero uses one per
+  /// hardware thread.
+  explicit IpcServer(std::size_t thread_count = 0);
+  ~IpcServer();
+
+  IpcServer(const IpcServer &) = delete;
+  IpcServer &operator=(const IpcServer &) = delete;
+
+  /// @brief Binds the socket to path. A stale socket file left behind by a
+  /// previous server is replaced.
+  /// @return Returns false if the socket can not be created or bound.
+  bool Listen(const std::string &path);
+
+  /// @brief Serves clients until Stop() is called.
+  /// @return Returns false if Listen() did not succeed or polling failed.
+  bool Serve();
+
+  /// @brief Makes Serve() return. Safe to call from other threads and from
+  /// signal handlers.
+  void Stop();
+
+  /// @brief Closes all connections and removes the socket file.
+  void Close();
+
+  /// @brief Selects exact or grid interpolated calculation, see
+  /// BatchEngine::SetMode().
+  void SetMode(CalculationMode mode, const CorrectionGrid *grid = nullptr);
+
+  /// @brief Returns the number of connected clients.
+  std::size_t connections() const { return active_; }
+
+  /// @brief Returns the number of rows calculated since Listen().
+  std::uint64_t rows_served() const { return rows_served_; }
+
+ private:
+  struct Connection {
+    int fd = -1;
+    // Stored as 8 byte words so that the columns of every frame are aligned
+    std::vector<std::uint64_t> in;
+    std::vector<std::uint64_t> out;
+    std::size_t in_begin = 0;
+    std::size_t in_end = 0;
+    std::size_t out_begin = 0;
+    std::size_t out_end = 0;
+    // The client shut down its sending side
+    bool eof = false;
+  };
+
+  void Accept();
+
+  /// @brief Reads what the socket has available. The end of the client's
+  /// stream only sets Connection::eof, the buffered requests are still
+  /// answered.
+  /// @return Returns false on a socket error.
+  bool Receive(Connection &connection);
+
+  /// @brief Answers all complete requests whose results fit into the send
+  /// buffer.
+  /// @return Returns false on a malformed frame.
+  bool Process(Connection &connection);
+
+  /// @brief Writes as much of the send buffer as the socket takes.
+  /// @return Returns false if the client disconnected.
+  bool Send(Connection &connection);
+
+  void Disconnect(Connection &connection);
+
+  BatchEngine engine_;
+  // Small frames are not worth a round trip through the pool
+  GridCalculator calculator_;
+
+  std::vector<Connection> connections_;
+  std::size_t active_ = 0;
+  std::uint64_t rows_served_ = 0;
+
+  std::string path_;
+  int listen_fd_ = -1;
+  int wake_fds_[2] = {-1, -1};
+  std::atomic<bool> stop_ = false;
+};
+
+}  // namespace batch
+
+}  // namespace visco
+
+}  // namespace spauly
+
+#endif  // SPAULY_VISCO_BATCH_IPC_SERVER_H
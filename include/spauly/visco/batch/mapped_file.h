@@ -0,0 +1,69 @@
+// Visco Correct Desktop - Correction factors for centrifugal pumps
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Visco-Correct-Desktop>
+#ifndef SPAULY_VISCO_BATCH_MAPPED_FILE_H
+#define SPAULY_VISCO_BATCH_MAPPED_FILE_H
+
+#include <cstddef>
+#include <string>
+
+namespace spauly {
+namespace visco {
+namespace batch {
+
+/// @brief A read-only memory mapping of a whole file. The pages are backed by
+/// the file itself, so the resident memory stays bounded by what the OS keeps
+/// cached, not by the file size.
+class MappedFile {
+ public:
+  MappedFile() = default;
+  ~MappedFile() { Close(); }
+
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  /// @brief Maps the file. Any previous mapping is closed first.
+  /// @return Returns false if the file could not be opened or mapped.
+  bool Open(const std::string &path);
+
+  /// @brief Unmaps the file.
+  void Close();
+
+  /// @brief Tells the OS that [offset, offset + size) is no longer needed so
+  /// the pages can be dropped early when streaming through large files.
+  void Release(std::size_t offset, std::size_t size);
+
+  const unsigned char *data() const { return data_; }
+  std::size_t size() const { return size_; }
+  bool is_open() const { return data_ != nullptr; }
+
+ private:
+  const unsigned char *data_ = nullptr;
+  std::size_t size_ = 0;
+#ifdef _WIN32
+  void *file_ = nullptr;
+  void *mapping_ = nullptr;
+#endif
+};
+
+}  // namespace batch
+
+}  // namespace visco
+
+}  // namespace spauly
+
+#endif  // SPAULY_VISCO_BATCH_MAPPED_FILE_H
@@ -0,0 +1,190 @@
+// Visco Correct Desktop - Correction factors for centrifugal pumps
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Visco-Correct-Desktop>
+#ifndef SPAULY_VISCO_BATCH_PARAMETRIC_STUDY_H
+#define SPAULY_VISCO_BATCH_PARAMETRIC_STUDY_H
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "spauly/vccore/data.h"
+#include "spauly/visco/batch/soa_batch.h"
+#include "spauly/visco/batch/thread_pool.h"
+
+namespace spauly {
+namespace visco {
+namespace batch {
+
+/// @brief The values one field of vccore::Parameters takes in a study.
+struct ParameterAxis {
+  std::vector<double> values;
+
+  /// @brief A single value.
+  static ParameterAxis Fixed(double value);
+
+  /// @brief steps values evenly spaced from first to last (both included).
+  static ParameterAxis Linear(double first, double last, std::size_t steps);
+
+  /// @brief steps values spaced evenly in log10 from first to last. first
+  /// and last must be positive.
+  static ParameterAxis Log(double first, double last, std::size_t steps);
+
+  std::size_t size() const { return values.size(); }
+};
+
+/// @brief Index of every field in StudyDefinition::axes.
+enum StudyField : std::size_t {
+  kStudyFlowrate = 0,
+  kStudyTotalHead,
+  kStudyViscosity,
+  kStudyDensity,
+  kStudyFieldCount
+};
+
+/// @brief A Cartesian product over the parameter axes in one unit
+/// combination. Row r enumerates the axes like digits of a number with
+/// flowrate as the most and density as the least significant digit.
+struct StudyDefinition {
+  std::array<ParameterAxis, kStudyFieldCount> axes;
+  vccore::Units units;
+
+  /// @brief Returns the number of rows of the product. Zero if any axis is
+  /// empty.
+  std::uint64_t rows() const;
+
+  /// @brief Returns the parameters of row.
+  vccore::Parameters PointAt(std::uint64_t row) const;
+};
+
+/// @brief Evaluates a study on a thread pool in blocks of kBlockRows. Blocks
+/// are computed in row order, but blocks passed to Request() are computed
+/// first, so the rows a table shows are available long before the rest of a
+/// large study. Results are written once per block and published through an
+/// atomic flag, so Get() can be called from the UI while the study runs.
+/// All results are kept in memory (52 bytes per row), larger inputs belong
+/// into the CLI which streams them.
+///
+/// The pool may be shared with other work: a block loop computes at most
+/// kBlocksPerTask blocks and then requeues itself behind the queued tasks.
+/// The loops keep the study alive, so it has to be owned by a
+/// std::shared_ptr and is never waited for on a worker.
+class ParametricStudy
+    : public std::enable_shared_from_this<ParametricStudy> {
+ public:
+  static constexpr std::size_t kBlockRows = 1024;
+  static constexpr std::size_t kBlocksPerTask = 16;
+  static constexpr std::uint64_t kMaxRows = std::uint64_t{1} << 22;
+
+  /// @param pool Runs the blocks. Must outlive the study; destroying it
+  /// without Cancel() runs the rest of the study first.
+  ParametricStudy(StudyDefinition definition, ThreadPool &pool);
+  ~ParametricStudy() = default;
+
+  ParametricStudy(const ParametricStudy &) = delete;
+  ParametricStudy &operator=(const ParametricStudy &) = delete;
+
+  /// @brief Starts one block loop per worker of the pool but one, which is
+  /// left to the other users of the pool. The study must be owned by a
+  /// std::shared_ptr.
+  /// @return Returns false if the study is empty or larger than kMaxRows.
+  bool Start();
+
+  /// @brief Computes the blocks of the rows [first, last) next. Replaces the
+  /// previous request, so a table can call it every frame with the rows it
+  /// shows.
+  void Request(std::uint64_t first, std::uint64_t last);
+
+  /// @brief Stops the computation after the blocks that are running.
+  void Cancel();
+
+  /// @brief Returns the parameters and, if already computed, the factors
+  /// of row.
+  /// @return Returns false if the row is not computed yet.
+  bool Get(std::uint64_t row, vccore::Parameters &params,
+           vccore::CorrectionFactors &factors) const;
+
+  /// @brief Writes inputs and results as CSV, one row per point. Computes
+  /// missing blocks first.
+  /// @return Returns false if the study was cancelled or a write failed.
+  bool ExportCsv(const std::string &path, char delimiter = ',');
+
+  /// @brief Writes the inputs and results as two binary datasets (.vcdb) in
+  /// row order. Computes missing blocks first.
+  /// @return Returns false if the study was cancelled or a write failed.
+  bool ExportDataset(const std::string &inputs_path,
+                     const std::string &results_path);
+
+  const StudyDefinition &definition() const { return definition_; }
+  std::uint64_t rows() const { return rows_; }
+  std::uint64_t rows_done() const {
+    return rows_done_.load(std::memory_order_relaxed);
+  }
+  bool done() const { return rows_done() == rows_; }
+  bool cancelled() const { return cancel_.load(std::memory_order_relaxed); }
+
+ private:
+  /// @brief Claims the next block, requested blocks first.
+  /// @return Returns false once all blocks are claimed or on cancel.
+  bool ClaimBlock(std::size_t &block);
+
+  /// @brief Claims and computes up to kBlocksPerTask blocks, then defers
+  /// itself to the pool while blocks are left.
+  void BlockLoop();
+
+  void ComputeBlock(std::size_t block, SoaCalculator &calculator,
+                    std::array<std::vector<double>, 4> &columns);
+
+  /// @brief Computes all blocks that are not claimed yet on the calling
+  /// thread and waits for the ones other threads are computing. Those never
+  /// wait for queued tasks, so this is safe on a worker of the pool.
+  bool Finish();
+
+  StudyDefinition definition_;
+  ThreadPool &pool_;
+  std::uint64_t rows_ = 0;
+  std::size_t blocks_ = 0;
+
+  SoaResults results_;
+  std::unique_ptr<std::atomic<bool>[]> block_done_;
+
+  std::mutex mutex_;
+  std::condition_variable computed_;
+  std::vector<bool> claimed_;
+  std::deque<std::size_t> requested_;
+  std::size_t next_block_ = 0;
+  // Blocks claimed but not computed yet
+  std::size_t computing_ = 0;
+
+  std::atomic<std::uint64_t> rows_done_ = 0;
+  std::atomic<bool> cancel_ = false;
+};
+
+}  // namespace batch
+
+}  // namespace visco
+
+}  // namespace spauly
+
+#endif  // SPAULY_VISCO_BATCH_PARAMETRIC_STUDY_H
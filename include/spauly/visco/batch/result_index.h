@@ -0,0 +1,84 @@
+// Visco Correct Desktop - Correction factors for centrifugal pumps
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Visco-Correct-Desktop>
+#ifndef SPAULY_VISCO_BATCH_RESULT_INDEX_H
+#define SPAULY_VISCO_BATCH_RESULT_INDEX_H
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "spauly/visco/batch/thread_pool.h"
+
+namespace spauly {
+namespace visco {
+namespace batch {
+
+// Large result sets are never reordered or copied to sort or filter them.
+// Instead a table keeps a permutation of the row numbers that passed its
+// filter, in the order they are shown, and looks up every visible row in the
+// columns through it.
+
+/// @brief Selects rows by their vccore::ErrorFlag bits.
+struct FlagFilter {
+  enum Mode : int { kAll = 0, kValid, kErrors };
+
+  Mode mode = kAll;
+  /// @brief With kErrors only rows that have any of these bits set pass.
+  std::int32_t bits = ~0;
+
+  bool Accepts(std::int32_t flag) const {
+    switch (mode) {
+      case kValid:
+        return flag == 0;
+      case kErrors:
+        return (flag & bits) != 0;
+      default:
+        return true;
+    }
+  }
+};
+
+/// @brief Sets above this size are sorted on the pool.
+constexpr std::size_t kParallelSortThreshold = 1 << 16;
+
+/// @brief Returns the numbers of the rows whose flags pass filter, in
+/// ascending order.
+std::vector<std::uint32_t> FilterRows(std::span<const std::int32_t> flags,
+                                      const FlagFilter &filter);
+
+/// @brief Orders rows by key[row]. Rows with equal keys keep ascending row
+/// numbers and NaN keys always come last, so the result does not depend on
+/// the thread count. Sorts (key, row) pairs instead of comparing through the
+/// permutation, which keeps the memory access sequential.
+/// @param pool Used for sets larger than kParallelSortThreshold, may be null.
+void SortRows(std::span<std::uint32_t> rows, std::span<const double> key,
+              bool descending, ThreadPool *pool = nullptr);
+
+/// @brief Orders rows by an integer column, e.g. the error flags.
+void SortRows(std::span<std::uint32_t> rows,
+              std::span<const std::int32_t> key, bool descending,
+              ThreadPool *pool = nullptr);
+
+}  // namespace batch
+
+}  // namespace visco
+
+}  // namespace spauly
+
+#endif  // SPAULY_VISCO_BATCH_RESULT_INDEX_H
@@ -0,0 +1,142 @@
+// Visco Correct Desktop - Correction factors for centrifugal pumps
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Visco-Correct-Desktop>
+#ifndef SPAULY_VISCO_BATCH_REVERSE_SOLVER_H
+#define SPAULY_VISCO_BATCH_REVERSE_SOLVER_H
+
+#include <array>
+#include <cstddef>
+#include <span>
+#include <vector>
+
+#include "spauly/vccore/calculator.h"
+#include "spauly/vccore/data.h"
+#include "spauly/visco/batch/parametric_study.h"
+#include "spauly/visco/batch/soa_batch.h"
+#include "spauly/visco/batch/thread_pool.h"
+
+namespace spauly {
+namespace visco {
+namespace batch {
+
+/// @brief The correction factor a reverse query aims at.
+enum FactorField : int {
+  kFactorEta = 0,
+  kFactorQ,
+  kFactorH06,
+  kFactorH08,
+  kFactorH10,
+  kFactorH12,
+  kFactorFieldCount
+};
+
+/// @brief Returns the value of field in factors.
+double FactorValue(const vccore::CorrectionFactors &factors,
+                   FactorField field);
+
+/// @brief Asks for the value of one input at which a correction factor
+/// reaches target, e.g. the highest viscosity at which eta stays above 0.7
+/// for a given flowrate and total head.
+struct SolverQuery {
+  /// @brief The fixed inputs. The field that is solved for is ignored.
+  vccore::Parameters params;
+  vccore::Units units;
+
+  StudyField variable = kStudyViscosity;
+  FactorField factor = kFactorEta;
+  double target = 0.7;
+
+  /// @brief The search interval of the variable in units.
+  double lower = 10.0;
+  double upper = 4000.0;
+
+  /// @brief Returns the highest crossing of the target in the interval if
+  /// true, the lowest otherwise.
+  bool highest = true;
+};
+
+struct SolverResult {
+  enum Status : int {
+    kSolved = 0,
+    /// @brief The factor does not cross the target inside the valid part of
+    /// the interval.
+    kNoCrossing,
+    /// @brief No point of the interval lies inside the chart.
+    kOutOfRange,
+    /// @brief The query itself is malformed, e.g. lower >= upper.
+    kInvalidQuery
+  };
+
+  Status status = kInvalidQuery;
+  /// @brief The solution in the units of the query, NaN if not solved.
+  double value = 0.0;
+  /// @brief The factors at value.
+  vccore::CorrectionFactors factors;
+  /// @brief The number of calculator evaluations the query took.
+  std::size_t evaluations = 0;
+};
+
+/// @brief Inverts vccore::Calculator over one input. The interval is first
+/// sampled in a single SoA batch to find the sign changes of
+/// factor - target between neighbouring valid samples (log spaced for
+/// intervals over more than a decade). The chosen bracket is then narrowed
+/// with the ITP method, which converges superlinearly on smooth factors but
+/// never needs more steps than bisection. A query typically costs 20 to 40
+/// evaluations. A ReverseSolver is not thread safe, use one per thread.
+class ReverseSolver {
+ public:
+  static constexpr std::size_t kDefaultSamples = 16;
+  static constexpr double kDefaultTolerance = 1e-9;
+
+  /// @param samples The number of samples of the bracketing batch.
+  /// @param tolerance The width of the final bracket relative to the
+  /// interval.
+  explicit ReverseSolver(std::size_t samples = kDefaultSamples,
+                         double tolerance = kDefaultTolerance);
+  ~ReverseSolver() = default;
+
+  SolverResult Solve(const SolverQuery &query);
+
+ private:
+  /// @brief Calculates the factors with the variable set to x.
+  vccore::CorrectionFactors Evaluate(const SolverQuery &query, double x);
+
+  std::size_t samples_;
+  double tolerance_;
+  std::size_t evaluations_ = 0;
+
+  vccore::Calculator calculator_;
+  SoaCalculator soa_;
+
+  // Bracketing batch
+  std::array<std::vector<double>, kStudyFieldCount> columns_;
+  SoaResults results_;
+  std::vector<double> residuals_;
+};
+
+/// @brief Solves all queries on the pool, results[i] belongs to queries[i].
+/// @return Returns false if results is smaller than queries.
+bool SolveAll(std::span<const SolverQuery> queries,
+              std::span<SolverResult> results, ThreadPool &pool);
+
+}  // namespace batch
+
+}  // namespace visco
+
+}  // namespace spauly
+
+#endif  // SPAULY_VISCO_BATCH_REVERSE_SOLVER_H
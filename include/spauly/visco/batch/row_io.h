@@ -0,0 +1,134 @@
+// Visco Correct Desktop - Correction factors for centrifugal pumps
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Visco-Correct-Desktop>
+#ifndef SPAULY_VISCO_BATCH_ROW_IO_H
+#define SPAULY_VISCO_BATCH_ROW_IO_H
+
+#include <cstddef>
+#include <cstdio>
+#include <string_view>
+#include <vector>
+
+#include "spauly/vccore/data.h"
+
+namespace spauly {
+namespace visco {
+namespace batch {
+
+/// @brief One row of a batch input: the operating point and its units.
+struct OperatingPoint {
+  vccore::Parameters params;
+  vccore::Units units;
+};
+
+/// @brief Parses a flowrate unit token (e.g. "m^3/h", "l/min", "GPM" or the
+/// combo index "0".."2"). Matching is case insensitive.
+/// @return Returns false if the token is not a known unit.
+bool ParseFlowrateUnit(std::string_view token, vccore::FlowrateUnit &unit);
+
+/// @brief Parses a total head unit token ("m", "ft" or "0".."1").
+bool ParseTotalHeadUnit(std::string_view token, vccore::TotalHeadUnit &unit);
+
+/// @brief Parses a viscosity unit token ("mm^2/s", "cSt", "cP", "mPas" or
+/// "0".."3").
+bool ParseViscosityUnit(std::string_view token, vccore::ViscosityUnit &unit);
+
+/// @brief Parses a density unit token ("g/l", "kg/m^3" or "0".."1").
+bool ParseDensityUnit(std::string_view token, vccore::DensityUnit &unit);
+
+/// @brief Streams operating points from a CSV/TSV file. Rows have the layout
+/// `flowrate, head, viscosity, density[, flow unit, head unit, viscosity unit,
+/// density unit]`. Missing unit columns fall back to the default units. The
+/// delimiter (',', ';' or tab) is detected from the first line, which is
+/// treated as header if none of its fields is a number. Any other malformed
+/// line fails the read. Blank lines and lines starting with '#' are skipped.
+class RowReader {
+ public:
+  /// @param file The stream to read from. Ownership stays with the caller.
+  /// @param default_units The units used for rows without unit columns.
+  explicit RowReader(std::FILE *file, const vccore::Units &default_units = {});
+  ~RowReader() = default;
+
+  /// @brief Reads up to max_rows rows and appends them to out.
+  /// @return Returns the number of rows read. Zero signals end of input or an
+  /// error, use Failed() to distinguish both.
+  std::size_t Read(std::vector<OperatingPoint> &out, std::size_t max_rows);
+
+  /// @brief Returns true if a malformed row was encountered.
+  bool Failed() const { return failed_; }
+
+  /// @brief Returns the line number of the last processed line (1-based).
+  std::size_t line() const { return line_; }
+
+ private:
+  /// @brief Moves the unread rest to the front of the buffer and fills the
+  /// remaining space from the file.
+  /// @return Returns false if no more data could be read.
+  bool Refill();
+
+  /// @brief Parses a single line without line terminator.
+  /// @return Returns false if the line is malformed.
+  bool ParseLine(std::string_view line, OperatingPoint &point);
+
+  std::FILE *file_ = nullptr;
+  vccore::Units default_units_;
+  std::vector<char> buffer_;
+  std::size_t begin_ = 0;
+  std::size_t end_ = 0;
+  std::size_t line_ = 0;
+  char delimiter_ = '\0';
+  bool eof_ = false;
+  bool failed_ = false;
+};
+
+/// @brief Buffered writer for calculation results. Each row contains
+/// `eta, q, h(0.6), h(0.8), h(1.0), h(1.2), error_flag`.
+class RowWriter {
+ public:
+  /// @param file The stream to write to. Ownership stays with the caller.
+  /// @param delimiter The column delimiter.
+  explicit RowWriter(std::FILE *file, char delimiter = ',');
+  ~RowWriter() { Flush(); }
+
+  /// @brief Writes the column header.
+  void WriteHeader();
+
+  /// @brief Appends one result row.
+  void Write(const vccore::CorrectionFactors &factors);
+
+  /// @brief Flushes the internal buffer to the file.
+  /// @return Returns false if the write failed.
+  bool Flush();
+
+ private:
+  void Append(std::string_view text);
+  void AppendDouble(double value);
+
+  std::FILE *file_ = nullptr;
+  char delimiter_ = ',';
+  std::vector<char> buffer_;
+  std::size_t size_ = 0;
+  bool failed_ = false;
+};
+
+}  // namespace batch
+
+}  // namespace visco
+
+}  // namespace spauly
+
+#endif  // SPAULY_VISCO_BATCH_ROW_IO_H
@@ -0,0 +1,164 @@
+// Visco Correct Desktop - Correction factors for centrifugal pumps
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Visco-Correct-Desktop>
+#ifndef SPAULY_VISCO_BATCH_SOA_BATCH_H
+#define SPAULY_VISCO_BATCH_SOA_BATCH_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "spauly/vccore/calculator.h"
+#include "spauly/vccore/data.h"
+#include "spauly/visco/batch/row_io.h"
+#include "spauly/visco/batch/unit_conversion.h"
+
+namespace spauly {
+namespace visco {
+namespace batch {
+
+/// @brief Column views of a batch of operating points that share one
+/// vccore::Units combination. All columns must have the same size, density
+/// may be empty if the viscosity unit is kinematic.
+struct SoaInput {
+  std::span<const double> flowrate;
+  std::span<const double> total_head;
+  std::span<const double> viscosity;
+  std::span<const double> density;
+
+  std::size_t size() const { return flowrate.size(); }
+
+  /// @brief Returns the rows [offset, offset + count).
+  SoaInput subspan(std::size_t offset, std::size_t count) const;
+};
+
+/// @brief Column views the results are written to. Every column must hold at
+/// least as many elements as the input.
+struct SoaOutput {
+  std::span<double> eta;
+  std::span<double> q;
+  std::array<std::span<double>, 4> h;
+  std::span<std::int32_t> error_flag;
+
+  std::size_t size() const { return eta.size(); }
+
+  /// @brief Returns the rows [offset, offset + count).
+  SoaOutput subspan(std::size_t offset, std::size_t count) const;
+};
+
+/// @brief Owning column storage for SoaOutput.
+struct SoaResults {
+  std::vector<double> eta;
+  std::vector<double> q;
+  std::array<std::vector<double>, 4> h;
+  std::vector<std::int32_t> error_flag;
+
+  void resize(std::size_t size);
+  std::size_t size() const { return eta.size(); }
+
+  SoaOutput view();
+};
+
+/// @brief Returns the name of the kernel the SoA path was compiled with
+/// ("avx2", "sse2" or "scalar").
+const char *SoaKernelName();
+
+/// @brief Converts in into the canonical units and checks the chart ranges
+/// (see CheckRanges()). The kernel is specialised for units and selected once
+/// for the whole batch, unknown units flag every row. Every output must hold
+/// at least in.size() values, density may only be empty for kinematic
+/// viscosity units.
+void NormaliseColumns(const SoaInput &in, const vccore::Units &units,
+                      std::span<double> flowrate, std::span<double> total_head,
+                      std::span<double> viscosity,
+                      std::span<std::int32_t> flags);
+
+/// @brief Calculates correction factors for column batches. This is a
+/// grouping and conversion layer, not a vectorised chart: unit normalisation
+/// and the range checks run as SIMD kernels over blocks of the input, but
+/// every point inside the chart is still evaluated by its own
+/// vccore::Calculator call in the canonical units. Its throughput is
+/// therefore bounded by the core, the kernels only take the unit handling
+/// off the per point path.
+///
+/// Points outside the chart and units without a kernel (see IsValidUnits())
+/// are handed over in their own units, so their factors and error flags are
+/// exactly the ones of vccore::Calculator. Points inside the chart may
+/// differ from it by the rounding of the unit conversion.
+/// A SoaCalculator is not thread safe, use one instance per thread.
+class SoaCalculator {
+ public:
+  SoaCalculator();
+  ~SoaCalculator() = default;
+
+  /// @brief Calculates the correction factors for all rows of in.
+  /// @return Returns false if the sizes of the columns do not match.
+  bool Calculate(const SoaInput &in, const vccore::Units &units,
+                 const SoaOutput &out);
+
+  /// @brief Calculates operating points with individual units. The points
+  /// are sorted by unit combination and every combination runs as one column
+  /// batch through its specialised kernel, so nothing is converted or
+  /// branched on per point.
+  /// @return Returns false if out is smaller than points.
+  bool Calculate(std::span<const OperatingPoint> points,
+                 std::span<vccore::CorrectionFactors> out);
+
+ private:
+  /// @brief Groups and calculates a cache sized window of points.
+  void CalculateWindow(std::span<const OperatingPoint> points,
+                       std::span<vccore::CorrectionFactors> out);
+
+  /// @brief Calculates the rows of points one by one in their own units, for
+  /// units without a kernel. out is indexed by row as well.
+  void CalculateUnknownUnits(std::span<const OperatingPoint> points,
+                             std::span<const std::uint32_t> rows,
+                             std::span<vccore::CorrectionFactors> out);
+
+  /// @brief Calculates the rows of points that share units, out is indexed
+  /// by row as well.
+  void CalculateGroup(std::span<const OperatingPoint> points,
+                      std::span<const std::uint32_t> rows,
+                      const vccore::Units &units,
+                      std::span<vccore::CorrectionFactors> out);
+
+  vccore::Calculator calculator_;
+
+  // Normalised block scratch
+  std::vector<double> flowrate_;
+  std::vector<double> total_head_;
+  std::vector<double> viscosity_;
+  std::vector<std::int32_t> flags_;
+
+  // Grouping of mixed units
+  std::vector<std::uint8_t> combinations_;
+  std::vector<std::uint32_t> order_;
+  std::vector<std::uint32_t> identity_;
+  std::array<std::vector<double>, 4> gathered_;
+  SoaResults gathered_results_;
+  std::vector<vccore::CorrectionFactors> window_;
+};
+
+}  // namespace batch
+
+}  // namespace visco
+
+}  // namespace spauly
+
+#endif  // SPAULY_VISCO_BATCH_SOA_BATCH_H
@@ -0,0 +1,110 @@
+// Visco Correct Desktop - Correction factors for centrifugal pumps
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Visco-Correct-Desktop>
+#ifndef SPAULY_VISCO_BATCH_THREAD_POOL_H
+#define SPAULY_VISCO_BATCH_THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace spauly {
+namespace visco {
+namespace batch {
+
+/// @brief A work-stealing thread pool. Every worker owns a task queue, takes
+/// work from the back of its own queue and steals from the front of the other
+/// queues once it runs dry.
+class ThreadPool {
+ public:
+  /// @brief A task receives the index of the worker that executes it, in the
+  /// range [0, size()).
+  using Task = std::function<void(std::size_t worker)>;
+
+  /// @brief Called with the half open range [begin, end) and the worker index.
+  using RangeTask =
+      std::function<void(std::size_t begin, std::size_t end, std::size_t)>;
+
+  /// @param thread_count The number of workers. Zero uses one worker per
+  /// hardware thread.
+  explicit ThreadPool(std::size_t thread_count = 0);
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  /// @brief Queues a task. Tasks submitted from a worker go into that
+  /// worker's own queue, all others are distributed round robin.
+  void Submit(Task task);
+
+  /// @brief Queues a task behind the work that is already queued. It goes to
+  /// the front of the queue Submit() would pick, which its owner takes last
+  /// and idle workers steal first. Long running work that requeues itself in
+  /// slices this way lets the other tasks of a shared pool run in between.
+  void Defer(Task task);
+
+  /// @brief Splits [0, count) into chunks of at most grain elements, runs them
+  /// on the pool and blocks until all of them finished. Neighbouring chunks
+  /// are queued on the same worker to keep the memory access local.
+  /// Called from one of the workers, e.g. by a job of a shared pool, the
+  /// worker runs queued tasks while it waits instead of blocking. These get
+  /// the same worker index, so per-worker state must not be held across the
+  /// call.
+  void ParallelFor(std::size_t count, std::size_t grain, const RangeTask &body);
+
+  /// @brief Returns the number of workers.
+  std::size_t size() const { return threads_.size(); }
+
+ private:
+  struct alignas(64) Queue {
+    std::mutex mutex;
+    std::deque<Task> tasks;
+  };
+
+  void WorkerLoop(std::size_t index);
+
+  /// @brief Takes a task from the own queue or steals one from another queue.
+  bool TryPop(std::size_t index, Task &task);
+
+  void Push(std::size_t queue, Task task, bool front = false);
+
+  /// @brief Runs the task if one could be popped for the worker.
+  bool RunOne(std::size_t index);
+
+  std::vector<std::unique_ptr<Queue>> queues_;
+  std::vector<std::thread> threads_;
+
+  std::mutex wake_mutex_;
+  std::condition_variable wake_;
+  std::atomic<std::size_t> pending_ = 0;
+  std::atomic<std::size_t> next_queue_ = 0;
+  bool stop_ = false;
+};
+
+}  // namespace batch
+
+}  // namespace visco
+
+}  // namespace spauly
+
+#endif  // SPAULY_VISCO_BATCH_THREAD_POOL_H
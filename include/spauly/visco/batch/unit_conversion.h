@@ -0,0 +1,230 @@
+// Visco Correct Desktop - Correction factors for centrifugal pumps
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Visco-Correct-Desktop>
+#ifndef SPAULY_VISCO_BATCH_UNIT_CONVERSION_H
+#define SPAULY_VISCO_BATCH_UNIT_CONVERSION_H
+
+#include <array>
+#include <cstddef>
+#include <iterator>
+#include <limits>
+#include <utility>
+
+#include "spauly/vccore/data.h"
+
+namespace spauly {
+namespace visco {
+namespace batch {
+
+/// @brief Valid ranges of the chart in the canonical units m^3/h, m and
+/// mm^2/s.
+constexpr double kMinFlowrate = 6.0;
+constexpr double kMaxFlowrate = 2000.0;
+constexpr double kMinTotalHead = 5.0;
+constexpr double kMaxTotalHead = 200.0;
+constexpr double kMinViscosity = 10.0;
+constexpr double kMaxViscosity = 4000.0;
+
+/// @brief Conversion factors into the canonical units, indexed by the value
+/// of the unit enums. The core converts with its own copy of these factors;
+/// vcd_property_check fails if the two disagree at any chart limit.
+// m^3/h, l/min, US GPM
+constexpr double kFlowrateScale[] = {1.0, 0.06, 0.2271247};
+// m, ft
+constexpr double kTotalHeadScale[] = {1.0, 0.3048};
+// mm^2/s, cSt, cP, mPas. mPas / (kg/m^3) equals 1e3 mm^2/s.
+constexpr double kViscosityScale[] = {1.0, 1.0, 1000.0, 1000.0};
+// g/l, kg/m^3
+constexpr double kDensityScale[] = {1.0, 1.0};
+
+// The tables are indexed by the enums of the core, the dynamic viscosity
+// units have to be the last two
+static_assert(static_cast<std::size_t>(vccore::ViscosityUnit::kcP) == 2 &&
+                  static_cast<std::size_t>(vccore::ViscosityUnit::kmPas) + 1 ==
+                      std::size(kViscosityScale),
+              "kViscosityScale does not match vccore::ViscosityUnit");
+
+/// @brief The number of vccore::Units combinations.
+constexpr std::size_t kUnitCombinations =
+    std::size(kFlowrateScale) * std::size(kTotalHeadScale) *
+    std::size(kViscosityScale) * std::size(kDensityScale);
+
+/// @brief Returns the units the chart is evaluated in (m^3/h, m, mm^2/s,
+/// kg/m^3).
+constexpr vccore::Units CanonicalUnits() {
+  vccore::Units units;
+  units.flowrate = static_cast<vccore::FlowrateUnit>(0);
+  units.total_head = static_cast<vccore::TotalHeadUnit>(0);
+  units.viscosity = static_cast<vccore::ViscosityUnit>(0);
+  units.density = static_cast<vccore::DensityUnit>(0);
+  return units;
+}
+
+/// @brief Returns true for viscosity units that describe the dynamic
+/// viscosity and therefore need the density.
+constexpr bool IsDynamicViscosity(vccore::ViscosityUnit unit) {
+  return unit == vccore::ViscosityUnit::kcP ||
+         unit == vccore::ViscosityUnit::kmPas;
+}
+
+/// @brief Returns true if every unit of the combination is one of the
+/// tabulated enum values. Units decoded from files or requests may not be.
+constexpr bool IsValidUnits(const vccore::Units &units) {
+  return static_cast<std::size_t>(units.flowrate) < std::size(kFlowrateScale) &&
+         static_cast<std::size_t>(units.total_head) <
+             std::size(kTotalHeadScale) &&
+         static_cast<std::size_t>(units.viscosity) <
+             std::size(kViscosityScale) &&
+         static_cast<std::size_t>(units.density) < std::size(kDensityScale);
+}
+
+/// @brief Returns the position of a unit combination in
+/// [0, kUnitCombinations), density is the fastest changing unit. The units
+/// must be valid, see IsValidUnits().
+constexpr std::size_t UnitIndex(const vccore::Units &units) {
+  std::size_t index = static_cast<std::size_t>(units.flowrate);
+  index = index * std::size(kTotalHeadScale) +
+          static_cast<std::size_t>(units.total_head);
+  index = index * std::size(kViscosityScale) +
+          static_cast<std::size_t>(units.viscosity);
+  return index * std::size(kDensityScale) +
+         static_cast<std::size_t>(units.density);
+}
+
+/// @brief Inverse of UnitIndex().
+constexpr vccore::Units UnitsAt(std::size_t index) {
+  vccore::Units units;
+  units.density =
+      static_cast<vccore::DensityUnit>(index % std::size(kDensityScale));
+  index /= std::size(kDensityScale);
+  units.viscosity =
+      static_cast<vccore::ViscosityUnit>(index % std::size(kViscosityScale));
+  index /= std::size(kViscosityScale);
+  units.total_head =
+      static_cast<vccore::TotalHeadUnit>(index % std::size(kTotalHeadScale));
+  index /= std::size(kTotalHeadScale);
+  units.flowrate = static_cast<vccore::FlowrateUnit>(index);
+  return units;
+}
+
+/// @brief Factors that convert values of a vccore::Units combination into
+/// the canonical units. For dynamic viscosities the kinematic viscosity is
+/// (viscosity * scale.viscosity) / (density * scale.density).
+struct UnitScale {
+  double flowrate = 1.0;
+  double total_head = 1.0;
+  double viscosity = 1.0;
+  double density = 1.0;
+  bool dynamic_viscosity = false;
+};
+
+/// @brief Looks up the conversion factors for a unit combination. Unknown
+/// units get a NaN factor, so CheckRanges() reports their values as out of
+/// range instead of the lookup reading past the tables.
+constexpr UnitScale GetUnitScale(const vccore::Units &units) {
+  constexpr double kUnknown = std::numeric_limits<double>::quiet_NaN();
+  auto lookup = [](const auto &table, auto unit) {
+    const std::size_t index = static_cast<std::size_t>(unit);
+    return (index < std::size(table)) ? table[index] : kUnknown;
+  };
+
+  UnitScale scale;
+  scale.flowrate = lookup(kFlowrateScale, units.flowrate);
+  scale.total_head = lookup(kTotalHeadScale, units.total_head);
+  scale.viscosity = lookup(kViscosityScale, units.viscosity);
+  scale.density = lookup(kDensityScale, units.density);
+  scale.dynamic_viscosity = IsDynamicViscosity(units.viscosity);
+  return scale;
+}
+
+/// @brief Converts params into the canonical units.
+constexpr vccore::Parameters Normalise(const vccore::Parameters &params,
+                                       const UnitScale &scale) {
+  vccore::Parameters result = params;
+  result.flowrate = params.flowrate * scale.flowrate;
+  result.total_head = params.total_head * scale.total_head;
+  result.density = params.density * scale.density;
+  result.viscosity = params.viscosity * scale.viscosity;
+  if (scale.dynamic_viscosity) result.viscosity /= result.density;
+  return result;
+}
+
+/// @brief One unit combination fixed at compile time. Kernels instantiated
+/// for it see the conversion factors as constants, so factors of one and
+/// the density division of kinematic units disappear from the code instead
+/// of being tested per point. Use UnitIndex() to select the instantiation
+/// once per batch.
+template <std::size_t kIndex>
+struct StaticUnits {
+  static_assert(kIndex < kUnitCombinations);
+
+  static constexpr vccore::Units kUnits = UnitsAt(kIndex);
+  static constexpr UnitScale kScale = GetUnitScale(kUnits);
+
+  static constexpr bool kScalesFlowrate = kScale.flowrate != 1.0;
+  static constexpr bool kScalesTotalHead = kScale.total_head != 1.0;
+  static constexpr bool kScalesViscosity = kScale.viscosity != 1.0;
+  static constexpr bool kScalesDensity = kScale.density != 1.0;
+  static constexpr bool kDynamic = kScale.dynamic_viscosity;
+
+  static constexpr vccore::Parameters Normalise(
+      const vccore::Parameters &params) {
+    vccore::Parameters result = params;
+    if constexpr (kScalesFlowrate) result.flowrate *= kScale.flowrate;
+    if constexpr (kScalesTotalHead) result.total_head *= kScale.total_head;
+    if constexpr (kScalesDensity) result.density *= kScale.density;
+    if constexpr (kScalesViscosity) result.viscosity *= kScale.viscosity;
+    if constexpr (kDynamic) result.viscosity /= result.density;
+    return result;
+  }
+};
+
+/// @brief Builds a table with one entry per unit combination, entry i is
+/// Make::template Get<StaticUnits<i>>().
+template <typename Make, std::size_t... kIndices>
+constexpr auto MakeUnitTable(std::index_sequence<kIndices...>) {
+  return std::array{Make::template Get<StaticUnits<kIndices>>()...};
+}
+
+template <typename Make>
+constexpr auto MakeUnitTable() {
+  return MakeUnitTable<Make>(std::make_index_sequence<kUnitCombinations>());
+}
+
+/// @brief Returns the vccore::ErrorFlag bits for parameters in canonical
+/// units. NaN values are reported as out of range.
+constexpr int CheckRanges(const vccore::Parameters &canonical) {
+  int flags = 0;
+  if (!(canonical.flowrate >= kMinFlowrate &&
+        canonical.flowrate <= kMaxFlowrate))
+    flags |= static_cast<int>(vccore::ErrorFlag::kFlowrateError);
+  if (!(canonical.total_head >= kMinTotalHead &&
+        canonical.total_head <= kMaxTotalHead))
+    flags |= static_cast<int>(vccore::ErrorFlag::kTotalHeadError);
+  if (!(canonical.viscosity >= kMinViscosity &&
+        canonical.viscosity <= kMaxViscosity))
+    flags |= static_cast<int>(vccore::ErrorFlag::kViscosityError);
+  return flags;
+}
+
+}  // namespace batch
+
+}  // namespace visco
+
+}  // namespace spauly
+
+#endif  // SPAULY_VISCO_BATCH_UNIT_CONVERSION_H
@@ -20,29 +20,111 @@
 
 #include <imgui.h>
 
+#include <cstdint>
+#include <vector>
+
+#include "spauly/visco/project_store.h"
 #include "spauly/visco/utils/layer.h"
+#include "spauly/visco/utils/result_cache.h"
 #include "spauly/vccore/calculator.h"
 #include "spauly/vccore/data.h"
 
 namespace spauly {
 namespace visco {
 
+/// @brief Renders one calculator window per project. All windows are docked
+/// into the dockspace on first use. Windows that are hidden behind another
+/// tab or collapsed only cost their ImGui::Begin()/End() per frame. The
+/// result lines are formatted once per change of the project, unchanged
+/// frames only submit the cached text.
 class CalculatorView : public utils::Layer {
  public:
-  CalculatorView() = default;
+  /// @brief Creates the view with the main calculator project.
+  CalculatorView();
   virtual ~CalculatorView() = default;
 
   virtual void OnUIRender(const ImGuiWindowFlags& flags) override;
+  virtual bool NeedsRedraw() const override {
+    return version_ != rendered_version_;
+  }
+  virtual const char* name() const override { return "CalculatorView"; }
+
+  /// @brief Adds a project with default inputs and focuses its window.
+  ProjectId AddProject();
+
+  /// @brief Sets the dockspace new project windows are docked into.
+  void set_dock_id(ImGuiID dock_id) { dock_id_ = dock_id; }
+
+  ProjectStore& projects() { return projects_; }
+  const ProjectStore& projects() const { return projects_; }
+
+  /// @brief Returns the result cache, e.g. to read its hit and miss counters.
+  const utils::ResultCache& cache() const { return cache_; }
+
+  /// @brief Returns the inputs of the active project, i.e. the project whose
+  /// window was focused last.
+  const vccore::Parameters& params() const { return active_project().params; }
+  const vccore::Units& units() const { return active_project().units; }
+  const SweepDefinition& sweep() const { return active_project().sweep; }
+
+  /// @brief Replaces the inputs of the active project as if they were entered
+  /// in its window, e.g. by a scripted scenario.
+  void SetInputs(const vccore::Parameters& params, const vccore::Units& units);
+
+  /// @brief Calculates the active project like its "Calculate" button.
+  void Calculate();
+
+  /// @brief Replaces all projects, e.g. with the ones loaded from a file. The
+  /// first project becomes the main calculator. An empty store is replaced
+  /// by a new main calculator.
+  void SetProjects(ProjectStore&& projects);
 
  protected:
+  /// @brief Displays the inputs and results of a project.
+  void RenderProject(std::size_t index, Project& project);
+
   /// @brief Displays the disclaimer regarding the use of the software.
   void Disclaimer();
 
  private:
+  /// @brief The result lines of a project as displayed.
+  struct ResultText {
+    ProjectId id = ProjectStore::kInvalidId;
+    std::uint32_t version = 0;
+    char eta[32];
+    char q[32];
+    char h[4][32];
+  };
+
+  const Project& active_project() const;
+  Project& active_project();
+
+  /// @brief Looks up or calculates the factors of project.
+  void Calculate(Project& project);
+
+  /// @brief Marks project as changed and tells the other layers about it.
+  void Touch(Project& project);
+
+  /// @brief Returns the cached text of the project at index, formatted again
+  /// if the project changed.
+  const ResultText& GetResultText(std::size_t index, const Project& project);
+
   vccore::Calculator calculator_;
-  vccore::Parameters params_;
-  vccore::Units units_;
-  vccore::CorrectionFactors result_;
+  utils::ResultCache cache_;
+
+  ProjectStore projects_;
+  ProjectId main_project_ = ProjectStore::kInvalidId;
+  ProjectId active_ = ProjectStore::kInvalidId;
+  ProjectId focus_request_ = ProjectStore::kInvalidId;
+  ImGuiID dock_id_ = 0;
+
+  std::uint64_t version_ = 1;
+  std::uint64_t rendered_version_ = 0;
+
+  // Parallel to projects_, entries are matched by id and version
+  std::vector<ResultText> result_text_;
+  float heading_width_ = 0.0f;
+  float heading_font_size_ = 0.0f;
 };
 
 }  // namespace visco
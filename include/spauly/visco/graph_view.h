@@ -0,0 +1,133 @@
+// Visco Correct Desktop - Correction factors for centrifugal pumps
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Visco-Correct-Desktop>
+#ifndef SPAULY_VISCO_GRAPH_VIEW_H
+#define SPAULY_VISCO_GRAPH_VIEW_H
+
+#include <imgui.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "spauly/vccore/calculator.h"
+#include "spauly/vccore/data.h"
+#include "spauly/visco/calculator_view.h"
+#include "spauly/visco/utils/job_system.h"
+#include "spauly/visco/utils/layer.h"
+
+namespace spauly {
+namespace visco {
+
+/// @brief Plots the corrected Q-H and Q-eta curves of the operating point
+/// entered in the CalculatorView and the correction factors over the whole
+/// viscosity range of the chart. The viscosity sweep is sampled by a job
+/// whenever the inputs change and cached, so drawing a frame only copies the
+/// cached curves into the draw list.
+class GraphView : public utils::Layer {
+ public:
+  /// @param calculator_view The view whose inputs are plotted.
+  /// @param jobs Runs the viscosity sweeps. Must outlive the view.
+  GraphView(std::shared_ptr<const CalculatorView> calculator_view,
+            utils::JobSystem& jobs);
+  virtual ~GraphView();
+
+  virtual void OnUIRender(const ImGuiWindowFlags& flags) override;
+  virtual void OnEvent(const utils::Event& event) override;
+  virtual const char* name() const override { return "GraphView"; }
+
+  /// @brief Returns true once every sample of the sweep is calculated.
+  bool sweep_complete() const { return !sweep_job_.valid(); }
+
+ private:
+  /// @brief A curve in plot coordinates and its cached screen positions.
+  /// Invalid samples are NaN and split the curve.
+  struct Series {
+    const char* label = "";
+    ImU32 color = 0;
+    std::vector<ImVec2> points;
+    std::vector<ImVec2> screen;
+    bool dirty = true;
+
+    // Plot area the screen positions were computed for
+    ImVec2 origin;
+    ImVec2 size;
+  };
+
+  struct PlotRange {
+    float x_min, x_max, y_min, y_max;
+  };
+
+  /// @brief Returns true if the inputs of the calculator view differ from
+  /// the ones the curves were built for.
+  bool InputsChanged();
+
+  /// @brief Resizes the sweep series to the sweep definition and sets their
+  /// log spaced viscosities. Only allocates if the sample count grows.
+  void ResizeSweep();
+
+  /// @brief Recalculates the four corrected points of the flow curves.
+  void RebuildFlowCurves();
+
+  /// @brief Cancels the running sweep and submits one for the current
+  /// inputs.
+  void StartSweep();
+
+  /// @brief Copies the factors of a finished sweep into the sweep series.
+  void ApplySweep(const std::vector<vccore::CorrectionFactors>& factors);
+
+  /// @brief Draws series into a plot area of the given size. A vertical line
+  /// is drawn at marker_x unless it is NaN.
+  void DrawPlot(const char* id, const ImVec2& size, const PlotRange& range,
+                Series* const* series, std::size_t count, float marker_x);
+
+  /// @brief Draws the labels of series in their colors.
+  void Legend(Series* const* series, std::size_t count);
+
+  std::shared_ptr<const CalculatorView> calculator_view_;
+  utils::JobSystem& jobs_;
+  vccore::Calculator calculator_;
+
+  vccore::Parameters params_;
+  vccore::Units units_;
+  SweepDefinition sweep_;
+  bool initialized_ = false;
+  // Set by the events of the calculator view and the menu
+  bool inputs_dirty_ = true;
+  bool reset_layout_ = false;
+
+  // Flow ratio (corrected) over head and efficiency correction
+  Series water_;
+  Series head_;
+  Series efficiency_;
+
+  // Correction factors over log10 of the kinematic viscosity
+  utils::JobHandle sweep_job_;
+  std::uint64_t sweep_generation_ = 0;
+  float current_viscosity_ = 0.0f;
+  Series sweep_q_;
+  Series sweep_eta_;
+  Series sweep_h_;
+};
+
+}  // namespace visco
+
+}  // namespace spauly
+
+#endif  // SPAULY_VISCO_GRAPH_VIEW_H
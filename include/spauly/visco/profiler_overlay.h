@@ -0,0 +1,56 @@
+// Visco Correct Desktop - Correction factors for centrifugal pumps
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Visco-Correct-Desktop>
+#ifndef SPAULY_VISCO_PROFILER_OVERLAY_H
+#define SPAULY_VISCO_PROFILER_OVERLAY_H
+
+#ifdef VCD_PROFILING
+
+#include <imgui.h>
+
+#include <string>
+
+#include "spauly/visco/utils/layer.h"
+#include "spauly/visco/utils/profiler.h"
+
+namespace spauly {
+namespace visco {
+
+/// @brief Shows the rolling percentiles of all profiled scopes and exports
+/// the recorded events as Chrome trace. Only available in builds with
+/// VCD_PROFILING.
+class ProfilerOverlay : public utils::Layer {
+ public:
+  static constexpr const char* kTracePath = "visco_trace.json";
+
+  ProfilerOverlay() = default;
+  virtual ~ProfilerOverlay() = default;
+
+  virtual void OnUIRender(const ImGuiWindowFlags& flags) override;
+  virtual const char* name() const override { return "ProfilerOverlay"; }
+
+ private:
+  std::string status_;
+};
+
+}  // namespace visco
+
+}  // namespace spauly
+
+#endif  // VCD_PROFILING
+
+#endif  // SPAULY_VISCO_PROFILER_OVERLAY_H
@@ -0,0 +1,131 @@
+// Visco Correct Desktop - Correction factors for centrifugal pumps
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Visco-Correct-Desktop>
+#ifndef SPAULY_VISCO_PROJECT_FILE_H
+#define SPAULY_VISCO_PROJECT_FILE_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "spauly/visco/project_store.h"
+#include "spauly/visco/utils/job_system.h"
+
+namespace spauly {
+namespace visco {
+
+// Project files (.vcproj) are snapshots of a ProjectStore. Every project is a
+// fixed size record, so a mapped file is read with one copy per project and
+// a single changed project can be rewritten in place. All values are
+// little-endian:
+//
+//   file header  magic "VCPJ", uint32 version, uint32 record size,
+//                uint32 record count, uint64 reserved[2]           (32 bytes)
+//   records      ProjectRecord                          (record size bytes)
+//
+// Readers use the first sizeof(ProjectRecord) bytes of every record, so later
+// versions may append fields to the record.
+
+constexpr std::uint32_t kProjectFileVersion = 1;
+
+/// @brief The on-disk layout of a Project.
+struct ProjectRecord {
+  std::uint32_t id;
+  std::int32_t error_flag;
+  std::uint8_t units[4];
+  std::uint32_t sweep_samples;
+  char title[Project::kTitleSize];
+  double params[4];  // flowrate, total_head, viscosity, density
+  double result[6];  // eta, q, h[0..3]
+  double sweep[2];   // viscosity_min, viscosity_max
+};
+
+static_assert(sizeof(ProjectRecord) == 160,
+              "The on-disk record must not contain padding");
+
+ProjectRecord ToRecord(const Project &project);
+
+/// @brief Converts a record back into a project.
+/// @return Returns false if the record holds invalid units.
+bool FromRecord(const ProjectRecord &record, Project &project);
+
+/// @brief Writes all projects to path. The file is written next to path
+/// first and then renamed, so an existing file is never left half written.
+/// @return Returns false if the file could not be written.
+bool SaveProjects(const ProjectStore &store, const std::string &path);
+
+/// @brief Replaces the content of store with the projects in the file. The
+/// store is left untouched if the file can not be read.
+/// @return Returns false if the file is missing or invalid.
+bool LoadProjects(const std::string &path, ProjectStore &store);
+
+/// @brief Writes all projects as human readable JSON. JSON files can not be
+/// loaded again.
+/// @return Returns false if the file could not be written.
+bool ExportProjectsJson(const ProjectStore &store, const std::string &path);
+
+/// @brief Periodically saves the projects to a file on a job. Only projects
+/// that changed since the last save are written, in place. The whole file is
+/// only rewritten when projects were added, removed or reordered, or after a
+/// failed write. At most one save is in flight at a time.
+class ProjectAutosaver {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  static constexpr Clock::duration kDefaultInterval = std::chrono::seconds(5);
+
+  /// @param jobs Runs the writes. Must outlive the autosaver.
+  ProjectAutosaver(utils::JobSystem &jobs, std::string path,
+                   Clock::duration interval = kDefaultInterval);
+  ~ProjectAutosaver() = default;
+
+  /// @brief Compares the projects with the saved ones once the interval
+  /// elapsed and submits a save for the differences. Must be called from the
+  /// thread that polls the job system.
+  void Update(const ProjectStore &store, Clock::time_point now);
+
+  const std::string &path() const { return path_; }
+
+  /// @brief Returns the number of project records written so far.
+  std::uint64_t records_written() const { return records_written_; }
+
+  /// @brief Returns the number of times the whole file was written.
+  std::uint64_t full_writes() const { return full_writes_; }
+
+ private:
+  utils::JobSystem &jobs_;
+  std::string path_;
+  Clock::duration interval_;
+  Clock::time_point next_save_;
+  utils::JobHandle job_;
+
+  // What the file holds and the snapshot of the current projects
+  std::vector<ProjectRecord> saved_;
+  std::vector<ProjectRecord> current_;
+  bool rewrite_ = true;
+
+  std::uint64_t records_written_ = 0;
+  std::uint64_t full_writes_ = 0;
+};
+
+}  // namespace visco
+
+}  // namespace spauly
+
+#endif  // SPAULY_VISCO_PROJECT_FILE_H
@@ -0,0 +1,119 @@
+// Visco Correct Desktop - Correction factors for centrifugal pumps
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Visco-Correct-Desktop>
+#ifndef SPAULY_VISCO_PROJECT_STORE_H
+#define SPAULY_VISCO_PROJECT_STORE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "spauly/vccore/data.h"
+
+namespace spauly {
+namespace visco {
+
+using ProjectId = std::uint32_t;
+
+/// @brief The kinematic viscosity range in mm^2/s the graph samples the
+/// correction factors over. Defaults to the whole range of the chart.
+struct SweepDefinition {
+  static constexpr std::uint32_t kDefaultSamples = 2048;
+  static constexpr std::uint32_t kMaxSamples = 1 << 16;
+
+  double viscosity_min = 10.0;
+  double viscosity_max = 4000.0;
+  std::uint32_t samples = kDefaultSamples;
+
+  bool operator==(const SweepDefinition &other) const = default;
+};
+
+/// @brief The complete state of one calculator instance. Projects are plain
+/// values so that many of them fit into one contiguous array.
+struct Project {
+  static constexpr std::size_t kTitleSize = 48;
+
+  ProjectId id = 0;
+  // Window title, the part after ### keeps the ImGui ID stable on rename
+  char title[kTitleSize] = {};
+  vccore::Parameters params;
+  vccore::Units units;
+  vccore::CorrectionFactors result;
+  SweepDefinition sweep;
+  // Incremented on every change of the values above, lets views cache what
+  // they derive from them. Not stored in project files.
+  std::uint32_t version = 0;
+};
+
+/// @brief Holds all open projects in one contiguous array in the order they
+/// were added. Ids are never reused. Pointers and references into the store
+/// are invalidated by Add() and Remove().
+class ProjectStore {
+ public:
+  static constexpr ProjectId kInvalidId = 0;
+  static constexpr std::size_t kDefaultReserve = 128;
+
+  ProjectStore() { projects_.reserve(kDefaultReserve); }
+  ~ProjectStore() = default;
+
+  /// @brief Appends a project with default inputs.
+  /// @param name The displayed name. Null names the project "Project <id>".
+  Project &Add(const char *name = nullptr);
+
+  /// @brief Appends a copy of project, e.g. one loaded from a file, and keeps
+  /// its id. Ids of later projects continue after it.
+  /// @return Returns null if the id is invalid or already in use.
+  Project *Insert(const Project &project);
+
+  /// @brief Removes the project with the given id.
+  /// @return Returns false if there is no such project.
+  bool Remove(ProjectId id);
+
+  /// @brief Returns the project with the given id or null.
+  Project *Find(ProjectId id);
+  const Project *Find(ProjectId id) const;
+
+  /// @brief Removes all projects. Ids are not reused afterwards either.
+  void clear() { projects_.clear(); }
+
+  void reserve(std::size_t size) { projects_.reserve(size); }
+
+  std::size_t size() const { return projects_.size(); }
+  bool empty() const { return projects_.empty(); }
+
+  Project &operator[](std::size_t index) { return projects_[index]; }
+  const Project &operator[](std::size_t index) const {
+    return projects_[index];
+  }
+
+  std::vector<Project>::iterator begin() { return projects_.begin(); }
+  std::vector<Project>::iterator end() { return projects_.end(); }
+  std::vector<Project>::const_iterator begin() const {
+    return projects_.begin();
+  }
+  std::vector<Project>::const_iterator end() const { return projects_.end(); }
+
+ private:
+  std::vector<Project> projects_;
+  ProjectId next_id_ = 1;
+};
+
+}  // namespace visco
+
+}  // namespace spauly
+
+#endif  // SPAULY_VISCO_PROJECT_STORE_H
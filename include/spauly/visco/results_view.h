@@ -0,0 +1,137 @@
+// Visco Correct Desktop - Correction factors for centrifugal pumps
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Visco-Correct-Desktop>
+#ifndef SPAULY_VISCO_RESULTS_VIEW_H
+#define SPAULY_VISCO_RESULTS_VIEW_H
+
+#include <imgui.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "spauly/visco/batch/result_index.h"
+#include "spauly/visco/batch/soa_batch.h"
+#include "spauly/visco/utils/job_system.h"
+#include "spauly/visco/utils/layer.h"
+
+namespace spauly {
+namespace visco {
+
+/// @brief The columns of a batch run that the results table shows.
+struct ResultTable {
+  batch::SoaResults results;
+  /// @brief The operating points in the units of their file. Empty if the
+  /// inputs are not known.
+  std::array<std::vector<double>, 4> inputs;
+
+  bool has_inputs() const { return !inputs[0].empty(); }
+  std::size_t size() const { return results.size(); }
+};
+
+/// @brief Reads a results dataset (.vcdb) and optionally the inputs dataset
+/// it was calculated from. Inputs whose row count does not match are dropped.
+/// @return Returns false if the results can not be read.
+bool LoadResultTable(const std::string& results_path,
+                     const std::string& inputs_path, ResultTable& table);
+
+/// @brief Shows million-row result sets in a table. Sorting and filtering
+/// only rebuild a permutation of the row numbers (see batch::SortRows()) on a
+/// job, the columns are never copied or reordered. The table itself draws
+/// only the rows that fit into the window, so the frame cost does not depend
+/// on the number of rows.
+class ResultsView : public utils::Layer {
+ public:
+  /// @param jobs Loads the files and builds the row index. Must outlive the
+  /// view.
+  explicit ResultsView(utils::JobSystem& jobs);
+  virtual ~ResultsView() = default;
+
+  virtual void OnUIRender(const ImGuiWindowFlags& flags) override;
+  virtual const char* name() const override { return "ResultsView"; }
+
+  /// @brief Shows table instead of the current one.
+  void SetTable(std::shared_ptr<const ResultTable> table);
+
+  /// @brief Scrolls the table so that position is the first row shown.
+  void ScrollTo(std::size_t position) { first_row_ = position; }
+
+  /// @brief Returns the number of rows that passed the filter.
+  std::size_t row_count() const { return order_.size(); }
+
+  /// @brief Returns true while the row index is rebuilt.
+  bool indexing() const { return index_job_.valid(); }
+
+ private:
+  enum Column : int {
+    kColumnFlowrate = 0,
+    kColumnTotalHead,
+    kColumnViscosity,
+    kColumnDensity,
+    kColumnEta,
+    kColumnQ,
+    kColumnH06,
+    kColumnH08,
+    kColumnH10,
+    kColumnH12,
+    kColumnFlags,
+    kColumnCount
+  };
+
+  /// @brief Reads the datasets at the entered paths on a job.
+  void Load();
+
+  /// @brief Filters and sorts the row numbers on a job. The old order is
+  /// shown until the new one is ready.
+  void RebuildIndex();
+
+  /// @brief Draws the visible rows and handles scrolling.
+  void Table();
+
+  static std::span<const double> Values(const ResultTable& table,
+                                        int column);
+
+  utils::JobSystem& jobs_;
+
+  std::shared_ptr<const ResultTable> table_;
+  std::vector<std::uint32_t> order_;
+  batch::FlagFilter filter_;
+  int sort_column_ = -1;
+  bool descending_ = false;
+
+  // Discards the results of outdated index jobs
+  std::uint64_t generation_ = 0;
+  utils::JobHandle load_job_;
+  utils::JobHandle index_job_;
+
+  // A position in order_, not a row number
+  std::size_t first_row_ = 0;
+
+  char results_path_[256] = "study_results.vcdb";
+  char inputs_path_[256] = "study_inputs.vcdb";
+  const char* status_ = "";
+};
+
+}  // namespace visco
+
+}  // namespace spauly
+
+#endif  // SPAULY_VISCO_RESULTS_VIEW_H
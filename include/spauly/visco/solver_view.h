@@ -0,0 +1,57 @@
+// Visco Correct Desktop - Correction factors for centrifugal pumps
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Visco-Correct-Desktop>
+#ifndef SPAULY_VISCO_SOLVER_VIEW_H
+#define SPAULY_VISCO_SOLVER_VIEW_H
+
+#include <imgui.h>
+
+#include "spauly/visco/batch/reverse_solver.h"
+#include "spauly/visco/utils/layer.h"
+
+namespace spauly {
+namespace visco {
+
+/// @brief Answers the inverse question of the calculator: which value of one
+/// input makes a correction factor reach a target, e.g. the highest
+/// viscosity at which eta stays above 0.7. A query takes a few dozen
+/// calculations, so it is solved again on every edit.
+class SolverView : public utils::Layer {
+ public:
+  SolverView();
+  virtual ~SolverView() = default;
+
+  virtual void OnUIRender(const ImGuiWindowFlags& flags) override;
+  virtual const char* name() const override { return "SolverView"; }
+
+ private:
+  /// @brief Resets the search interval to the chart range of the variable,
+  /// converted into the units of the query.
+  void DefaultRange();
+
+  void ShowResult();
+
+  batch::ReverseSolver solver_;
+  batch::SolverQuery query_;
+  batch::SolverResult result_;
+};
+
+}  // namespace visco
+
+}  // namespace spauly
+
+#endif  // SPAULY_VISCO_SOLVER_VIEW_H
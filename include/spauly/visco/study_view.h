@@ -0,0 +1,90 @@
+// Visco Correct Desktop - Correction factors for centrifugal pumps
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Visco-Correct-Desktop>
+#ifndef SPAULY_VISCO_STUDY_VIEW_H
+#define SPAULY_VISCO_STUDY_VIEW_H
+
+#include <imgui.h>
+
+#include <array>
+#include <cstdint>
+#include <memory>
+
+#include "spauly/vccore/data.h"
+#include "spauly/visco/batch/parametric_study.h"
+#include "spauly/visco/utils/frame_scheduler.h"
+#include "spauly/visco/utils/job_system.h"
+#include "spauly/visco/utils/layer.h"
+
+namespace spauly {
+namespace visco {
+
+/// @brief Defines a parametric study (a range or list per parameter), runs
+/// it with batch::ParametricStudy and shows the rows in a clipped table. The
+/// rows the table shows are requested from the study every frame, so they
+/// are computed before the rest.
+class StudyView : public utils::Layer {
+ public:
+  /// @param jobs Runs the exports. Must outlive the view.
+  /// @param scheduler Keeps frames coming while a study runs.
+  StudyView(utils::JobSystem& jobs, utils::FrameScheduler& scheduler);
+  virtual ~StudyView();
+
+  virtual void OnUIRender(const ImGuiWindowFlags& flags) override;
+  virtual const char* name() const override { return "StudyView"; }
+
+ private:
+  enum AxisMode : int { kFixed = 0, kLinear, kLog, kList };
+
+  /// @brief The editable definition of one axis.
+  struct AxisInput {
+    int mode = kFixed;
+    double first = 0.0;
+    double last = 0.0;
+    int steps = 1;
+    char list[256] = {};
+  };
+
+  void AxisEditor(const char* label, AxisInput& input);
+
+  /// @brief Converts the input into the values of an axis.
+  static batch::ParameterAxis MakeAxis(const AxisInput& input);
+
+  /// @brief Replaces the current study with one for the inputs.
+  void Run();
+
+  void ResultsTable();
+
+  /// @brief Exports the current study on a job.
+  void Export(bool binary);
+
+  utils::JobSystem& jobs_;
+  utils::FrameScheduler& scheduler_;
+
+  std::array<AxisInput, batch::kStudyFieldCount> axes_;
+  vccore::Units units_;
+
+  std::shared_ptr<batch::ParametricStudy> study_;
+  utils::JobHandle export_job_;
+  const char* status_ = "";
+};
+
+}  // namespace visco
+
+}  // namespace spauly
+
+#endif  // SPAULY_VISCO_STUDY_VIEW_H
@@ -0,0 +1,53 @@
+// Visco Correct Desktop - Correction factors for centrifugal pumps
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Visco-Correct-Desktop>
+#ifndef SPAULY_VISCO_UTILS_ALLOCATION_COUNTER_H
+#define SPAULY_VISCO_UTILS_ALLOCATION_COUNTER_H
+
+// Counts the heap allocations of the process by replacing the global operator
+// new and delete. Only compiled into builds with VCD_PROFILING, where the
+// profiler reports the allocations per frame.
+
+#include <cstddef>
+#include <cstdint>
+
+namespace spauly {
+namespace visco {
+namespace utils {
+
+/// @brief Returns the number of heap allocations of all threads so far.
+std::uint64_t AllocationCount();
+
+/// @brief Returns the number of heap allocations of the calling thread.
+std::uint64_t ThreadAllocationCount();
+
+/// @brief Returns the bytes currently allocated by all threads.
+std::uint64_t AllocatedBytes();
+
+/// @brief Counted allocation functions for ImGui::SetAllocatorFunctions().
+/// ImGui allocates with malloc by default, which the replaced operator new
+/// does not see.
+void *CountedAlloc(std::size_t size, void *user_data);
+void CountedFree(void *pointer, void *user_data);
+
+}  // namespace utils
+
+}  // namespace visco
+
+}  // namespace spauly
+
+#endif  // SPAULY_VISCO_UTILS_ALLOCATION_COUNTER_H
@@ -0,0 +1,125 @@
+// Visco Correct Desktop - Correction factors for centrifugal pumps
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Visco-Correct-Desktop>
+#ifndef SPAULY_VISCO_UTILS_EVENT_BUS_H
+#define SPAULY_VISCO_UTILS_EVENT_BUS_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <variant>
+
+namespace spauly {
+namespace visco {
+namespace utils {
+
+/// @brief The inputs of a project were edited or it became the active
+/// project.
+struct InputChangedEvent {
+  std::uint32_t project = 0;
+};
+
+/// @brief A project got new correction factors.
+struct ResultReadyEvent {
+  std::uint32_t project = 0;
+};
+
+/// @brief The windows were made movable (open) or fixed in their place.
+struct WorkspaceModeChangedEvent {
+  bool open = false;
+};
+
+/// @brief The application switched between dark and light mode.
+struct ThemeChangedEvent {
+  bool dark_mode = false;
+};
+
+using Event = std::variant<InputChangedEvent, ResultReadyEvent,
+                           WorkspaceModeChangedEvent, ThemeChangedEvent>;
+
+/// @brief Queues the events of one frame in fixed storage and delivers them
+/// together at the start of the next one. Posting an event that is already
+/// queued, e.g. every keystroke in the same input field, replaces the queued
+/// one, so a layer sees each change at most once per frame. Not thread safe,
+/// events are posted and dispatched on the UI thread.
+class EventBus {
+ public:
+  static constexpr std::size_t kCapacity = 64;
+
+  EventBus() = default;
+  ~EventBus() = default;
+
+  /// @brief Queues event for the next Dispatch(). An event of the same type
+  /// and project that is already queued is replaced instead.
+  /// @return Returns false if the queue is full and the event was dropped.
+  bool Post(const Event &event) {
+    for (std::size_t i = 0; i < count_; i++) {
+      if (SameTarget(queue_[i], event)) {
+        queue_[i] = event;
+        return true;
+      }
+    }
+    if (count_ == kCapacity) {
+      dropped_++;
+      return false;
+    }
+    queue_[count_++] = event;
+    return true;
+  }
+
+  /// @brief Calls handler for every event queued before the call in the
+  /// order they were posted. Events the handler posts are delivered by the
+  /// next Dispatch().
+  /// @return Returns the number of delivered events.
+  template <typename Handler>
+  std::size_t Dispatch(Handler &&handler) {
+    const std::size_t count = count_;
+    for (std::size_t i = 0; i < count; i++) delivering_[i] = queue_[i];
+    count_ = 0;
+    for (std::size_t i = 0; i < count; i++) handler(delivering_[i]);
+    return count;
+  }
+
+  /// @brief Returns the number of events waiting for the next Dispatch().
+  std::size_t pending() const { return count_; }
+
+  /// @brief Returns the number of events dropped because the queue was full.
+  std::uint64_t dropped() const { return dropped_; }
+
+ private:
+  static bool SameTarget(const Event &a, const Event &b) {
+    if (a.index() != b.index()) return false;
+    if (const auto *input = std::get_if<InputChangedEvent>(&a))
+      return input->project == std::get<InputChangedEvent>(b).project;
+    if (const auto *result = std::get_if<ResultReadyEvent>(&a))
+      return result->project == std::get<ResultReadyEvent>(b).project;
+    return true;
+  }
+
+  std::array<Event, kCapacity> queue_;
+  std::array<Event, kCapacity> delivering_;
+  std::size_t count_ = 0;
+  std::uint64_t dropped_ = 0;
+};
+
+}  // namespace utils
+
+}  // namespace visco
+
+}  // namespace spauly
+
+#endif  // SPAULY_VISCO_UTILS_EVENT_BUS_H
@@ -0,0 +1,127 @@
+// Visco Correct Desktop - Correction factors for centrifugal pumps
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Visco-Correct-Desktop>
+#ifndef SPAULY_VISCO_UTILS_FRAME_ARENA_H
+#define SPAULY_VISCO_UTILS_FRAME_ARENA_H
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <new>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+namespace spauly {
+namespace visco {
+namespace utils {
+
+/// @brief Linear allocator for memory that is only needed while a frame is
+/// built, e.g. formatted labels or temporary rows of a table. Allocating
+/// bumps a pointer, nothing is freed individually and Reset() releases
+/// everything at once after ImGui::Render() has consumed the frame.
+///
+/// When a frame needs more than the capacity, the remaining requests are
+/// served by overflow blocks and the next Reset() grows the arena to the
+/// peak, so steady-state frames do not touch the heap. As a
+/// std::pmr::memory_resource the arena also backs std::pmr containers.
+class FrameArena : public std::pmr::memory_resource {
+ public:
+  static constexpr std::size_t kDefaultCapacity = 64 * 1024;
+
+  explicit FrameArena(std::size_t capacity = kDefaultCapacity);
+  virtual ~FrameArena() = default;
+
+  FrameArena(const FrameArena &) = delete;
+  FrameArena &operator=(const FrameArena &) = delete;
+
+  /// @brief Returns size bytes that stay valid until the next Reset().
+  void *Allocate(std::size_t size,
+                 std::size_t alignment = alignof(std::max_align_t));
+
+  /// @brief Returns count value initialised elements. Their destructors are
+  /// never run, so T must be trivially destructible.
+  template <typename T>
+  std::span<T> AllocateArray(std::size_t count) {
+    static_assert(std::is_trivially_destructible_v<T>,
+                  "Arena memory is released without running destructors");
+    T *data = static_cast<T *>(Allocate(count * sizeof(T), alignof(T)));
+    for (std::size_t i = 0; i < count; i++) new (data + i) T();
+    return {data, count};
+  }
+
+  /// @brief Formats like printf into the arena.
+  /// @return Returns the null terminated text.
+  const char *Format(const char *format, ...);
+
+  /// @brief Releases all allocations of the frame. Must not be called while
+  /// anything still refers to them, i.e. only after ImGui::Render().
+  void Reset();
+
+  /// @brief Returns the bytes allocated since the last Reset().
+  std::size_t used() const { return used_ + overflow_used_; }
+  std::size_t capacity() const { return capacity_; }
+
+  /// @brief Returns the most bytes a single frame used.
+  std::size_t peak() const { return peak_; }
+
+  /// @brief Returns the number of times the arena allocated from the heap
+  /// after its construction.
+  std::size_t growths() const { return growths_; }
+
+ protected:
+  virtual void *do_allocate(std::size_t bytes,
+                            std::size_t alignment) override {
+    return Allocate(bytes, alignment);
+  }
+  virtual void do_deallocate(void *, std::size_t, std::size_t) override {}
+  virtual bool do_is_equal(
+      const std::pmr::memory_resource &other) const noexcept override {
+    return this == &other;
+  }
+
+ private:
+  struct Free {
+    void operator()(std::byte *block) const {
+      ::operator delete(block, std::align_val_t{kBlockAlignment});
+    }
+  };
+  using Block = std::unique_ptr<std::byte, Free>;
+
+  static constexpr std::size_t kBlockAlignment = 64;
+
+  static Block NewBlock(std::size_t size);
+
+  Block block_;
+  std::size_t capacity_ = 0;
+  std::size_t used_ = 0;
+
+  // Allocations that did not fit into block_ in the current frame
+  std::vector<Block> overflow_;
+  std::size_t overflow_used_ = 0;
+
+  std::size_t peak_ = 0;
+  std::size_t growths_ = 0;
+};
+
+}  // namespace utils
+
+}  // namespace visco
+
+}  // namespace spauly
+
+#endif  // SPAULY_VISCO_UTILS_FRAME_ARENA_H
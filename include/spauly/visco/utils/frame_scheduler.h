@@ -0,0 +1,122 @@
+// Visco Correct Desktop - Correction factors for centrifugal pumps
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Visco-Correct-Desktop>
+#ifndef SPAULY_VISCO_UTILS_FRAME_SCHEDULER_H
+#define SPAULY_VISCO_UTILS_FRAME_SCHEDULER_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+
+namespace spauly {
+namespace visco {
+namespace utils {
+
+/// @brief How the platform loop decides when to render.
+enum class RenderMode {
+  kContinuous,  ///< Render every frame at vsync rate
+  kEventDriven  ///< Render only after events, wake-ups and during animations
+};
+
+/// @brief Decides whether the platform loop has to render a frame or may
+/// block until the next event. The scheduler does not know the platform: the
+/// loop reports events through NotifyEvent(), asks ShouldRender() and waits
+/// for at most WaitTimeout() before polling again. All queries take the
+/// current time so the scheduler can be driven by a fake clock.
+class FrameScheduler {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  /// @brief Frames rendered after an event. ImGui needs a few frames to settle
+  /// hover states, layouts and popups after input.
+  static constexpr int kDefaultExtraFrames = 3;
+
+  FrameScheduler() = default;
+  ~FrameScheduler() = default;
+
+  /// @brief Reports an input or window event. The next extra_frames() frames
+  /// are rendered.
+  void NotifyEvent() { pending_frames_ = extra_frames_; }
+
+  /// @brief Keeps rendering continuously for the next frame. Animated content
+  /// calls this every frame it is animating.
+  void RequestAnimationFrame() { animating_ = true; }
+
+  /// @brief Requests one frame at time, e.g. for a blinking text cursor or a
+  /// tooltip delay.
+  void RequestFrameAt(Clock::time_point time) {
+    wake_time_ = std::min(wake_time_, time);
+  }
+
+  /// @brief Must be called once before the layers of a frame are rendered.
+  /// Drops the wake time that caused the frame, so the requests made during
+  /// the frame decide when the next one is due.
+  void OnFrameBegin(Clock::time_point now) {
+    if (wake_time_ <= now) wake_time_ = Clock::time_point::max();
+  }
+
+  /// @brief Must be called once after every rendered frame.
+  void OnFrameRendered() {
+    frames_rendered_++;
+    if (pending_frames_ > 0) pending_frames_--;
+    if (animating_) pending_frames_ = std::max(pending_frames_, 1);
+    animating_ = false;
+  }
+
+  /// @brief Returns true if a frame has to be rendered now.
+  bool ShouldRender(Clock::time_point now) const {
+    return mode_ == RenderMode::kContinuous || pending_frames_ > 0 ||
+           wake_time_ <= now;
+  }
+
+  /// @brief Returns how long the loop may block waiting for events.
+  /// Clock::duration::max() means until the next event.
+  Clock::duration WaitTimeout(Clock::time_point now) const {
+    if (ShouldRender(now)) return Clock::duration::zero();
+    if (wake_time_ == Clock::time_point::max())
+      return Clock::duration::max();
+    return wake_time_ - now;
+  }
+
+  void set_mode(RenderMode mode) {
+    mode_ = mode;
+    NotifyEvent();
+  }
+  RenderMode mode() const { return mode_; }
+
+  void set_extra_frames(int frames) { extra_frames_ = std::max(frames, 1); }
+  int extra_frames() const { return extra_frames_; }
+
+  /// @brief Returns the number of frames rendered so far.
+  std::uint64_t frames_rendered() const { return frames_rendered_; }
+
+ private:
+  RenderMode mode_ = RenderMode::kEventDriven;
+  int extra_frames_ = kDefaultExtraFrames;
+  int pending_frames_ = kDefaultExtraFrames;  // The first frames are always due
+  bool animating_ = false;
+  Clock::time_point wake_time_ = Clock::time_point::max();
+  std::uint64_t frames_rendered_ = 0;
+};
+
+}  // namespace utils
+
+}  // namespace visco
+
+}  // namespace spauly
+
+#endif  // SPAULY_VISCO_UTILS_FRAME_SCHEDULER_H
@@ -0,0 +1,168 @@
+// Visco Correct Desktop - Correction factors for centrifugal pumps
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Visco-Correct-Desktop>
+#ifndef SPAULY_VISCO_UTILS_JOB_SYSTEM_H
+#define SPAULY_VISCO_UTILS_JOB_SYSTEM_H
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <memory>
+
+#include "spauly/visco/batch/thread_pool.h"
+#include "spauly/visco/utils/mpsc_queue.h"
+
+namespace spauly {
+namespace visco {
+namespace utils {
+
+enum class JobStatus { kQueued, kRunning, kFinished, kCancelled };
+
+/// @brief The state a job shares between the worker running it and the
+/// handles of the UI. The work function polls cancelled() and reports its
+/// progress through set_progress().
+class Job {
+ public:
+  Job() = default;
+  ~Job() = default;
+
+  /// @brief Returns true once the job or the whole job system was cancelled.
+  bool cancelled() const {
+    return cancel_.load(std::memory_order_relaxed) ||
+           (shutdown_ && shutdown_->load(std::memory_order_relaxed));
+  }
+
+  /// @brief Sets the progress in the range [0, 1].
+  void set_progress(float progress) {
+    progress_.store(progress, std::memory_order_relaxed);
+  }
+  float progress() const { return progress_.load(std::memory_order_relaxed); }
+
+  JobStatus status() const { return status_.load(std::memory_order_acquire); }
+
+ private:
+  friend class JobHandle;
+  friend class JobSystem;
+
+  std::function<void(Job &)> work_;
+  std::function<void(JobStatus)> on_complete_;
+  const std::atomic<bool> *shutdown_ = nullptr;
+
+  std::atomic<JobStatus> status_ = JobStatus::kQueued;
+  std::atomic<bool> cancel_ = false;
+  std::atomic<float> progress_ = 0.0f;
+};
+
+/// @brief Refers to a submitted job. Default constructed handles refer to no
+/// job.
+class JobHandle {
+ public:
+  JobHandle() = default;
+
+  /// @brief Requests cancellation. Queued jobs are skipped, running jobs stop
+  /// the next time their work function checks Job::cancelled().
+  void Cancel() {
+    if (job_) job_->cancel_.store(true, std::memory_order_relaxed);
+  }
+
+  /// @brief Releases the job. The job still runs to completion.
+  void reset() { job_.reset(); }
+
+  bool valid() const { return job_ != nullptr; }
+
+  /// @brief Returns true once the worker is done with the job. The completion
+  /// callback runs during the next JobSystem::Poll().
+  bool done() const {
+    return job_ && (job_->status() == JobStatus::kFinished ||
+                    job_->status() == JobStatus::kCancelled);
+  }
+
+  float progress() const { return job_ ? job_->progress() : 0.0f; }
+  JobStatus status() const {
+    return job_ ? job_->status() : JobStatus::kCancelled;
+  }
+
+ private:
+  friend class JobSystem;
+
+  explicit JobHandle(std::shared_ptr<Job> job) : job_(std::move(job)) {}
+
+  std::shared_ptr<Job> job_;
+};
+
+/// @brief Runs work off the UI thread. Finished jobs are handed back through
+/// a lock-free queue that the UI thread drains once per frame with Poll(),
+/// which also runs the completion callbacks, so results are only ever touched
+/// by the UI thread and a frame never waits for a worker.
+class JobSystem {
+ public:
+  using Work = std::function<void(Job &job)>;
+  using Completion = std::function<void(JobStatus status)>;
+
+  static constexpr std::size_t kQueueCapacity = 1024;
+
+  /// @param thread_count The number of worker threads. Zero uses one worker
+  /// per hardware thread.
+  explicit JobSystem(std::size_t thread_count = 0);
+  ~JobSystem();
+
+  JobSystem(const JobSystem &) = delete;
+  JobSystem &operator=(const JobSystem &) = delete;
+
+  /// @brief Queues work on the pool. on_complete runs on the thread that
+  /// calls Poll(), with kFinished or kCancelled. It may be empty.
+  JobHandle Submit(Work work, Completion on_complete = nullptr);
+
+  /// @brief Runs the completion callbacks of all jobs that finished since
+  /// the last call. Must always be called from the same thread.
+  /// @return Returns the number of completed jobs.
+  std::size_t Poll();
+
+  /// @brief Returns the number of jobs whose completion has not been polled.
+  std::size_t pending() const {
+    return pending_.load(std::memory_order_relaxed);
+  }
+
+  /// @brief Returns the pool the jobs run on. Layers that parallelise their
+  /// own work use it as well, so the application has one worker per core.
+  batch::ThreadPool &pool() { return pool_; }
+
+  /// @brief Sets a function that the worker calls after each finished job,
+  /// e.g. to wake a platform loop that blocks until the next event so the
+  /// completion is polled. Must be thread safe and set before the first
+  /// Submit().
+  void set_wake(std::function<void()> wake) { wake_ = std::move(wake); }
+
+ private:
+  void Run(const std::shared_ptr<Job> &job);
+
+  MpscQueue<std::shared_ptr<Job>> completed_;
+  std::atomic<std::size_t> pending_ = 0;
+  std::atomic<bool> shutdown_ = false;
+  std::function<void()> wake_;
+
+  // Destroyed first, so no worker outlives the queue
+  batch::ThreadPool pool_;
+};
+
+}  // namespace utils
+
+}  // namespace visco
+
+}  // namespace spauly
+
+#endif  // SPAULY_VISCO_UTILS_JOB_SYSTEM_H
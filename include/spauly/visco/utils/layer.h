@@ -20,6 +20,9 @@
 
 #include <imgui.h>
 
+#include "spauly/visco/utils/event_bus.h"
+#include "spauly/visco/utils/frame_arena.h"
+
 namespace spauly {
 namespace visco {
 namespace utils {
@@ -34,6 +37,36 @@ class Layer {
   virtual void OnDetach() {};
 
   virtual void OnUIRender(const ImGuiWindowFlags& flags) {};
+
+  /// @brief Called at the start of a frame for every event posted during the
+  /// previous one, also while the layer is hidden.
+  virtual void OnEvent(const Event& event) {};
+
+  /// @brief Returns true if the layer changed since it was last rendered
+  /// without an input event, e.g. by a menu action or a finished job. The
+  /// frame loop renders another frame for it.
+  virtual bool NeedsRedraw() const { return false; }
+
+  /// @brief Returns a static name that identifies the layer, e.g. in the
+  /// profiler.
+  virtual const char* name() const { return "Layer"; }
+
+ protected:
+  /// @brief Returns the scratch memory of the current frame. Everything
+  /// allocated from it is released after ImGui::Render(), so it must not be
+  /// kept beyond OnUIRender(). Only valid while the layer is on a LayerStack.
+  FrameArena& frame_arena() { return *frame_arena_; }
+
+  /// @brief Queues event for all layers of the stack. Does nothing while the
+  /// layer is not on a LayerStack.
+  void PostEvent(const Event& event) {
+    if (event_bus_) event_bus_->Post(event);
+  }
+
+ private:
+  friend class LayerStack;
+  FrameArena* frame_arena_ = nullptr;
+  EventBus* event_bus_ = nullptr;
 };
 
 }  // namespace utils
@@ -18,108 +18,151 @@
 #ifndef SPAULY_VISCO_UTILS_LAYERSTACK_H
 #define SPAULY_VISCO_UTILS_LAYERSTACK_H
 
+#include <cstddef>
+#include <cstdint>
 #include <memory>
+#include <utility>
 #include <vector>
 
+#include "spauly/visco/utils/event_bus.h"
+#include "spauly/visco/utils/frame_arena.h"
 #include "spauly/visco/utils/layer.h"
 
 namespace spauly {
 namespace visco {
 namespace utils {
 
+/// @brief Refers to a layer on a LayerStack. A handle whose layer was popped
+/// stays invalid, even if its slot is reused by a later layer.
+struct LayerHandle {
+  std::uint32_t index = 0;
+  std::uint32_t generation = 0;  // 0 is never handed out
+
+  bool valid() const { return generation != 0; }
+};
+
+/// @brief Holds the layers in render order, the arena they share for their
+/// per-frame allocations and the bus they exchange events over.
+///
+/// The render order is one contiguous array of raw layer pointers with a
+/// visibility flag, so rendering walks it without touching reference
+/// counts. Handles map to a slot that knows the position of its layer in
+/// that array, which makes hiding, showing and popping O(1): popped layers
+/// leave a gap that is closed by EndFrame(). Layers must not be pushed while
+/// the stack is iterated.
 class LayerStack {
  public:
   LayerStack() = default;
-  ~LayerStack() { clear(); };
+  ~LayerStack() { clear(); }
 
-  void PushLayer(const std::shared_ptr<Layer> &layer) {
-    layers_.emplace(layers_.begin() + layer_insert_index_, layer);
-    layer_insert_index_++;
-    layer->OnAttach();
-  }
+  LayerStack(const LayerStack &) = delete;
+  LayerStack &operator=(const LayerStack &) = delete;
 
-  void PushOverlay(const std::shared_ptr<Layer> &overlay) {
-    layers_.emplace_back(overlay);
-    overlay->OnAttach();
-  }
+  /// @brief Adds layer behind the other layers but in front of the overlays.
+  LayerHandle PushLayer(std::shared_ptr<Layer> layer);
 
-  void PopLayer(std::shared_ptr<Layer> layer) {
-    auto it = std::find(layers_.begin(), layers_.begin() + layer_insert_index_,
-                        layer);
-    if (it != layers_.begin() + layer_insert_index_) {
-      layer->OnDetach();
-      layers_.erase(it);
-      layer_insert_index_--;
-    }
-  }
+  /// @brief Adds overlay in front of everything else.
+  LayerHandle PushOverlay(std::shared_ptr<Layer> overlay);
 
-  void PopOverlay(std::shared_ptr<Layer> overlay) {
-    auto it = std::find(layers_.begin() + layer_insert_index_, layers_.end(),
-                        overlay);
-    if (it != layers_.end()) {
-      overlay->OnDetach();
-      layers_.erase(it);
-    }
-  }
+  /// @brief Detaches and releases a layer or overlay.
+  /// @return Returns false if the handle is no longer valid.
+  bool PopLayer(LayerHandle handle);
 
-  void HideLayer(std::shared_ptr<Layer> layer) {
-    auto it = std::find(layers_.begin(), layers_.begin() + layer_insert_index_,
-                        layer);
-    if (it != layers_.begin() + layer_insert_index_) {
-      hidden_layers_.push_back(layer);
-      layers_.erase(it);
-      layer_insert_index_--;
-    }
-  }
+  /// @brief Stops rendering the layer. It still receives events.
+  /// @return Returns false if the handle is no longer valid.
+  bool HideLayer(LayerHandle handle) { return SetVisible(handle, false); }
 
-  void ShowLayer(std::shared_ptr<Layer> layer) {
-    auto it = std::find(hidden_layers_.begin(), hidden_layers_.end(), layer);
-    if (it != hidden_layers_.end()) {
-      layers_.emplace(layers_.begin() + layer_insert_index_, layer);
-      layer_insert_index_++;
-      hidden_layers_.erase(it);
-    }
-  }
+  /// @brief Renders a hidden layer again at its previous position.
+  /// @return Returns false if the handle is no longer valid.
+  bool ShowLayer(LayerHandle handle) { return SetVisible(handle, true); }
 
-  void clear() {
-    for (std::shared_ptr<Layer> layer : layers_) {
-      layer->OnDetach();
-      layer.reset();
-    }
-    for (std::shared_ptr<Layer> layer : hidden_layers_) {
-      layer->OnDetach();
-      layer.reset();
-    }
+  /// @brief Returns the layer of handle or nullptr if it was popped.
+  Layer *Get(LayerHandle handle) const {
+    const Slot *slot = Find(handle);
+    return slot ? slot->layer.get() : nullptr;
   }
 
-  std::vector<std::shared_ptr<Layer>>::iterator begin() {
-    return layers_.begin();
-  }
-  std::vector<std::shared_ptr<Layer>>::iterator end() { return layers_.end(); }
-  std::vector<std::shared_ptr<Layer>>::reverse_iterator rbegin() {
-    return layers_.rbegin();
+  /// @brief Returns true if the layer of handle exists and is rendered.
+  bool IsVisible(LayerHandle handle) const {
+    const Slot *slot = Find(handle);
+    return slot && order_[slot->position].visible;
   }
-  std::vector<std::shared_ptr<Layer>>::reverse_iterator rend() {
-    return layers_.rend();
+
+  /// @brief Calls f with every visible layer in render order, overlays
+  /// last.
+  template <typename F>
+  void ForEachVisible(F &&f) const {
+    for (const Entry &entry : order_)
+      if (entry.visible) f(*entry.layer);
   }
 
-  std::vector<std::shared_ptr<Layer>>::const_iterator begin() const {
-    return layers_.begin();
+  /// @brief Calls f with every layer, hidden ones included.
+  template <typename F>
+  void ForEach(F &&f) const {
+    for (const Entry &entry : order_)
+      if (entry.layer) f(*entry.layer);
   }
-  std::vector<std::shared_ptr<Layer>>::const_iterator end() const {
-    return layers_.end();
+
+  /// @brief Delivers the events posted since the last call to all layers,
+  /// hidden ones included. Must be called before the layers are rendered.
+  /// @return Returns the number of delivered events.
+  std::size_t DispatchEvents() {
+    return event_bus_.Dispatch([this](const Event &event) {
+      ForEach([&event](Layer &layer) { layer.OnEvent(event); });
+    });
   }
-  std::vector<std::shared_ptr<Layer>>::const_reverse_iterator rbegin() const {
-    return layers_.rbegin();
+
+  /// @brief Releases the per-frame allocations of all layers and closes the
+  /// gaps of popped layers. Must be called after ImGui::Render().
+  void EndFrame();
+
+  /// @brief Detaches and releases all layers. Their handles become invalid.
+  void clear();
+
+  /// @brief Returns the number of layers including hidden ones and
+  /// overlays.
+  std::size_t size() const { return order_.size() - gaps_; }
+
+  const FrameArena &frame_arena() const { return frame_arena_; }
+  EventBus &events() { return event_bus_; }
+
+ private:
+  // One entry of the render order, nullptr marks a popped layer
+  struct Entry {
+    Layer *layer = nullptr;
+    std::uint32_t slot = 0;
+    bool visible = false;
+  };
+
+  // Owns the layer and remembers where it is in the render order
+  struct Slot {
+    std::shared_ptr<Layer> layer;
+    std::uint32_t generation = 1;
+    std::uint32_t position = 0;
+  };
+
+  LayerHandle Insert(std::shared_ptr<Layer> layer, std::size_t position);
+  bool SetVisible(LayerHandle handle, bool visible);
+
+  const Slot *Find(LayerHandle handle) const {
+    if (handle.index >= slots_.size()) return nullptr;
+    const Slot &slot = slots_[handle.index];
+    return slot.layer && slot.generation == handle.generation ? &slot
+                                                              : nullptr;
   }
-  std::vector<std::shared_ptr<Layer>>::const_reverse_iterator rend() const {
-    return layers_.rend();
+  Slot *Find(LayerHandle handle) {
+    return const_cast<Slot *>(std::as_const(*this).Find(handle));
   }
 
- private:
-  std::vector<std::shared_ptr<Layer>> layers_;
-  std::vector<std::shared_ptr<Layer>> hidden_layers_;
-  unsigned int layer_insert_index_ = 0;
+  FrameArena frame_arena_;
+  EventBus event_bus_;
+
+  std::vector<Entry> order_;
+  std::vector<Slot> slots_;
+  std::vector<std::uint32_t> free_slots_;
+  // Entries before it are layers, the ones from it on overlays
+  std::size_t overlay_begin_ = 0;
+  std::size_t gaps_ = 0;
 };
 
 }  // namespace utils
@@ -128,4 +171,4 @@ class LayerStack {
 
 }  // namespace spauly
 
-#endif  // SPAULY_VISCO_UTILS_LAYERSTACK_H
\ No newline at end of file
+#endif  // SPAULY_VISCO_UTILS_LAYERSTACK_H
@@ -0,0 +1,112 @@
+// Visco Correct Desktop - Correction factors for centrifugal pumps
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Visco-Correct-Desktop>
+#ifndef SPAULY_VISCO_UTILS_MPSC_QUEUE_H
+#define SPAULY_VISCO_UTILS_MPSC_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+namespace spauly {
+namespace visco {
+namespace utils {
+
+/// @brief A bounded lock-free queue for many producers and a single consumer.
+/// Every slot carries a sequence number that tells producers and the consumer
+/// whose turn it is, so neither side ever blocks the other. The capacity is
+/// rounded up to a power of two and all slots are allocated up front.
+template <typename T>
+class MpscQueue {
+ public:
+  explicit MpscQueue(std::size_t capacity = 1024) {
+    std::size_t size = 2;
+    while (size < capacity) size <<= 1;
+    mask_ = size - 1;
+    slots_ = std::make_unique<Slot[]>(size);
+    for (std::size_t i = 0; i < size; i++)
+      slots_[i].sequence.store(i, std::memory_order_relaxed);
+  }
+  ~MpscQueue() = default;
+
+  MpscQueue(const MpscQueue &) = delete;
+  MpscQueue &operator=(const MpscQueue &) = delete;
+
+  /// @brief Appends value. Safe to call from any thread.
+  /// @return Returns false if the queue is full, value is left untouched.
+  bool TryPush(T &value) {
+    std::size_t position = tail_.load(std::memory_order_relaxed);
+    while (true) {
+      Slot &slot = slots_[position & mask_];
+      const std::size_t sequence =
+          slot.sequence.load(std::memory_order_acquire);
+      const auto difference = static_cast<std::intptr_t>(sequence) -
+                              static_cast<std::intptr_t>(position);
+      if (difference == 0) {
+        if (tail_.compare_exchange_weak(position, position + 1,
+                                        std::memory_order_relaxed)) {
+          slot.value = std::move(value);
+          slot.sequence.store(position + 1, std::memory_order_release);
+          return true;
+        }
+      } else if (difference < 0) {
+        return false;
+      } else {
+        position = tail_.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  /// @brief Removes the oldest value. Must only be called by the consumer.
+  /// @return Returns false if the queue is empty.
+  bool TryPop(T &value) {
+    Slot &slot = slots_[head_ & mask_];
+    const std::size_t sequence = slot.sequence.load(std::memory_order_acquire);
+    if (sequence != head_ + 1) return false;
+
+    value = std::move(slot.value);
+    slot.value = T();
+    slot.sequence.store(head_ + mask_ + 1, std::memory_order_release);
+    head_++;
+    return true;
+  }
+
+  std::size_t capacity() const { return mask_ + 1; }
+
+ private:
+  struct Slot {
+    std::atomic<std::size_t> sequence;
+    T value;
+  };
+
+  std::unique_ptr<Slot[]> slots_;
+  std::size_t mask_ = 0;
+
+  // Producers and the consumer work on separate cache lines
+  alignas(64) std::atomic<std::size_t> tail_ = 0;
+  alignas(64) std::size_t head_ = 0;
+};
+
+}  // namespace utils
+
+}  // namespace visco
+
+}  // namespace spauly
+
+#endif  // SPAULY_VISCO_UTILS_MPSC_QUEUE_H
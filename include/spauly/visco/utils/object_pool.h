@@ -0,0 +1,88 @@
+// Visco Correct Desktop - Correction factors for centrifugal pumps
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Visco-Correct-Desktop>
+#ifndef SPAULY_VISCO_UTILS_OBJECT_POOL_H
+#define SPAULY_VISCO_UTILS_OBJECT_POOL_H
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <utility>
+
+namespace spauly {
+namespace visco {
+namespace utils {
+
+/// @brief Pool for objects that live across frames, e.g. the layers and the
+/// state they keep. Freed blocks are kept in per-size free lists and reused,
+/// so objects that come and go while the application runs stop allocating
+/// from the heap once the pool has warmed up. Not thread safe, objects must
+/// be created and released on the UI thread. The pool must outlive all of
+/// its objects.
+class ObjectPool : public std::pmr::memory_resource {
+ public:
+  ObjectPool() = default;
+  virtual ~ObjectPool() = default;
+
+  ObjectPool(const ObjectPool &) = delete;
+  ObjectPool &operator=(const ObjectPool &) = delete;
+
+  /// @brief Creates a T whose object and control block are both allocated
+  /// from the pool.
+  template <typename T, typename... Args>
+  std::shared_ptr<T> MakeShared(Args &&...args) {
+    return std::allocate_shared<T>(std::pmr::polymorphic_allocator<T>(this),
+                                   std::forward<Args>(args)...);
+  }
+
+  /// @brief Returns the number of blocks currently handed out.
+  std::size_t live() const { return live_; }
+
+  /// @brief Returns the number of blocks handed out since construction.
+  std::size_t allocations() const { return allocations_; }
+
+ protected:
+  virtual void *do_allocate(std::size_t bytes,
+                            std::size_t alignment) override {
+    void *block = pool_.allocate(bytes, alignment);
+    live_++;
+    allocations_++;
+    return block;
+  }
+  virtual void do_deallocate(void *block, std::size_t bytes,
+                             std::size_t alignment) override {
+    pool_.deallocate(block, bytes, alignment);
+    live_--;
+  }
+  virtual bool do_is_equal(
+      const std::pmr::memory_resource &other) const noexcept override {
+    return this == &other;
+  }
+
+ private:
+  std::pmr::unsynchronized_pool_resource pool_;
+  std::size_t live_ = 0;
+  std::size_t allocations_ = 0;
+};
+
+}  // namespace utils
+
+}  // namespace visco
+
+}  // namespace spauly
+
+#endif  // SPAULY_VISCO_UTILS_OBJECT_POOL_H
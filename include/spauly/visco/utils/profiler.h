@@ -0,0 +1,166 @@
+// Visco Correct Desktop - Correction factors for centrifugal pumps
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Visco-Correct-Desktop>
+#ifndef SPAULY_VISCO_UTILS_PROFILER_H
+#define SPAULY_VISCO_UTILS_PROFILER_H
+
+// Scoped timers for the frame phases. Everything below compiles to nothing
+// unless the build defines VCD_PROFILING (CMake option VCD_PROFILING).
+//
+//   VCD_PROFILE_SCOPE("ImGui::Render");  // Times the enclosing scope
+//   VCD_PROFILE_FRAME();                 // Closes the current frame
+//   VCD_PROFILE_IMGUI_ALLOCATIONS();     // Before ImGui::CreateContext()
+
+#ifdef VCD_PROFILING
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "spauly/visco/utils/allocation_counter.h"
+
+namespace spauly {
+namespace visco {
+namespace utils {
+
+/// @brief Collects the durations of named scopes. Per frame the time of each
+/// scope is summed up and kept for the last kWindowFrames frames, which the
+/// percentiles are computed from. The raw scopes of the last kTraceCapacity
+/// events are kept for the Chrome trace export. Scope names must be string
+/// literals or otherwise outlive the profiler.
+class Profiler {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  static constexpr std::size_t kWindowFrames = 240;
+  static constexpr std::size_t kTraceCapacity = 1 << 16;
+
+  /// @brief Percentiles of the per-frame time of a scope in milliseconds.
+  struct ScopeStats {
+    const char *name = nullptr;
+    double p50 = 0.0;
+    double p95 = 0.0;
+    double p99 = 0.0;
+    double max = 0.0;
+    double last = 0.0;
+  };
+
+  /// @brief Heap allocations per frame of the thread that closes the frames,
+  /// see allocation_counter.h.
+  struct AllocationStats {
+    std::uint64_t last = 0;
+    std::uint64_t max = 0;  // Over the window
+    std::uint64_t total = 0;
+  };
+
+  static Profiler &Get();
+
+  /// @brief Records a finished scope. Thread safe.
+  void Record(const char *name, Clock::time_point start, Clock::time_point end);
+
+  /// @brief Closes the current frame and moves the summed up scope times
+  /// into the rolling windows.
+  void EndFrame();
+
+  /// @brief Computes the percentiles of every scope over the window. The
+  /// overlay passes a vector on the frame arena, so it is reserved up front.
+  void CollectStats(std::pmr::vector<ScopeStats> &stats) const;
+
+  AllocationStats allocation_stats() const;
+
+  /// @brief Writes the recorded events in the Chrome trace event format
+  /// (chrome://tracing, Perfetto).
+  /// @return Returns false if the file could not be written.
+  bool ExportChromeTrace(const std::string &path) const;
+
+  std::uint64_t frame_count() const { return frame_count_; }
+
+ private:
+  Profiler();
+
+  struct Scope {
+    const char *name = nullptr;
+    double current = 0.0;  // Summed up time of the running frame in ms
+    std::array<float, kWindowFrames> window = {};
+  };
+
+  struct Event {
+    const char *name;
+    std::int64_t start_us;
+    std::int64_t duration_us;
+    std::uint32_t thread;
+  };
+
+  Scope &FindScope(const char *name);
+
+  mutable std::mutex mutex_;
+  std::vector<Scope> scopes_;
+  std::vector<Event> trace_;
+  std::size_t trace_next_ = 0;
+  std::uint64_t frame_count_ = 0;
+  std::array<std::uint64_t, kWindowFrames> allocations_ = {};
+  std::uint64_t allocation_count_ = 0;
+};
+
+/// @brief Records the lifetime of the object under name.
+class ProfileScope {
+ public:
+  explicit ProfileScope(const char *name)
+      : name_(name), start_(Profiler::Clock::now()) {}
+  ~ProfileScope() {
+    Profiler::Get().Record(name_, start_, Profiler::Clock::now());
+  }
+
+  ProfileScope(const ProfileScope &) = delete;
+  ProfileScope &operator=(const ProfileScope &) = delete;
+
+ private:
+  const char *name_;
+  Profiler::Clock::time_point start_;
+};
+
+}  // namespace utils
+
+}  // namespace visco
+
+}  // namespace spauly
+
+#define VCD_PROFILE_CONCAT_IMPL(a, b) a##b
+#define VCD_PROFILE_CONCAT(a, b) VCD_PROFILE_CONCAT_IMPL(a, b)
+#define VCD_PROFILE_SCOPE(name)                            \
+  ::spauly::visco::utils::ProfileScope VCD_PROFILE_CONCAT( \
+      vcd_profile_scope_, __LINE__)(name)
+#define VCD_PROFILE_FRAME() ::spauly::visco::utils::Profiler::Get().EndFrame()
+// Counts the allocations of ImGui itself in the per frame statistics
+#define VCD_PROFILE_IMGUI_ALLOCATIONS()                               \
+  ImGui::SetAllocatorFunctions(::spauly::visco::utils::CountedAlloc, \
+                               ::spauly::visco::utils::CountedFree)
+
+#else
+
+#define VCD_PROFILE_SCOPE(name) ((void)0)
+#define VCD_PROFILE_FRAME() ((void)0)
+#define VCD_PROFILE_IMGUI_ALLOCATIONS() ((void)0)
+
+#endif  // VCD_PROFILING
+
+#endif  // SPAULY_VISCO_UTILS_PROFILER_H
@@ -0,0 +1,164 @@
+// Visco Correct Desktop - Correction factors for centrifugal pumps
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Visco-Correct-Desktop>
+#ifndef SPAULY_VISCO_UTILS_RESULT_CACHE_H
+#define SPAULY_VISCO_UTILS_RESULT_CACHE_H
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <unordered_map>
+
+#include "spauly/vccore/data.h"
+#include "spauly/visco/batch/unit_conversion.h"
+
+namespace spauly {
+namespace visco {
+namespace utils {
+
+/// @brief A bounded least-recently-used cache of correction factors. Inputs
+/// are quantised to the precision the calculator view displays (three
+/// decimals), so points that only differ below that precision share an entry.
+/// The range flags of the exact input are part of the key, so points on
+/// either side of a chart limit never share one.
+class ResultCache {
+ public:
+  static constexpr std::size_t kDefaultCapacity = 256;
+  static constexpr double kQuantum = 1e-3;
+
+  explicit ResultCache(std::size_t capacity = kDefaultCapacity)
+      : capacity_((capacity == 0) ? 1 : capacity) {
+    index_.reserve(capacity_);
+  }
+  ~ResultCache() = default;
+
+  /// @brief Returns the cached factors for the point or calls calculate(params,
+  /// units) and stores its result.
+  template <typename Function>
+  const vccore::CorrectionFactors &GetOrCalculate(
+      const vccore::Parameters &params, const vccore::Units &units,
+      Function &&calculate) {
+    const Key key = MakeKey(params, units);
+
+    auto it = index_.find(key);
+    if (it != index_.end()) {
+      hits_++;
+      entries_.splice(entries_.begin(), entries_, it->second);
+      return it->second->result;
+    }
+
+    misses_++;
+    if (entries_.size() == capacity_) {
+      index_.erase(entries_.back().key);
+      entries_.pop_back();
+    }
+    entries_.push_front({key, calculate(params, units)});
+    index_.emplace(key, entries_.begin());
+    return entries_.front().result;
+  }
+
+  /// @brief Removes all entries but keeps the counters.
+  void clear() {
+    entries_.clear();
+    index_.clear();
+  }
+
+  /// @brief Resets the hit and miss counters.
+  void ResetCounters() { hits_ = misses_ = 0; }
+
+  std::size_t size() const { return entries_.size(); }
+  std::size_t capacity() const { return capacity_; }
+  std::uint64_t hits() const { return hits_; }
+  std::uint64_t misses() const { return misses_; }
+
+ private:
+  struct Key {
+    std::int64_t flowrate;
+    std::int64_t total_head;
+    std::int64_t viscosity;
+    std::int64_t density;
+    std::uint32_t units;
+    std::uint32_t range_flags;
+
+    bool operator==(const Key &other) const = default;
+  };
+
+  struct KeyHash {
+    std::size_t operator()(const Key &key) const {
+      std::uint64_t hash = 0xcbf29ce484222325ull;
+      for (std::uint64_t value :
+           {static_cast<std::uint64_t>(key.flowrate),
+            static_cast<std::uint64_t>(key.total_head),
+            static_cast<std::uint64_t>(key.viscosity),
+            static_cast<std::uint64_t>(key.density),
+            static_cast<std::uint64_t>(key.units),
+            static_cast<std::uint64_t>(key.range_flags)}) {
+        hash ^= value;
+        hash *= 0x100000001b3ull;
+        hash ^= hash >> 29;
+      }
+      return static_cast<std::size_t>(hash);
+    }
+  };
+
+  struct Entry {
+    Key key;
+    vccore::CorrectionFactors result;
+  };
+
+  static std::int64_t Quantise(double value) {
+    // NaN and infinite inputs share one bucket each, they all yield errors
+    if (std::isnan(value)) return INT64_MIN;
+    if (std::abs(value) > 1e15) return (value > 0) ? INT64_MAX : INT64_MIN + 1;
+    return std::llround(value / kQuantum);
+  }
+
+  static Key MakeKey(const vccore::Parameters &params,
+                     const vccore::Units &units) {
+    const bool dynamic = units.viscosity == vccore::ViscosityUnit::kcP ||
+                         units.viscosity == vccore::ViscosityUnit::kmPas;
+
+    Key key;
+    key.flowrate = Quantise(params.flowrate);
+    key.total_head = Quantise(params.total_head);
+    key.viscosity = Quantise(params.viscosity);
+    // The density is only used for dynamic viscosities
+    key.density = dynamic ? Quantise(params.density) : 0;
+    key.units = static_cast<std::uint32_t>(units.flowrate) |
+                static_cast<std::uint32_t>(units.total_head) << 8 |
+                static_cast<std::uint32_t>(units.viscosity) << 16 |
+                (dynamic ? static_cast<std::uint32_t>(units.density) << 24 : 0);
+    key.range_flags = static_cast<std::uint32_t>(batch::CheckRanges(
+        batch::Normalise(params, batch::GetUnitScale(units))));
+    return key;
+  }
+
+  std::size_t capacity_;
+  std::list<Entry> entries_;
+  std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> index_;
+  std::uint64_t hits_ = 0;
+  std::uint64_t misses_ = 0;
+};
+
+}  // namespace utils
+
+}  // namespace visco
+
+}  // namespace spauly
+
+#endif  // SPAULY_VISCO_UTILS_RESULT_CACHE_H
@@ -17,13 +17,24 @@
 // Contact via <https://github.com/SPauly/Visco-Correct-Desktop>
 #include "spauly/visco/application.h"
 
+#include <chrono>
 #include <memory>
+#include <string>
+#include <utility>
 
-#include "spauly/visco/calculator_view.h"
+#include "spauly/visco/profiler_overlay.h"
+#include "spauly/visco/utils/profiler.h"
 
 namespace spauly {
 namespace visco {
 
+namespace {
+
+constexpr const char *kWorkspacePath = "workspace.vcproj";
+constexpr const char *kJsonPath = "workspace.json";
+
+}  // namespace
+
 Application::~Application() { Shutdown(); }
 
 bool Application::Init() {
@@ -43,7 +54,28 @@ bool Application::Init() {
   viewport_ = ImGui::GetMainViewport();
 
   // Register the layers
-  layer_stack_.PushLayer(std::make_shared<CalculatorView>());
+  calculator_view_ = layer_pool_.MakeShared<CalculatorView>();
+  layer_stack_.PushLayer(calculator_view_);
+
+  // The graph is only rendered while it is shown
+  graph_view_ = layer_pool_.MakeShared<GraphView>(calculator_view_, jobs_);
+  graph_layer_ = layer_stack_.PushLayer(graph_view_);
+  SetLayerVisible(graph_layer_, show_graph_);
+
+  study_view_ = layer_pool_.MakeShared<StudyView>(jobs_, scheduler_);
+  study_layer_ = layer_stack_.PushLayer(study_view_);
+  SetLayerVisible(study_layer_, show_study_);
+
+  results_view_ = layer_pool_.MakeShared<ResultsView>(jobs_);
+  results_layer_ = layer_stack_.PushLayer(results_view_);
+  SetLayerVisible(results_layer_, show_results_);
+
+  solver_view_ = layer_pool_.MakeShared<SolverView>();
+  solver_layer_ = layer_stack_.PushLayer(solver_view_);
+  SetLayerVisible(solver_layer_, show_solver_);
+#ifdef VCD_PROFILING
+  layer_stack_.PushOverlay(layer_pool_.MakeShared<ProfilerOverlay>());
+#endif
 
   return true;
 }
@@ -51,40 +83,100 @@ bool Application::Init() {
 void Application::Shutdown() {}
 
 bool Application::Render() {
-  // Render all layers
-  for (const auto& layer : layer_stack_) {
-    layer->OnUIRender(current_flags_);
+  scheduler_.OnFrameBegin(utils::FrameScheduler::Clock::now());
+
+  // Hand the results of finished jobs to the layers
+  {
+    VCD_PROFILE_SCOPE("JobSystem::Poll");
+    jobs_.Poll();
   }
 
+  // Let the layers react to what changed during the last frame
+  {
+    VCD_PROFILE_SCOPE("LayerStack::DispatchEvents");
+    layer_stack_.DispatchEvents();
+  }
+
+  // The projects are docked into the dockspace covering the main viewport
+  calculator_view_->set_dock_id(ImGui::DockSpaceOverViewport(0, viewport_));
+
+  // Render all layers
+  layer_stack_.ForEachVisible([this](utils::Layer &layer) {
+    VCD_PROFILE_SCOPE(layer.name());
+    layer.OnUIRender(current_flags_);
+  });
+
   MenuBar();
+  Shortcuts();
+  if (autosave_)
+    autosaver_.Update(calculator_view_->projects(),
+                      ProjectAutosaver::Clock::now());
+  UpdateScheduler();
   return true;
 }
 
+void Application::UpdateScheduler() {
+  // ImGui blinks the text cursor in 0.4s steps
+  constexpr auto kCursorBlinkStep = std::chrono::milliseconds(400);
+  // Progress of running jobs is shown at about 30 fps
+  constexpr auto kJobPollStep = std::chrono::milliseconds(33);
+
+  const auto now = utils::FrameScheduler::Clock::now();
+  if (jobs_.pending() != 0) scheduler_.RequestFrameAt(now + kJobPollStep);
+  // Queued events are delivered by the next frame
+  if (layer_stack_.events().pending() != 0) scheduler_.NotifyEvent();
+  if (io_->WantTextInput)
+    scheduler_.RequestFrameAt(now + kCursorBlinkStep);
+  else if (ImGui::IsAnyItemActive())
+    scheduler_.RequestAnimationFrame();
+
+  // Changes made outside of a layer's own widgets, e.g. from the menu
+  bool redraw = false;
+  layer_stack_.ForEachVisible(
+      [&redraw](const utils::Layer &layer) { redraw |= layer.NeedsRedraw(); });
+  if (redraw) scheduler_.NotifyEvent();
+
+  scheduler_.OnFrameRendered();
+}
+
 void Application::MenuBar() {
   if (ImGui::BeginMainMenuBar()) {
     if (ImGui::BeginMenu("Menu")) {
-      ImGui::MenuItem("Add Project", "STRG + P");
+      if (ImGui::MenuItem("Add Project", "STRG + P"))
+        calculator_view_->AddProject();
+      ImGui::Separator();
+      if (ImGui::MenuItem("Open workspace", "STRG + O"))
+        OpenWorkspace(kWorkspacePath);
+      if (ImGui::MenuItem("Save workspace", "STRG + S"))
+        SaveWorkspace(kWorkspacePath, false);
+      if (ImGui::MenuItem("Export as JSON")) SaveWorkspace(kJsonPath, true);
+      if (ImGui::MenuItem("Restore autosave"))
+        OpenWorkspace(autosaver_.path().c_str());
+      ImGui::MenuItem("Autosave", "", &autosave_);
       ImGui::EndMenu();
     }
     if (ImGui::BeginMenu("View")) {
-      if (ImGui::MenuItem("Toggle Dark/Light mode", "", &use_dark_mode))
+      if (ImGui::MenuItem("Toggle Dark/Light mode", "", &use_dark_mode)) {
         SetStyle();
-      if (ImGui::MenuItem("Show Graph", "STRG + G", &show_graph_)) {
-        if (show_graph_) {
-          // Resize window and show graph
-        } else {
-          // Remove graph window and resize
-        }
+        layer_stack_.events().Post(utils::ThemeChangedEvent{use_dark_mode});
       }
+      if (ImGui::MenuItem("Power saving", "", &power_saving_))
+        scheduler_.set_mode(power_saving_ ? utils::RenderMode::kEventDriven
+                                          : utils::RenderMode::kContinuous);
+      if (ImGui::MenuItem("Show Graph", "STRG + G", &show_graph_))
+        SetLayerVisible(graph_layer_, show_graph_);
+      if (ImGui::MenuItem("Parametric study", "", &show_study_))
+        SetLayerVisible(study_layer_, show_study_);
+      if (ImGui::MenuItem("Results table", "", &show_results_))
+        SetLayerVisible(results_layer_, show_results_);
+      if (ImGui::MenuItem("Reverse solver", "", &show_solver_))
+        SetLayerVisible(solver_layer_, show_solver_);
 
       if (ImGui::MenuItem("Enable open workspace", "", &use_open_workspace)) {
-        if (use_open_workspace) {
-          current_flags_ = open_workspace_flags_;
-          ;  // Forward the flags to the graph
-        } else {
-          current_flags_ = closed_workspace_flags_;
-          ;  // Forward the flags to the graph
-        }
+        current_flags_ = use_open_workspace ? open_workspace_flags_
+                                            : closed_workspace_flags_;
+        layer_stack_.events().Post(
+            utils::WorkspaceModeChangedEvent{use_open_workspace});
       }
       ImGui::EndMenu();
     }
@@ -95,10 +187,78 @@ void Application::MenuBar() {
 
       ImGui::EndMenu();
     }
+    if (!status_.empty()) {
+      ImGui::Separator();
+      ImGui::TextUnformatted(status_.c_str());
+    }
     ImGui::EndMainMenuBar();
   }
 }
 
+void Application::Shortcuts() {
+  if (!io_->KeyCtrl) return;
+
+  if (ImGui::IsKeyPressed(ImGuiKey_P, false)) calculator_view_->AddProject();
+  if (ImGui::IsKeyPressed(ImGuiKey_O, false)) OpenWorkspace(kWorkspacePath);
+  if (ImGui::IsKeyPressed(ImGuiKey_S, false))
+    SaveWorkspace(kWorkspacePath, false);
+  if (ImGui::IsKeyPressed(ImGuiKey_G, false)) {
+    show_graph_ = !show_graph_;
+    SetLayerVisible(graph_layer_, show_graph_);
+  }
+}
+
+void Application::OpenWorkspace(const char *path) {
+  // Mapped and copied once, fast enough for the UI thread
+  ProjectStore projects;
+  if (LoadProjects(path, projects)) {
+    calculator_view_->SetProjects(std::move(projects));
+    status_ = std::string("Opened ") + path;
+  } else {
+    status_ = std::string("Could not open ") + path;
+  }
+}
+
+void Application::SaveWorkspace(const char *path, bool json) {
+  if (!save_job_.valid()) {
+    StartSave(path, json);
+    return;
+  }
+
+  // The queued save takes its snapshot when it starts, so repeated requests
+  // for the same file collapse into one
+  for (const SaveRequest &request : queued_saves_)
+    if (request.path == path && request.json == json) return;
+  queued_saves_.push_back({path, json});
+}
+
+void Application::StartSave(std::string path, bool json) {
+  auto projects = std::make_shared<ProjectStore>(calculator_view_->projects());
+  auto ok = std::make_shared<bool>(false);
+  status_ = "Saving " + path + "...";
+  save_job_ = jobs_.Submit(
+      [projects, path, json, ok](utils::Job &) {
+        *ok = json ? ExportProjectsJson(*projects, path)
+                   : SaveProjects(*projects, path);
+      },
+      [this, path, ok](utils::JobStatus) {
+        save_job_.reset();
+        status_ = (*ok ? "Written to " : "Could not write ") + path;
+        if (queued_saves_.empty()) return;
+        SaveRequest next = std::move(queued_saves_.front());
+        queued_saves_.erase(queued_saves_.begin());
+        StartSave(std::move(next.path), next.json);
+      });
+}
+
+void Application::SetLayerVisible(utils::LayerHandle layer, bool visible) {
+  if (visible)
+    layer_stack_.ShowLayer(layer);
+  else
+    layer_stack_.HideLayer(layer);
+  scheduler_.NotifyEvent();
+}
+
 void Application::ConfigWindow() {
   style_ = &ImGui::GetStyle();
   colors_ = style_->Colors;
@@ -5,10 +5,13 @@
 #include <dxgi1_4.h>
 #include <tchar.h>
 
+#include <chrono>
+
 #include "imgui.h"
 #include "imgui_impl_win32.h"
 #include "imgui_impl_dx12.h"
-#include "spauly/visco/application.h"
+#include "spauly/visco/backend/backend.h"
+#include "spauly/visco/utils/profiler.h"
 
 #ifdef _DEBUG
 #define DX12_ENABLE_DEBUG_LAYER
@@ -56,154 +59,208 @@ void WaitForLastSubmittedFrame();
 FrameContext* WaitForNextFrameResources();
 LRESULT WINAPI WndProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam);
 
-// Main code
-int main(int, char**) {
-  // Create application window
-  ImGui_ImplWin32_EnableDpiAwareness();
-  WNDCLASSEXW wc = {sizeof(wc),
-                    CS_CLASSDC,
-                    WndProc,
-                    0L,
-                    0L,
-                    GetModuleHandle(nullptr),
-                    nullptr,
-                    nullptr,
-                    nullptr,
-                    nullptr,
-                    L"ImGui Example",
-                    nullptr};
-  ::RegisterClassExW(&wc);
-  HWND hwnd = ::CreateWindowW(wc.lpszClassName, L"Visco Correct",
-                              WS_OVERLAPPEDWINDOW, 100, 100, 445, 650, nullptr,
-                              nullptr, wc.hInstance, nullptr);
-
-  // Initialize Direct3D
-  if (!CreateDeviceD3D(hwnd)) {
-    CleanupDeviceD3D();
-    ::UnregisterClassW(wc.lpszClassName, wc.hInstance);
-    return 1;
+namespace {
+
+using namespace spauly::visco;
+
+// How often the swap chain is tested while the window is occluded
+constexpr DWORD kOccludedPollMs = 250;
+
+class Dx12Backend : public backend::Backend {
+ public:
+  Dx12Backend() = default;
+  ~Dx12Backend() override { Shutdown(); }
+
+  bool Init(const backend::BackendConfig& config) override {
+    clear_color_ = config.clear_color;
+    vsync_ = config.vsync;
+
+    // Create application window
+    ImGui_ImplWin32_EnableDpiAwareness();
+    wc_ = {sizeof(wc_),
+           CS_CLASSDC,
+           WndProc,
+           0L,
+           0L,
+           GetModuleHandle(nullptr),
+           nullptr,
+           nullptr,
+           nullptr,
+           nullptr,
+           L"ImGui Example",
+           nullptr};
+    ::RegisterClassExW(&wc_);
+    class_registered_ = true;
+
+    wchar_t title[256] = {};
+    ::MultiByteToWideChar(CP_UTF8, 0, config.title, -1, title,
+                          IM_ARRAYSIZE(title) - 1);
+    hwnd_ = ::CreateWindowW(wc_.lpszClassName, title, WS_OVERLAPPEDWINDOW, 100,
+                            100, config.width, config.height, nullptr,
+                            nullptr, wc_.hInstance, nullptr);
+    if (!hwnd_) return false;
+
+    // Initialize Direct3D
+    if (!CreateDeviceD3D(hwnd_)) return false;
+    device_created_ = true;
+
+    // Show the window
+    ::ShowWindow(hwnd_, SW_SHOWDEFAULT);
+    ::UpdateWindow(hwnd_);
+
+    // Setup Dear ImGui context
+    IMGUI_CHECKVERSION();
+    VCD_PROFILE_IMGUI_ALLOCATIONS();
+    ImGui::CreateContext();
+    ImGuiIO& io = ImGui::GetIO();
+    (void)io;
+    io.ConfigFlags |=
+        ImGuiConfigFlags_NavEnableKeyboard;  // Enable Keyboard Controls
+    io.ConfigFlags |=
+        ImGuiConfigFlags_NavEnableGamepad;  // Enable Gamepad Controls
+    io.ConfigFlags |= ImGuiConfigFlags_DockingEnable;  // Enable Docking
+    io.ConfigFlags |=
+        ImGuiConfigFlags_ViewportsEnable;  // Enable Multi-Viewport
+                                           // / Platform Windows
+    imgui_initialized_ = true;
+
+    // Setup Platform/Renderer backends
+    return ImGui_ImplWin32_Init(hwnd_) &&
+           ImGui_ImplDX12_Init(
+               g_pd3dDevice, NUM_FRAMES_IN_FLIGHT, DXGI_FORMAT_R8G8B8A8_UNORM,
+               g_pd3dSrvDescHeap,
+               g_pd3dSrvDescHeap->GetCPUDescriptorHandleForHeapStart(),
+               g_pd3dSrvDescHeap->GetGPUDescriptorHandleForHeapStart());
   }
 
-  // Show the window
-  ::ShowWindow(hwnd, SW_SHOWDEFAULT);
-  ::UpdateWindow(hwnd);
-
-  // Setup Dear ImGui context
-  IMGUI_CHECKVERSION();
-  ImGui::CreateContext();
-  ImGuiIO& io = ImGui::GetIO();
-  (void)io;
-  io.ConfigFlags |=
-      ImGuiConfigFlags_NavEnableKeyboard;  // Enable Keyboard Controls
-  io.ConfigFlags |=
-      ImGuiConfigFlags_NavEnableGamepad;             // Enable Gamepad Controls
-  io.ConfigFlags |= ImGuiConfigFlags_DockingEnable;  // Enable Docking
-  io.ConfigFlags |= ImGuiConfigFlags_ViewportsEnable;  // Enable Multi-Viewport
-                                                       // / Platform Windows
-
-  ImVec4 clear_color = ImVec4(0.45f, 0.55f, 0.60f, 1.00f);
-
-  spauly::visco::Application app;
-  if (!app.Init()) {
-    // Cleanup
-    ImGui_ImplDX12_Shutdown();
-    ImGui_ImplWin32_Shutdown();
-    ImGui::DestroyContext();
-
-    CleanupDeviceD3D();
-    ::UnregisterClassW(wc.lpszClassName, wc.hInstance);
-    return 1;
+  void Shutdown() override {
+    if (imgui_initialized_) {
+      WaitForLastSubmittedFrame();
+      ImGui_ImplDX12_Shutdown();
+      ImGui_ImplWin32_Shutdown();
+      ImGui::DestroyContext();
+      imgui_initialized_ = false;
+    }
+    if (device_created_ || hwnd_) {
+      CleanupDeviceD3D();
+      device_created_ = false;
+    }
+    if (hwnd_) {
+      ::DestroyWindow(hwnd_);
+      hwnd_ = nullptr;
+    }
+    if (class_registered_) {
+      ::UnregisterClassW(wc_.lpszClassName, wc_.hInstance);
+      class_registered_ = false;
+    }
   }
 
-  // Setup Platform/Renderer backends
-  ImGui_ImplWin32_Init(hwnd);
-  ImGui_ImplDX12_Init(g_pd3dDevice, NUM_FRAMES_IN_FLIGHT,
-                      DXGI_FORMAT_R8G8B8A8_UNORM, g_pd3dSrvDescHeap,
-                      g_pd3dSrvDescHeap->GetCPUDescriptorHandleForHeapStart(),
-                      g_pd3dSrvDescHeap->GetGPUDescriptorHandleForHeapStart());
+  bool ProcessEvents(utils::FrameScheduler& scheduler) override {
+    using Clock = utils::FrameScheduler::Clock;
+
+    // Block until a message arrives or the scheduler wants the next frame, so
+    // an unchanged UI neither renders nor presents.
+    Clock::duration timeout = scheduler.WaitTimeout(Clock::now());
+    DWORD timeout_ms = 0;
+    if (::IsIconic(hwnd_)) {
+      // A minimized window draws nothing until it is restored
+      timeout_ms = INFINITE;
+    } else if (g_SwapChainOccluded &&
+               g_pSwapChain->Present(0, DXGI_PRESENT_TEST) ==
+                   DXGI_STATUS_OCCLUDED) {
+      // The end of an occlusion, e.g. of a locked screen, does not always
+      // post a message, so the swap chain is tested again now and then
+      timeout_ms = kOccludedPollMs;
+    } else if (timeout != Clock::duration::zero()) {
+      timeout_ms = INFINITE;
+      if (timeout != Clock::duration::max())
+        timeout_ms = static_cast<DWORD>(
+            std::chrono::ceil<std::chrono::milliseconds>(timeout).count());
+    }
+    if (timeout_ms != 0)
+      ::MsgWaitForMultipleObjectsEx(0, nullptr, timeout_ms, QS_ALLINPUT,
+                                    MWMO_INPUTAVAILABLE);
 
-  // Main loop
-  bool done = false;
-  while (!done) {
     // Poll and handle messages (inputs, window resize, etc.)
-    // See the WndProc() function below for our to dispatch events to the Win32
-    // backend.
+    // See the WndProc() function below for our to dispatch events to the
+    // Win32 backend.
+    VCD_PROFILE_SCOPE("MessagePump");
+    bool done = false;
     MSG msg;
     while (::PeekMessage(&msg, nullptr, 0U, 0U, PM_REMOVE)) {
       ::TranslateMessage(&msg);
       ::DispatchMessage(&msg);
       if (msg.message == WM_QUIT) done = true;
+      scheduler.NotifyEvent();
     }
-    if (done) break;
+    return !done;
+  }
 
-    // Handle window screen locked
+  void Wake() override {
+    if (hwnd_) ::PostMessage(hwnd_, WM_NULL, 0, 0);
+  }
+
+  bool BeginFrame() override {
+    // Handle window screen locked, ProcessEvents() waits while it is
     if (g_SwapChainOccluded &&
-        g_pSwapChain->Present(0, DXGI_PRESENT_TEST) == DXGI_STATUS_OCCLUDED) {
-      ::Sleep(10);
-      continue;
-    }
+        g_pSwapChain->Present(0, DXGI_PRESENT_TEST) == DXGI_STATUS_OCCLUDED)
+      return false;
     g_SwapChainOccluded = false;
 
     // Start the Dear ImGui frame
     ImGui_ImplDX12_NewFrame();
     ImGui_ImplWin32_NewFrame();
     ImGui::NewFrame();
+    return true;
+  }
 
-    // We need a dockspace for our app layout
-    ImGui::DockSpaceOverViewport(0, ImGui::GetMainViewport());
-
-    ImGui::ShowDemoWindow();
+  void EndFrame() override {
+    FrameContext* frameCtx = WaitForNextFrameResources();
 
-    // Render the application
-    if (!app.Render()) {
-      done = true;
+    {
+      VCD_PROFILE_SCOPE("RecordCommandList");
+      UINT backBufferIdx = g_pSwapChain->GetCurrentBackBufferIndex();
+      frameCtx->CommandAllocator->Reset();
+
+      D3D12_RESOURCE_BARRIER barrier = {};
+      barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
+      barrier.Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
+      barrier.Transition.pResource = g_mainRenderTargetResource[backBufferIdx];
+      barrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+      barrier.Transition.StateBefore = D3D12_RESOURCE_STATE_PRESENT;
+      barrier.Transition.StateAfter = D3D12_RESOURCE_STATE_RENDER_TARGET;
+      g_pd3dCommandList->Reset(frameCtx->CommandAllocator, nullptr);
+      g_pd3dCommandList->ResourceBarrier(1, &barrier);
+
+      // Render Dear ImGui graphics
+      const float clear_color_with_alpha[4] = {
+          clear_color_.x * clear_color_.w, clear_color_.y * clear_color_.w,
+          clear_color_.z * clear_color_.w, clear_color_.w};
+      g_pd3dCommandList->ClearRenderTargetView(
+          g_mainRenderTargetDescriptor[backBufferIdx], clear_color_with_alpha,
+          0, nullptr);
+      g_pd3dCommandList->OMSetRenderTargets(
+          1, &g_mainRenderTargetDescriptor[backBufferIdx], FALSE, nullptr);
+      g_pd3dCommandList->SetDescriptorHeaps(1, &g_pd3dSrvDescHeap);
+      ImGui_ImplDX12_RenderDrawData(ImGui::GetDrawData(), g_pd3dCommandList);
+      barrier.Transition.StateBefore = D3D12_RESOURCE_STATE_RENDER_TARGET;
+      barrier.Transition.StateAfter = D3D12_RESOURCE_STATE_PRESENT;
+      g_pd3dCommandList->ResourceBarrier(1, &barrier);
+      g_pd3dCommandList->Close();
+
+      g_pd3dCommandQueue->ExecuteCommandLists(
+          1, (ID3D12CommandList* const*)&g_pd3dCommandList);
     }
 
-    // Rendering
-    ImGui::Render();
-
-    FrameContext* frameCtx = WaitForNextFrameResources();
-    UINT backBufferIdx = g_pSwapChain->GetCurrentBackBufferIndex();
-    frameCtx->CommandAllocator->Reset();
-
-    D3D12_RESOURCE_BARRIER barrier = {};
-    barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
-    barrier.Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
-    barrier.Transition.pResource = g_mainRenderTargetResource[backBufferIdx];
-    barrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
-    barrier.Transition.StateBefore = D3D12_RESOURCE_STATE_PRESENT;
-    barrier.Transition.StateAfter = D3D12_RESOURCE_STATE_RENDER_TARGET;
-    g_pd3dCommandList->Reset(frameCtx->CommandAllocator, nullptr);
-    g_pd3dCommandList->ResourceBarrier(1, &barrier);
-
-    // Render Dear ImGui graphics
-    const float clear_color_with_alpha[4] = {
-        clear_color.x * clear_color.w, clear_color.y * clear_color.w,
-        clear_color.z * clear_color.w, clear_color.w};
-    g_pd3dCommandList->ClearRenderTargetView(
-        g_mainRenderTargetDescriptor[backBufferIdx], clear_color_with_alpha, 0,
-        nullptr);
-    g_pd3dCommandList->OMSetRenderTargets(
-        1, &g_mainRenderTargetDescriptor[backBufferIdx], FALSE, nullptr);
-    g_pd3dCommandList->SetDescriptorHeaps(1, &g_pd3dSrvDescHeap);
-    ImGui_ImplDX12_RenderDrawData(ImGui::GetDrawData(), g_pd3dCommandList);
-    barrier.Transition.StateBefore = D3D12_RESOURCE_STATE_RENDER_TARGET;
-    barrier.Transition.StateAfter = D3D12_RESOURCE_STATE_PRESENT;
-    g_pd3dCommandList->ResourceBarrier(1, &barrier);
-    g_pd3dCommandList->Close();
-
-    g_pd3dCommandQueue->ExecuteCommandLists(
-        1, (ID3D12CommandList* const*)&g_pd3dCommandList);
-
     // Update and Render additional Platform Windows
-    if (io.ConfigFlags & ImGuiConfigFlags_ViewportsEnable) {
+    if (ImGui::GetIO().ConfigFlags & ImGuiConfigFlags_ViewportsEnable) {
       ImGui::UpdatePlatformWindows();
       ImGui::RenderPlatformWindowsDefault(nullptr, (void*)g_pd3dCommandList);
     }
 
-    // Present
-    HRESULT hr = g_pSwapChain->Present(1, 0);  // Present with vsync
-    // HRESULT hr = g_pSwapChain->Present(0, 0); // Present without vsync
+    // Present with or without vsync
+    VCD_PROFILE_SCOPE("Present");
+    HRESULT hr = g_pSwapChain->Present(vsync_ ? 1 : 0, 0);
     g_SwapChainOccluded = (hr == DXGI_STATUS_OCCLUDED);
 
     UINT64 fenceValue = g_fenceLastSignaledValue + 1;
@@ -212,18 +269,22 @@ int main(int, char**) {
     frameCtx->FenceValue = fenceValue;
   }
 
-  WaitForLastSubmittedFrame();
-
-  // Cleanup
-  ImGui_ImplDX12_Shutdown();
-  ImGui_ImplWin32_Shutdown();
-  ImGui::DestroyContext();
+ private:
+  WNDCLASSEXW wc_ = {};
+  HWND hwnd_ = nullptr;
+  bool class_registered_ = false;
+  bool device_created_ = false;
+  bool imgui_initialized_ = false;
+  bool vsync_ = true;
+  ImVec4 clear_color_;
+};
 
-  CleanupDeviceD3D();
-  ::DestroyWindow(hwnd);
-  ::UnregisterClassW(wc.lpszClassName, wc.hInstance);
+}  // namespace
 
-  return 0;
+// Main code
+int main(int, char**) {
+  Dx12Backend backend;
+  return backend::RunApplication(backend);
 }
 
 // Helper functions
@@ -438,6 +499,7 @@ void WaitForLastSubmittedFrame() {
 }
 
 FrameContext* WaitForNextFrameResources() {
+  VCD_PROFILE_SCOPE("WaitForNextFrameResources");
   UINT nextFrameIndex = g_frameIndex + 1;
   g_frameIndex = nextFrameIndex;
 
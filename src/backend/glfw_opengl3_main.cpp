@@ -0,0 +1,185 @@
+// Visco Correct Desktop - Correction factors for centrifugal pumps
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Visco-Correct-Desktop>
+//
+// GLFW + OpenGL 3 entry point used on Linux and macOS. Based on the ImGui
+// example_glfw_opengl3.
+#include <GLFW/glfw3.h>
+
+#include <chrono>
+#include <cstdio>
+
+#include "imgui.h"
+#include "imgui_impl_glfw.h"
+#include "imgui_impl_opengl3.h"
+#include "imgui_internal.h"
+#include "spauly/visco/backend/backend.h"
+#include "spauly/visco/utils/profiler.h"
+
+namespace {
+
+using namespace spauly::visco;
+
+void GlfwErrorCallback(int error, const char *description) {
+  std::fprintf(stderr, "GLFW Error %d: %s\n", error, description);
+}
+
+class GlfwOpenGl3Backend : public backend::Backend {
+ public:
+  GlfwOpenGl3Backend() = default;
+  ~GlfwOpenGl3Backend() override { Shutdown(); }
+
+  bool Init(const backend::BackendConfig &config) override {
+    glfwSetErrorCallback(GlfwErrorCallback);
+    if (!glfwInit()) return false;
+    glfw_initialized_ = true;
+    clear_color_ = config.clear_color;
+
+    // GL 3.2 + GLSL 150 is the lowest version macOS provides a core profile
+#if defined(__APPLE__)
+    const char *glsl_version = "#version 150";
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 2);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+#else
+    const char *glsl_version = "#version 130";
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 0);
+#endif
+
+    window_ = glfwCreateWindow(config.width, config.height, config.title,
+                               nullptr, nullptr);
+    if (!window_) return false;
+    glfwMakeContextCurrent(window_);
+    glfwSwapInterval(config.vsync ? 1 : 0);
+
+    // Setup Dear ImGui context
+    IMGUI_CHECKVERSION();
+    VCD_PROFILE_IMGUI_ALLOCATIONS();
+    ImGui::CreateContext();
+    ImGuiIO &io = ImGui::GetIO();
+    io.ConfigFlags |= ImGuiConfigFlags_NavEnableKeyboard;
+    io.ConfigFlags |= ImGuiConfigFlags_NavEnableGamepad;
+    io.ConfigFlags |= ImGuiConfigFlags_DockingEnable;
+    io.ConfigFlags |= ImGuiConfigFlags_ViewportsEnable;
+    imgui_initialized_ = true;
+
+    return ImGui_ImplGlfw_InitForOpenGL(window_, true) &&
+           ImGui_ImplOpenGL3_Init(glsl_version);
+  }
+
+  void Shutdown() override {
+    if (imgui_initialized_) {
+      ImGui_ImplOpenGL3_Shutdown();
+      ImGui_ImplGlfw_Shutdown();
+      ImGui::DestroyContext();
+      imgui_initialized_ = false;
+    }
+    if (window_) {
+      glfwDestroyWindow(window_);
+      window_ = nullptr;
+    }
+    if (glfw_initialized_) {
+      glfwTerminate();
+      glfw_initialized_ = false;
+    }
+  }
+
+  bool ProcessEvents(utils::FrameScheduler &scheduler) override {
+    using Clock = utils::FrameScheduler::Clock;
+
+    // A minimized window draws nothing, whatever the scheduler wants. Sleep
+    // until it is restored or a job wakes the loop, then redraw
+    if (glfwGetWindowAttrib(window_, GLFW_ICONIFIED) != 0) {
+      glfwWaitEvents();
+      scheduler.NotifyEvent();
+      return !glfwWindowShouldClose(window_);
+    }
+
+    // Block until an event arrives or the scheduler wants the next frame
+    const Clock::time_point start = Clock::now();
+    const Clock::duration timeout = scheduler.WaitTimeout(start);
+    bool woken = false;
+    if (timeout == Clock::duration::zero()) {
+      VCD_PROFILE_SCOPE("PollEvents");
+      glfwPollEvents();
+    } else if (timeout == Clock::duration::max()) {
+      glfwWaitEvents();
+      woken = true;
+    } else {
+      glfwWaitEventsTimeout(std::chrono::duration<double>(timeout).count());
+      woken = Clock::now() - start < timeout;
+    }
+
+    // The platform backend queues the input of all viewports in the context,
+    // window events like resizing only show up as early wake up
+    if (woken || !GImGui->InputEventsQueue.empty()) scheduler.NotifyEvent();
+
+    return !glfwWindowShouldClose(window_);
+  }
+
+  void Wake() override { glfwPostEmptyEvent(); }
+
+  bool BeginFrame() override {
+    // ProcessEvents() blocks while the window is minimized
+    if (glfwGetWindowAttrib(window_, GLFW_ICONIFIED) != 0) return false;
+
+    ImGui_ImplOpenGL3_NewFrame();
+    ImGui_ImplGlfw_NewFrame();
+    ImGui::NewFrame();
+    return true;
+  }
+
+  void EndFrame() override {
+    {
+      VCD_PROFILE_SCOPE("RenderDrawData");
+      int display_w = 0, display_h = 0;
+      glfwGetFramebufferSize(window_, &display_w, &display_h);
+      glViewport(0, 0, display_w, display_h);
+      glClearColor(clear_color_.x * clear_color_.w,
+                   clear_color_.y * clear_color_.w,
+                   clear_color_.z * clear_color_.w, clear_color_.w);
+      glClear(GL_COLOR_BUFFER_BIT);
+      ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+    }
+
+    // Update and Render additional Platform Windows
+    if (ImGui::GetIO().ConfigFlags & ImGuiConfigFlags_ViewportsEnable) {
+      GLFWwindow *backup_context = glfwGetCurrentContext();
+      ImGui::UpdatePlatformWindows();
+      ImGui::RenderPlatformWindowsDefault();
+      glfwMakeContextCurrent(backup_context);
+    }
+
+    VCD_PROFILE_SCOPE("SwapBuffers");
+    glfwSwapBuffers(window_);
+  }
+
+ private:
+  GLFWwindow *window_ = nullptr;
+  bool glfw_initialized_ = false;
+  bool imgui_initialized_ = false;
+  ImVec4 clear_color_;
+};
+
+}  // namespace
+
+int main(int, char **) {
+  GlfwOpenGl3Backend backend;
+  return backend::RunApplication(backend);
+}
@@ -0,0 +1,135 @@
+// Visco Correct Desktop - Correction factors for centrifugal pumps
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Visco-Correct-Desktop>
+#include "spauly/visco/backend/headless_backend.h"
+
+#include <cmath>
+
+#include "spauly/visco/utils/profiler.h"
+
+namespace spauly {
+namespace visco {
+namespace backend {
+
+namespace {
+
+// FNV-1a, stable across platforms and runs
+constexpr std::uint64_t kHashBasis = 14695981039346656037ull;
+constexpr std::uint64_t kHashPrime = 1099511628211ull;
+
+void Hash(std::uint64_t &hash, std::uint64_t value) {
+  for (int i = 0; i < 8; i++) {
+    hash ^= (value >> (i * 8)) & 0xff;
+    hash *= kHashPrime;
+  }
+}
+
+// Rounds to 1/scale, by default 1/16 pixel as finer differences are not
+// visible
+void HashFloat(std::uint64_t &hash, float value, float scale = 16.0f) {
+  Hash(hash, static_cast<std::uint64_t>(std::lround(value * scale)));
+}
+
+std::uint64_t HashDrawData(const ImDrawData &draw_data) {
+  std::uint64_t hash = kHashBasis;
+  for (int l = 0; l < draw_data.CmdListsCount; l++) {
+    const ImDrawList &list = *draw_data.CmdLists[l];
+    for (const ImDrawVert &vertex : list.VtxBuffer) {
+      HashFloat(hash, vertex.pos.x);
+      HashFloat(hash, vertex.pos.y);
+      // UVs address single texels of the font atlas
+      HashFloat(hash, vertex.uv.x, 65536.0f);
+      HashFloat(hash, vertex.uv.y, 65536.0f);
+      Hash(hash, vertex.col);
+    }
+    for (const ImDrawIdx index : list.IdxBuffer) Hash(hash, index);
+    for (const ImDrawCmd &cmd : list.CmdBuffer) {
+      HashFloat(hash, cmd.ClipRect.x);
+      HashFloat(hash, cmd.ClipRect.y);
+      HashFloat(hash, cmd.ClipRect.z);
+      HashFloat(hash, cmd.ClipRect.w);
+      Hash(hash, cmd.ElemCount);
+      Hash(hash, cmd.IdxOffset);
+      Hash(hash, cmd.VtxOffset);
+    }
+  }
+  return hash;
+}
+
+}  // namespace
+
+bool HeadlessBackend::Init(const BackendConfig &config) {
+  Shutdown();
+
+  IMGUI_CHECKVERSION();
+  VCD_PROFILE_IMGUI_ALLOCATIONS();
+  ImGui::CreateContext();
+  ImGuiIO &io = ImGui::GetIO();
+  io.IniFilename = nullptr;  // Runs must not depend on a previous layout
+  io.BackendPlatformName = "visco_headless";
+  io.BackendRendererName = "visco_null";
+  io.DisplaySize = ImVec2(static_cast<float>(config.width),
+                          static_cast<float>(config.height));
+  io.DeltaTime = delta_time_;
+
+  // The atlas has to be built before the first frame, a renderer backend
+  // would upload it here
+  unsigned char *pixels = nullptr;
+  int width = 0, height = 0;
+  io.Fonts->GetTexDataAsRGBA32(&pixels, &width, &height);
+
+  frame_count_ = 0;
+  stats_ = {};
+  initialized_ = true;
+  return true;
+}
+
+void HeadlessBackend::Shutdown() {
+  if (!initialized_) return;
+  ImGui::DestroyContext();
+  initialized_ = false;
+}
+
+bool HeadlessBackend::ProcessEvents(utils::FrameScheduler &scheduler) {
+  if (frame_limit_ != 0 && frame_count_ >= frame_limit_) return false;
+  scheduler.NotifyEvent();
+  return true;
+}
+
+bool HeadlessBackend::BeginFrame() {
+  ImGui::GetIO().DeltaTime = delta_time_;
+  ImGui::NewFrame();
+  return true;
+}
+
+void HeadlessBackend::EndFrame() {
+  frame_count_++;
+
+  const ImDrawData *draw_data = ImGui::GetDrawData();
+  stats_ = {};
+  if (!draw_data) return;
+  stats_.draw_lists = draw_data->CmdListsCount;
+  stats_.vertices = draw_data->TotalVtxCount;
+  stats_.indices = draw_data->TotalIdxCount;
+  if (hash_draw_data_) stats_.hash = HashDrawData(*draw_data);
+}
+
+}  // namespace backend
+
+}  // namespace visco
+
+}  // namespace spauly
@@ -0,0 +1,264 @@
+// Visco Correct Desktop - Correction factors for centrifugal pumps
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Visco-Correct-Desktop>
+//
+// Runs the application on the headless backend and reports the CPU time per
+// frame. Used to profile Application::Render() on machines without a GPU and
+// to replay scenarios against golden files on CI.
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "spauly/visco/application.h"
+#include "spauly/visco/backend/headless_backend.h"
+#include "spauly/visco/backend/scenario.h"
+#ifdef VCD_PROFILING
+#include "spauly/visco/utils/allocation_counter.h"
+#endif
+
+namespace {
+
+using namespace spauly;
+
+bool ParseCount(std::string_view value, std::size_t &count) {
+  auto [ptr, ec] =
+      std::from_chars(value.data(), value.data() + value.size(), count);
+  return ec == std::errc() && ptr == value.data() + value.size() && count > 0;
+}
+
+bool ParseTime(std::string_view value, double &time) {
+  auto [ptr, ec] =
+      std::from_chars(value.data(), value.data() + value.size(), time);
+  return ec == std::errc() && ptr == value.data() + value.size() && time > 0;
+}
+
+bool ReadFile(const char *path, std::string &text) {
+  std::FILE *file = std::fopen(path, "rb");
+  if (!file) return false;
+  char buffer[4096];
+  std::size_t read = 0;
+  text.clear();
+  while ((read = std::fread(buffer, 1, sizeof(buffer), file)) > 0)
+    text.append(buffer, read);
+  const bool ok = !std::ferror(file);
+  std::fclose(file);
+  return ok;
+}
+
+bool WriteFile(const char *path, std::string_view text) {
+  std::FILE *file = std::fopen(path, "wb");
+  if (!file) return false;
+  bool ok = std::fwrite(text.data(), 1, text.size(), file) == text.size();
+  ok = std::fclose(file) == 0 && ok;
+  return ok;
+}
+
+void PrintUsage() {
+  std::fputs(
+      "Usage: Visco-Correct-Headless [options]\n"
+      "\n"
+      "Renders frames of the application without window or GPU and prints\n"
+      "the CPU time per frame.\n"
+      "\n"
+      "Options:\n"
+      "  -n <frames>          Number of measured frames (default: 1000)\n"
+      "  --warmup <n>         Frames rendered before measuring (default: 10)\n"
+      "  --scenario <file>    Replays a script instead of -n and --warmup,\n"
+      "                       see backend/scenario.h for the commands\n"
+      "  --golden <file>      Compares the draw data and results of the\n"
+      "                       scenario with file, fails if it does not exist\n"
+      "  --record             Writes the golden file instead\n"
+      "  --max-frame-us <t>   Fails if the p95 frame time exceeds t\n"
+      "  -h, --help           Show this help\n",
+      stdout);
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  std::size_t frames = 1000;
+  std::size_t warmup = 10;
+  const char *scenario_path = nullptr;
+  const char *golden_path = nullptr;
+  bool record = false;
+  double max_frame_us = 0.0;
+
+  for (int i = 1; i < argc; i++) {
+    std::string_view arg = argv[i];
+    bool has_value = i + 1 < argc;
+    bool valid = true;
+
+    if (arg == "-h" || arg == "--help") {
+      PrintUsage();
+      return 0;
+    } else if (arg == "-n" && has_value) {
+      valid = ParseCount(argv[++i], frames);
+    } else if (arg == "--warmup" && has_value) {
+      valid = ParseCount(argv[++i], warmup);
+    } else if (arg == "--scenario" && has_value) {
+      scenario_path = argv[++i];
+    } else if (arg == "--golden" && has_value) {
+      golden_path = argv[++i];
+    } else if (arg == "--record") {
+      record = true;
+    } else if (arg == "--max-frame-us" && has_value) {
+      valid = ParseTime(argv[++i], max_frame_us);
+    } else {
+      valid = false;
+    }
+
+    if (!valid) {
+      std::fprintf(stderr, "Invalid argument: %s\n", argv[i]);
+      PrintUsage();
+      return 2;
+    }
+  }
+
+  if ((golden_path && !scenario_path) || (record && !golden_path)) {
+    std::fputs("--golden needs --scenario, --record needs --golden\n",
+               stderr);
+    PrintUsage();
+    return 2;
+  }
+
+  visco::backend::HeadlessBackend backend;
+  if (!backend.Init({})) return 1;
+
+  std::vector<double> times;
+  times.reserve(frames);
+  std::string snapshot;
+  std::size_t arena_peak = 0;
+#ifdef VCD_PROFILING
+  // Heap allocations of the UI thread over the measured frames
+  std::uint64_t allocations = 0;
+  std::uint64_t max_allocations = 0;
+#endif
+  {
+    visco::Application app;
+    if (!app.Init()) return 1;
+    // Profiling runs must not leave files behind
+    app.set_autosave(false);
+
+    if (scenario_path) {
+      std::string script;
+      if (!ReadFile(scenario_path, script)) {
+        std::fprintf(stderr, "Could not read %s\n", scenario_path);
+        return 1;
+      }
+      visco::backend::ScenarioRunner runner(backend, app);
+      if (!runner.Run(script)) {
+        std::fprintf(stderr, "%s: %s\n", scenario_path,
+                     runner.error().c_str());
+        return 1;
+      }
+      times = runner.frame_times();
+      snapshot = runner.snapshot();
+      // The measured loop below is skipped
+      warmup = frames = 0;
+    }
+
+    for (std::size_t i = 0; i < warmup + frames; i++) {
+#ifdef VCD_PROFILING
+      const std::uint64_t allocations_before =
+          visco::utils::ThreadAllocationCount();
+#endif
+      auto start = std::chrono::steady_clock::now();
+
+      backend.ProcessEvents(app.scheduler());
+      backend.BeginFrame();
+      app.Render();
+      ImGui::Render();
+      app.EndFrame();
+      backend.EndFrame();
+
+      std::chrono::duration<double, std::micro> time =
+          std::chrono::steady_clock::now() - start;
+      if (i >= warmup) times.push_back(time.count());
+#ifdef VCD_PROFILING
+      const std::uint64_t frame_allocations =
+          visco::utils::ThreadAllocationCount() - allocations_before;
+      if (i >= warmup) {
+        allocations += frame_allocations;
+        max_allocations = std::max(max_allocations, frame_allocations);
+      }
+#endif
+    }
+    arena_peak = app.frame_arena().peak();
+  }
+
+  std::sort(times.begin(), times.end());
+  double total = 0.0;
+  for (double time : times) total += time;
+  auto percentile = [&](double p) {
+    return times.empty()
+               ? 0.0
+               : times[static_cast<std::size_t>(p * (times.size() - 1))];
+  };
+
+  const visco::backend::FrameStats &stats = backend.stats();
+  std::printf(
+      "frames: %zu\n"
+      "frame time [us]: mean %.2f, p50 %.2f, p95 %.2f, p99 %.2f, max %.2f\n"
+      "draw data: %d lists, %d vertices, %d indices\n",
+      times.size(), times.empty() ? 0.0 : total / times.size(),
+      percentile(0.5), percentile(0.95), percentile(0.99), percentile(1.0),
+      stats.draw_lists, stats.vertices, stats.indices);
+  std::printf("frame arena peak: %zu bytes\n", arena_peak);
+#ifdef VCD_PROFILING
+  if (!scenario_path)
+    std::printf("heap allocations per frame: mean %.2f, max %llu\n",
+                static_cast<double>(allocations) / times.size(),
+                static_cast<unsigned long long>(max_allocations));
+#endif
+
+  int status = 0;
+  if (max_frame_us > 0.0 && percentile(0.95) > max_frame_us) {
+    std::fprintf(stderr, "frame time p95 %.2f us exceeds %.2f us\n",
+                 percentile(0.95), max_frame_us);
+    status = 1;
+  }
+
+  if (!golden_path) return status;
+  if (record) {
+    if (!WriteFile(golden_path, snapshot)) {
+      std::fprintf(stderr, "Could not write %s\n", golden_path);
+      return 1;
+    }
+    std::printf("golden: recorded %s\n", golden_path);
+    return status;
+  }
+
+  std::string golden;
+  if (!ReadFile(golden_path, golden)) {
+    std::fprintf(stderr, "No golden file %s, create it with --record\n",
+                 golden_path);
+    return 1;
+  }
+  std::string message;
+  if (!visco::backend::CompareSnapshot(golden, snapshot, message)) {
+    std::fprintf(stderr, "golden: %s differs, %s\n", golden_path,
+                 message.c_str());
+    return 1;
+  }
+  std::printf("golden: %s matches\n", golden_path);
+  return status;
+}
@@ -0,0 +1,89 @@
+// Visco Correct Desktop - Correction factors for centrifugal pumps
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Visco-Correct-Desktop>
+#include "spauly/visco/backend/backend.h"
+
+#include "spauly/visco/utils/profiler.h"
+
+namespace spauly {
+namespace visco {
+namespace backend {
+
+void RunMainLoop(Backend &backend, Application &app) {
+  utils::FrameScheduler &scheduler = app.scheduler();
+
+  while (backend.ProcessEvents(scheduler)) {
+    if (!scheduler.ShouldRender(utils::FrameScheduler::Clock::now())) continue;
+
+    bool keep_running = true;
+    {
+      VCD_PROFILE_SCOPE("Frame");
+      {
+        VCD_PROFILE_SCOPE("NewFrame");
+        if (!backend.BeginFrame()) continue;
+      }
+
+#ifndef NDEBUG
+      ImGui::ShowDemoWindow();
+#endif
+
+      {
+        VCD_PROFILE_SCOPE("Application::Render");
+        keep_running = app.Render();
+      }
+      {
+        VCD_PROFILE_SCOPE("ImGui::Render");
+        ImGui::Render();
+      }
+      app.EndFrame();
+      {
+        VCD_PROFILE_SCOPE("EndFrame");
+        backend.EndFrame();
+      }
+    }
+    VCD_PROFILE_FRAME();
+
+    if (!keep_running) break;
+  }
+}
+
+int RunApplication(Backend &backend, const BackendConfig &config) {
+  if (!backend.Init(config)) {
+    backend.Shutdown();
+    return 1;
+  }
+
+  int exit_code = 0;
+  {
+    Application app;
+    // Finished jobs wake the loop, so their results show without input
+    app.jobs().set_wake([&backend] { backend.Wake(); });
+    if (app.Init())
+      RunMainLoop(backend, app);
+    else
+      exit_code = 1;
+  }
+
+  backend.Shutdown();
+  return exit_code;
+}
+
+}  // namespace backend
+
+}  // namespace visco
+
+}  // namespace spauly
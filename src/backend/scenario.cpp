@@ -0,0 +1,313 @@
+// Visco Correct Desktop - Correction factors for centrifugal pumps
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Visco-Correct-Desktop>
+#include "spauly/visco/backend/scenario.h"
+
+#include <imgui.h>
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <chrono>
+#include <cinttypes>
+#include <cmath>
+#include <cstdio>
+#include <iterator>
+#include <thread>
+
+#include "spauly/visco/batch/unit_conversion.h"
+
+namespace spauly {
+namespace visco {
+namespace backend {
+
+namespace {
+
+// Long enough for any sweep, short enough to fail a hanging CI run early
+constexpr auto kJobTimeout = std::chrono::seconds(10);
+
+constexpr double kTolerance = 1e-9;
+
+struct NamedKey {
+  std::string_view name;
+  ImGuiKey key;
+};
+
+constexpr NamedKey kKeys[] = {
+    {"Enter", ImGuiKey_Enter},         {"Tab", ImGuiKey_Tab},
+    {"Backspace", ImGuiKey_Backspace}, {"Delete", ImGuiKey_Delete},
+    {"Escape", ImGuiKey_Escape},
+};
+
+bool IsSpace(char c) { return c == ' ' || c == '\t'; }
+
+std::string_view TrimLeft(std::string_view text) {
+  while (!text.empty() && IsSpace(text.front())) text.remove_prefix(1);
+  return text;
+}
+
+/// @brief Removes and returns the next whitespace separated token of text.
+std::string_view NextToken(std::string_view &text) {
+  text = TrimLeft(text);
+  std::size_t end = 0;
+  while (end < text.size() && !IsSpace(text[end])) end++;
+  std::string_view token = text.substr(0, end);
+  text.remove_prefix(end);
+  return token;
+}
+
+template <typename T>
+bool ParseNumber(std::string_view token, T &value) {
+  auto [ptr, ec] =
+      std::from_chars(token.data(), token.data() + token.size(), value);
+  return !token.empty() && ec == std::errc() &&
+         ptr == token.data() + token.size();
+}
+
+bool ParseKey(std::string_view name, ImGuiKey &key) {
+  for (const NamedKey &named : kKeys) {
+    if (named.name == name) {
+      key = named.key;
+      return true;
+    }
+  }
+  if (name.size() == 1 && std::isalpha(static_cast<unsigned char>(name[0]))) {
+    const char letter =
+        static_cast<char>(std::toupper(static_cast<unsigned char>(name[0])));
+    key = static_cast<ImGuiKey>(ImGuiKey_A + (letter - 'A'));
+    return true;
+  }
+  return false;
+}
+
+bool ParseUnits(std::string_view &line, vccore::Units &units) {
+  unsigned int index[4] = {};
+  const std::size_t sizes[4] = {
+      std::size(batch::kFlowrateScale), std::size(batch::kTotalHeadScale),
+      std::size(batch::kViscosityScale), std::size(batch::kDensityScale)};
+  for (int i = 0; i < 4; i++)
+    if (!ParseNumber(NextToken(line), index[i]) || index[i] >= sizes[i])
+      return false;
+  units.flowrate = static_cast<vccore::FlowrateUnit>(index[0]);
+  units.total_head = static_cast<vccore::TotalHeadUnit>(index[1]);
+  units.viscosity = static_cast<vccore::ViscosityUnit>(index[2]);
+  units.density = static_cast<vccore::DensityUnit>(index[3]);
+  return true;
+}
+
+/// @brief Calls f with every line of text, without the line break.
+template <typename F>
+void ForEachLine(std::string_view text, F &&f) {
+  while (!text.empty()) {
+    std::size_t end = text.find('\n');
+    if (end == std::string_view::npos) end = text.size();
+    std::string_view line = text.substr(0, end);
+    if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+    f(line);
+    text.remove_prefix(std::min(end + 1, text.size()));
+  }
+}
+
+bool SameToken(std::string_view expected, std::string_view actual) {
+  double a = 0.0, b = 0.0;
+  if (ParseNumber(expected, a) && ParseNumber(actual, b))
+    return a == b || std::abs(a - b) <=
+                         kTolerance * std::max({1.0, std::abs(a), std::abs(b)});
+  return expected == actual;
+}
+
+bool SameLine(std::string_view expected, std::string_view actual) {
+  while (true) {
+    std::string_view a = NextToken(expected);
+    std::string_view b = NextToken(actual);
+    if (a.empty() || b.empty()) return a.empty() && b.empty();
+    if (!SameToken(a, b)) return false;
+  }
+}
+
+}  // namespace
+
+ScenarioRunner::ScenarioRunner(HeadlessBackend &backend, Application &app)
+    : backend_(backend), app_(app) {
+  backend_.set_hash_draw_data(true);
+}
+
+bool ScenarioRunner::Run(std::string_view script) {
+  snapshot_.clear();
+  frame_times_.clear();
+  error_.clear();
+  checks_ = 0;
+
+  std::size_t number = 0;
+  bool ok = true;
+  ForEachLine(script, [&](std::string_view line) {
+    number++;
+    if (!ok) return;
+    line = line.substr(0, line.find('#'));
+    if (!Execute(line)) {
+      error_ = "line " + std::to_string(number) + ": " + error_;
+      ok = false;
+    }
+  });
+  if (ok) RecordResults();
+  return ok;
+}
+
+bool ScenarioRunner::Execute(std::string_view line) {
+  const std::string_view command = NextToken(line);
+  if (command.empty()) return true;
+
+  ImGuiIO &io = ImGui::GetIO();
+  bool valid = true;
+  if (command == "frames") {
+    std::size_t count = 0;
+    valid = ParseNumber(NextToken(line), count);
+    if (valid) RenderFrames(count);
+  } else if (command == "mouse" || command == "click") {
+    float x = 0.0f, y = 0.0f;
+    valid = ParseNumber(NextToken(line), x) && ParseNumber(NextToken(line), y);
+    if (valid) {
+      io.AddMousePosEvent(x, y);
+      if (command == "click") {
+        io.AddMouseButtonEvent(ImGuiMouseButton_Left, true);
+        io.AddMouseButtonEvent(ImGuiMouseButton_Left, false);
+      }
+    }
+  } else if (command == "text") {
+    const std::string text(TrimLeft(line));
+    io.AddInputCharactersUTF8(text.c_str());
+    line = {};
+  } else if (command == "key") {
+    std::string_view name = NextToken(line);
+    const bool ctrl = name.substr(0, 5) == "ctrl+";
+    if (ctrl) name.remove_prefix(5);
+    ImGuiKey key = ImGuiKey_None;
+    valid = ParseKey(name, key);
+    if (valid) {
+      if (ctrl) io.AddKeyEvent(ImGuiMod_Ctrl, true);
+      io.AddKeyEvent(key, true);
+      io.AddKeyEvent(key, false);
+      if (ctrl) io.AddKeyEvent(ImGuiMod_Ctrl, false);
+    }
+  } else if (command == "inputs") {
+    CalculatorView &view = app_.calculator_view();
+    vccore::Parameters params;
+    vccore::Units units = view.units();
+    valid = ParseNumber(NextToken(line), params.flowrate) &&
+            ParseNumber(NextToken(line), params.total_head) &&
+            ParseNumber(NextToken(line), params.viscosity) &&
+            ParseNumber(NextToken(line), params.density);
+    if (valid && !TrimLeft(line).empty()) valid = ParseUnits(line, units);
+    if (valid) view.SetInputs(params, units);
+  } else if (command == "calculate") {
+    app_.calculator_view().Calculate();
+  } else if (command == "project") {
+    app_.calculator_view().AddProject();
+  } else if (command == "wait") {
+    if (!WaitForJobs()) {
+      error_ = "jobs did not finish in time";
+      return false;
+    }
+  } else if (command == "check") {
+    RecordDrawData();
+  } else {
+    error_ = "unknown command '" + std::string(command) + "'";
+    return false;
+  }
+
+  if (!valid || !TrimLeft(line).empty()) {
+    error_ = "invalid arguments for '" + std::string(command) + "'";
+    return false;
+  }
+  return true;
+}
+
+void ScenarioRunner::RenderFrames(std::size_t count) {
+  for (std::size_t i = 0; i < count; i++) {
+    auto start = std::chrono::steady_clock::now();
+
+    backend_.ProcessEvents(app_.scheduler());
+    backend_.BeginFrame();
+    app_.Render();
+    ImGui::Render();
+    app_.EndFrame();
+    backend_.EndFrame();
+
+    std::chrono::duration<double, std::micro> time =
+        std::chrono::steady_clock::now() - start;
+    frame_times_.push_back(time.count());
+  }
+}
+
+bool ScenarioRunner::WaitForJobs() {
+  const auto deadline = std::chrono::steady_clock::now() + kJobTimeout;
+  utils::JobSystem &jobs = app_.jobs();
+  while (jobs.pending() != 0) {
+    if (jobs.Poll() != 0) continue;
+    if (std::chrono::steady_clock::now() > deadline) return false;
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  return true;
+}
+
+void ScenarioRunner::RecordDrawData() {
+  const FrameStats &stats = backend_.stats();
+  char line[160];
+  std::snprintf(line, sizeof(line),
+                "draw %zu frame %" PRIu64
+                " lists %d vertices %d indices %d hash 0x%016" PRIx64 "\n",
+                checks_++, backend_.frame_count(), stats.draw_lists,
+                stats.vertices, stats.indices, stats.hash);
+  snapshot_ += line;
+}
+
+void ScenarioRunner::RecordResults() {
+  char line[256];
+  for (const Project &project : app_.calculator_view().projects()) {
+    const vccore::CorrectionFactors &result = project.result;
+    std::snprintf(line, sizeof(line),
+                  "project %u q %.17g eta %.17g h %.17g %.17g %.17g %.17g "
+                  "error %d\n",
+                  project.id, result.q, result.eta, result.h[0], result.h[1],
+                  result.h[2], result.h[3], result.error_flag);
+    snapshot_ += line;
+  }
+}
+
+bool CompareSnapshot(std::string_view golden, std::string_view snapshot,
+                     std::string &message) {
+  std::vector<std::string_view> expected, actual;
+  ForEachLine(golden, [&](std::string_view line) { expected.push_back(line); });
+  ForEachLine(snapshot, [&](std::string_view line) { actual.push_back(line); });
+
+  for (std::size_t i = 0; i < std::max(expected.size(), actual.size()); i++) {
+    const std::string_view a = i < expected.size() ? expected[i] : "<none>";
+    const std::string_view b = i < actual.size() ? actual[i] : "<none>";
+    if (!SameLine(a, b)) {
+      message = "line " + std::to_string(i + 1) + ": expected '" +
+                std::string(a) + "', got '" + std::string(b) + "'";
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace backend
+
+}  // namespace visco
+
+}  // namespace spauly
@@ -0,0 +1,93 @@
+// Visco Correct Desktop - Correction factors for centrifugal pumps
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Visco-Correct-Desktop>
+#include "spauly/visco/batch/batch_engine.h"
+
+#include <atomic>
+
+namespace spauly {
+namespace visco {
+namespace batch {
+
+BatchEngine::BatchEngine(std::size_t thread_count)
+    : pool_(thread_count), calculators_(pool_.size()) {}
+
+void BatchEngine::SetMode(CalculationMode mode, const CorrectionGrid *grid) {
+  mode_ = (grid && !grid->empty()) ? mode : CalculationMode::kExact;
+  for (auto &worker : calculators_) worker.grid.set_grid(grid);
+}
+
+bool BatchEngine::Calculate(std::span<const vccore::Parameters> params,
+                            const vccore::Units &units,
+                            std::span<vccore::CorrectionFactors> out) {
+  if (out.size() < params.size()) return false;
+
+  pool_.ParallelFor(params.size(), chunk_size_,
+                    [&](std::size_t begin, std::size_t end,
+                        std::size_t worker) {
+                      WorkerCalculator &calculators = calculators_[worker];
+                      if (mode_ == CalculationMode::kGrid) {
+                        for (std::size_t i = begin; i < end; i++)
+                          out[i] = calculators.grid.Calculate(params[i], units,
+                                                              mode_);
+                        return;
+                      }
+                      for (std::size_t i = begin; i < end; i++)
+                        out[i] = calculators.calculator.Calculate(params[i],
+                                                                  units);
+                    });
+  return true;
+}
+
+bool BatchEngine::Calculate(std::span<const OperatingPoint> points,
+                            std::span<vccore::CorrectionFactors> out) {
+  if (out.size() < points.size()) return false;
+
+  // Each chunk is grouped by units and runs the specialised kernels
+  pool_.ParallelFor(points.size(), chunk_size_,
+                    [&](std::size_t begin, std::size_t end,
+                        std::size_t worker) {
+                      calculators_[worker].grid.Calculate(
+                          points.subspan(begin, end - begin),
+                          out.subspan(begin, end - begin), mode_);
+                    });
+  return true;
+}
+
+bool BatchEngine::Calculate(const SoaInput &in, const vccore::Units &units,
+                            const SoaOutput &out) {
+  if (in.total_head.size() != in.size() || in.viscosity.size() != in.size() ||
+      out.size() < in.size())
+    return false;
+
+  std::atomic<bool> valid = true;
+  pool_.ParallelFor(in.size(), chunk_size_,
+                    [&](std::size_t begin, std::size_t end,
+                        std::size_t worker) {
+                      if (!calculators_[worker].grid.Calculate(
+                              in.subspan(begin, end - begin), units,
+                              out.subspan(begin, end - begin), mode_))
+                        valid = false;
+                    });
+  return valid;
+}
+
+}  // namespace batch
+
+}  // namespace visco
+
+}  // namespace spauly
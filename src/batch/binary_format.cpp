@@ -0,0 +1,377 @@
+// Visco Correct Desktop - Correction factors for centrifugal pumps
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Visco-Correct-Desktop>
+#include "spauly/visco/batch/binary_format.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+namespace spauly {
+namespace visco {
+namespace batch {
+
+namespace {
+
+constexpr char kMagic[4] = {'V', 'C', 'D', 'B'};
+
+struct FileHeader {
+  char magic[4];
+  std::uint32_t version;
+  std::uint32_t kind;
+  std::uint32_t block_rows;
+  std::uint64_t rows;
+  std::uint64_t blocks;
+};
+
+struct BlockHeader {
+  std::uint32_t rows;
+  std::uint8_t units[4];
+  std::uint64_t size;
+};
+
+static_assert(sizeof(FileHeader) == 32 && sizeof(BlockHeader) == 16,
+              "The on-disk headers must not contain padding");
+
+// Number of enumerators per unit, in the order of the combo boxes
+constexpr std::uint8_t kUnitCounts[4] = {3, 2, 4, 2};
+
+constexpr std::size_t kInputColumns = 4;
+constexpr std::size_t kResultColumns = 6;
+
+constexpr std::size_t Align8(std::size_t size) { return (size + 7) & ~7ull; }
+
+constexpr std::uint64_t ColumnBytes(DatasetKind kind, std::size_t rows) {
+  if (kind == DatasetKind::kInputs) return kInputColumns * rows * 8;
+  return kResultColumns * rows * 8 + Align8(rows * sizeof(std::int32_t));
+}
+
+bool SameUnits(const vccore::Units &a, const vccore::Units &b) {
+  return a.flowrate == b.flowrate && a.total_head == b.total_head &&
+         a.viscosity == b.viscosity && a.density == b.density;
+}
+
+}  // namespace
+
+vccore::CorrectionFactors ResultColumns::at(std::size_t row) const {
+  vccore::CorrectionFactors factors;
+  factors.eta = eta[row];
+  factors.q = q[row];
+  for (std::size_t i = 0; i < h.size(); i++) factors.h.at(i) = h[i][row];
+  factors.error_flag =
+      static_cast<decltype(factors.error_flag)>(error_flag[row]);
+  return factors;
+}
+
+bool IsDatasetFile(const std::string &path) {
+  std::FILE *file = std::fopen(path.c_str(), "rb");
+  if (!file) return false;
+
+  char magic[4] = {};
+  bool is_dataset = std::fread(magic, sizeof(magic), 1, file) == 1 &&
+                    std::memcmp(magic, kMagic, sizeof(kMagic)) == 0;
+  std::fclose(file);
+  return is_dataset;
+}
+
+bool DatasetWriter::Open(const std::string &path, DatasetKind kind,
+                         std::size_t block_rows) {
+  Close();
+  if (std::endian::native != std::endian::little || block_rows == 0 ||
+      block_rows > UINT32_MAX)
+    return false;
+
+  file_ = std::fopen(path.c_str(), "wb");
+  if (!file_) return false;
+
+  kind_ = kind;
+  block_rows_ = block_rows;
+  pending_ = 0;
+  rows_ = 0;
+  blocks_ = 0;
+  failed_ = false;
+
+  std::size_t column_count =
+      (kind == DatasetKind::kInputs) ? kInputColumns : kResultColumns;
+  for (std::size_t i = 0; i < columns_.size(); i++)
+    columns_[i].resize(i < column_count ? block_rows : 0);
+  flags_.resize(kind == DatasetKind::kResults ? block_rows + 1 : 0);
+
+  // Written again with the final counts by Close()
+  FileHeader header = {};
+  std::memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kDatasetVersion;
+  header.kind = static_cast<std::uint32_t>(kind);
+  header.block_rows = static_cast<std::uint32_t>(block_rows);
+  failed_ = std::fwrite(&header, sizeof(header), 1, file_) != 1;
+  return !failed_;
+}
+
+bool DatasetWriter::Append(const OperatingPoint &point) {
+  if (!file_ || kind_ != DatasetKind::kInputs) return false;
+
+  if (pending_ != 0 && !SameUnits(units_, point.units) && !FlushBlock())
+    return false;
+  if (pending_ == block_rows_ && !FlushBlock()) return false;
+
+  units_ = point.units;
+  columns_[0][pending_] = point.params.flowrate;
+  columns_[1][pending_] = point.params.total_head;
+  columns_[2][pending_] = point.params.viscosity;
+  columns_[3][pending_] = point.params.density;
+  pending_++;
+  return true;
+}
+
+bool DatasetWriter::Append(const SoaInput &in, const vccore::Units &units) {
+  if (!file_ || kind_ != DatasetKind::kInputs) return false;
+  if (in.total_head.size() != in.size() || in.viscosity.size() != in.size() ||
+      (!in.density.empty() && in.density.size() != in.size()))
+    return false;
+
+  if (pending_ != 0 && !SameUnits(units_, units) && !FlushBlock())
+    return false;
+  units_ = units;
+
+  for (std::size_t row = 0; row < in.size();) {
+    if (pending_ == block_rows_ && !FlushBlock()) return false;
+
+    std::size_t count = std::min(block_rows_ - pending_, in.size() - row);
+    std::copy_n(&in.flowrate[row], count, &columns_[0][pending_]);
+    std::copy_n(&in.total_head[row], count, &columns_[1][pending_]);
+    std::copy_n(&in.viscosity[row], count, &columns_[2][pending_]);
+    if (in.density.empty())
+      std::fill_n(&columns_[3][pending_], count, 0.0);
+    else
+      std::copy_n(&in.density[row], count, &columns_[3][pending_]);
+    pending_ += count;
+    row += count;
+  }
+  return true;
+}
+
+bool DatasetWriter::Append(const vccore::CorrectionFactors &factors) {
+  if (!file_ || kind_ != DatasetKind::kResults) return false;
+  if (pending_ == block_rows_ && !FlushBlock()) return false;
+
+  columns_[0][pending_] = factors.eta;
+  columns_[1][pending_] = factors.q;
+  for (std::size_t i = 0; i < 4; i++)
+    columns_[2 + i][pending_] = factors.h.at(i);
+  flags_[pending_] = static_cast<std::int32_t>(factors.error_flag);
+  pending_++;
+  return true;
+}
+
+bool DatasetWriter::Append(const SoaOutput &out) {
+  if (!file_ || kind_ != DatasetKind::kResults) return false;
+
+  for (std::size_t row = 0; row < out.size();) {
+    if (pending_ == block_rows_ && !FlushBlock()) return false;
+
+    std::size_t count = std::min(block_rows_ - pending_, out.size() - row);
+    std::copy_n(&out.eta[row], count, &columns_[0][pending_]);
+    std::copy_n(&out.q[row], count, &columns_[1][pending_]);
+    for (std::size_t i = 0; i < 4; i++)
+      std::copy_n(&out.h[i][row], count, &columns_[2 + i][pending_]);
+    std::copy_n(&out.error_flag[row], count, &flags_[pending_]);
+    pending_ += count;
+    row += count;
+  }
+  return true;
+}
+
+bool DatasetWriter::FlushBlock() {
+  if (pending_ == 0) return !failed_;
+
+  BlockHeader header = {};
+  header.rows = static_cast<std::uint32_t>(pending_);
+  if (kind_ == DatasetKind::kInputs) {
+    header.units[0] = static_cast<std::uint8_t>(units_.flowrate);
+    header.units[1] = static_cast<std::uint8_t>(units_.total_head);
+    header.units[2] = static_cast<std::uint8_t>(units_.viscosity);
+    header.units[3] = static_cast<std::uint8_t>(units_.density);
+  }
+  header.size = ColumnBytes(kind_, pending_);
+
+  bool ok = std::fwrite(&header, sizeof(header), 1, file_) == 1;
+  std::size_t column_count =
+      (kind_ == DatasetKind::kInputs) ? kInputColumns : kResultColumns;
+  for (std::size_t i = 0; ok && i < column_count; i++)
+    ok = std::fwrite(columns_[i].data(), sizeof(double), pending_, file_) ==
+         pending_;
+  if (ok && kind_ == DatasetKind::kResults) {
+    // Pad the flag column to 8 bytes
+    std::size_t count = Align8(pending_ * sizeof(std::int32_t)) /
+                        sizeof(std::int32_t);
+    if (count > pending_) flags_[pending_] = 0;
+    ok = std::fwrite(flags_.data(), sizeof(std::int32_t), count, file_) ==
+         count;
+  }
+
+  rows_ += pending_;
+  blocks_++;
+  pending_ = 0;
+  failed_ = failed_ || !ok;
+  return ok;
+}
+
+bool DatasetWriter::Close() {
+  if (!file_) return true;
+
+  bool ok = FlushBlock();
+
+  FileHeader header = {};
+  std::memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kDatasetVersion;
+  header.kind = static_cast<std::uint32_t>(kind_);
+  header.block_rows = static_cast<std::uint32_t>(block_rows_);
+  header.rows = rows_;
+  header.blocks = blocks_;
+  ok = ok && std::fseek(file_, 0, SEEK_SET) == 0 &&
+       std::fwrite(&header, sizeof(header), 1, file_) == 1;
+  ok = (std::fclose(file_) == 0) && ok;
+
+  file_ = nullptr;
+  for (auto &column : columns_) column = {};
+  flags_ = {};
+  return ok && !failed_;
+}
+
+bool DatasetReader::Open(const std::string &path) {
+  failed_ = false;
+  if (std::endian::native != std::endian::little || !file_.Open(path))
+    return false;
+
+  FileHeader header;
+  if (file_.size() < sizeof(header)) {
+    file_.Close();
+    return false;
+  }
+  std::memcpy(&header, file_.data(), sizeof(header));
+
+  if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 ||
+      header.version != kDatasetVersion || header.block_rows == 0 ||
+      (header.kind != static_cast<std::uint32_t>(DatasetKind::kInputs) &&
+       header.kind != static_cast<std::uint32_t>(DatasetKind::kResults))) {
+    file_.Close();
+    return false;
+  }
+
+  kind_ = static_cast<DatasetKind>(header.kind);
+  block_rows_ = header.block_rows;
+  rows_ = header.rows;
+  Rewind();
+  return true;
+}
+
+void DatasetReader::Rewind() {
+  offset_ = sizeof(FileHeader);
+  released_ = 0;
+  failed_ = false;
+}
+
+const unsigned char *DatasetReader::Advance(DatasetKind kind,
+                                            std::uint32_t &rows,
+                                            vccore::Units &units) {
+  if (failed_ || !file_.is_open()) return nullptr;
+  if (kind != kind_) {
+    failed_ = true;
+    return nullptr;
+  }
+  if (offset_ == file_.size()) return nullptr;
+
+  BlockHeader header;
+  if (file_.size() - offset_ < sizeof(header)) {
+    failed_ = true;
+    return nullptr;
+  }
+  std::memcpy(&header, file_.data() + offset_, sizeof(header));
+
+  bool valid = header.rows != 0 && header.rows <= block_rows_ &&
+               header.size == ColumnBytes(kind, header.rows) &&
+               header.size <= file_.size() - offset_ - sizeof(header);
+  for (std::size_t i = 0; valid && kind == DatasetKind::kInputs && i < 4; i++)
+    valid = header.units[i] < kUnitCounts[i];
+  if (!valid) {
+    failed_ = true;
+    return nullptr;
+  }
+
+  // The previous block has been consumed, its pages are no longer needed
+  file_.Release(released_, offset_ - released_);
+  released_ = offset_;
+
+  rows = header.rows;
+  units.flowrate = static_cast<vccore::FlowrateUnit>(header.units[0]);
+  units.total_head = static_cast<vccore::TotalHeadUnit>(header.units[1]);
+  units.viscosity = static_cast<vccore::ViscosityUnit>(header.units[2]);
+  units.density = static_cast<vccore::DensityUnit>(header.units[3]);
+
+  const unsigned char *columns = file_.data() + offset_ + sizeof(header);
+  offset_ += sizeof(header) + header.size;
+  return columns;
+}
+
+bool DatasetReader::NextBlock(vccore::Units &units, SoaInput &columns) {
+  std::uint32_t rows = 0;
+  const unsigned char *data = Advance(DatasetKind::kInputs, rows, units);
+  if (!data) return false;
+
+  // The mapping is page aligned and every column starts at a multiple of 8
+  const double *values = reinterpret_cast<const double *>(data);
+  columns.flowrate = {values, rows};
+  columns.total_head = {values + rows, rows};
+  columns.viscosity = {values + 2 * rows, rows};
+  columns.density = {values + 3 * rows, rows};
+  return true;
+}
+
+bool DatasetReader::NextBlock(ResultColumns &columns) {
+  std::uint32_t rows = 0;
+  vccore::Units units;
+  const unsigned char *data = Advance(DatasetKind::kResults, rows, units);
+  if (!data) return false;
+
+  const double *values = reinterpret_cast<const double *>(data);
+  columns.eta = {values, rows};
+  columns.q = {values + rows, rows};
+  for (std::size_t i = 0; i < 4; i++)
+    columns.h[i] = {values + (2 + i) * rows, rows};
+  columns.error_flag = {
+      reinterpret_cast<const std::int32_t *>(values + kResultColumns * rows),
+      rows};
+  return true;
+}
+
+bool ConvertRows(RowReader &reader, DatasetWriter &writer) {
+  std::vector<OperatingPoint> rows;
+  rows.reserve(kDefaultBlockRows);
+
+  while (reader.Read(rows, kDefaultBlockRows) != 0) {
+    for (const auto &row : rows)
+      if (!writer.Append(row)) return false;
+    rows.clear();
+  }
+  return !reader.Failed();
+}
+
+}  // namespace batch
+
+}  // namespace visco
+
+}  // namespace spauly
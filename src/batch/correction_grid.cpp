@@ -0,0 +1,428 @@
+// Visco Correct Desktop - Correction factors for centrifugal pumps
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Visco-Correct-Desktop>
+#include "spauly/visco/batch/correction_grid.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+
+#include "spauly/visco/batch/batch_engine.h"
+#include "spauly/visco/batch/unit_conversion.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define VCD_GRID_SSE
+#include <xmmintrin.h>
+#endif
+
+namespace spauly {
+namespace visco {
+namespace batch {
+
+namespace {
+
+constexpr char kMagic[4] = {'V', 'C', 'D', 'G'};
+constexpr std::uint32_t kFileVersion = 1;
+constexpr std::size_t kMaxCellsPerOctave = 64;
+// Rows normalised at once by the grid path of the column batches
+constexpr std::size_t kNormaliseBlock = 512;
+
+/// @brief Calculates a slice of canonical points, on the engine if given.
+void CalculateSlice(const std::vector<vccore::Parameters> &params,
+                    std::vector<vccore::CorrectionFactors> &results,
+                    vccore::Calculator &calculator, BatchEngine *engine) {
+  results.resize(params.size());
+  if (engine) {
+    engine->Calculate(params, CanonicalUnits(), results);
+    return;
+  }
+  const vccore::Units units = CanonicalUnits();
+  for (std::size_t i = 0; i < params.size(); i++)
+    results[i] = calculator.Calculate(params[i], units);
+}
+
+vccore::Parameters CanonicalPoint(double flowrate, double total_head,
+                                  double viscosity) {
+  vccore::Parameters params;
+  params.flowrate = flowrate;
+  params.total_head = total_head;
+  params.viscosity = viscosity;
+  params.density = 1000.0;
+  return params;
+}
+
+void AccumulateError(const vccore::CorrectionFactors &exact,
+                     const vccore::CorrectionFactors &interpolated,
+                     GridError &error) {
+  error.eta = std::max(error.eta, std::abs(exact.eta - interpolated.eta));
+  error.q = std::max(error.q, std::abs(exact.q - interpolated.q));
+  for (std::size_t i = 0; i < 4; i++)
+    error.h = std::max(error.h, std::abs(exact.h.at(i) - interpolated.h.at(i)));
+  error.samples++;
+}
+
+/// @brief Piecewise linear approximation of log2(x) for positive, finite x:
+/// the exponent plus the mantissa fraction, read straight from the IEEE 754
+/// bits. It is monotonic and exactly invertible, so the axes are spaced in
+/// this coordinate instead of calling std::log per lookup.
+double PseudoLog2(double x) {
+  return static_cast<double>(std::bit_cast<std::int64_t>(x)) * 0x1p-52 -
+         1023.0;
+}
+
+double InversePseudoLog2(double u) {
+  return std::bit_cast<double>(
+      static_cast<std::int64_t>((u + 1023.0) * 0x1p52));
+}
+
+}  // namespace
+
+void CorrectionGrid::Axis::Init(double min, double max,
+                                std::size_t cells_per_octave) {
+  const double first_octave = std::floor(std::log2(min));
+  const double octaves = std::ceil(std::log2(max)) - first_octave;
+  count = static_cast<std::size_t>(octaves) * cells_per_octave + 1;
+  log_min = first_octave;
+  step = 1.0 / static_cast<double>(cells_per_octave);
+  inv_step = static_cast<double>(cells_per_octave);
+}
+
+double CorrectionGrid::Axis::Value(double index) const {
+  return InversePseudoLog2(log_min + step * index);
+}
+
+std::size_t CorrectionGrid::Axis::Locate(double x, double &fraction) const {
+  double t = (PseudoLog2(x) - log_min) * inv_step;
+  t = std::clamp(t, 0.0, static_cast<double>(count - 1));
+  std::size_t index = std::min(static_cast<std::size_t>(t), count - 2);
+  fraction = t - static_cast<double>(index);
+  return index;
+}
+
+void CorrectionGrid::InitAxes(std::size_t cells_per_octave) {
+  cells_per_octave_ = cells_per_octave;
+  axes_[0].Init(kMinFlowrate, kMaxFlowrate, cells_per_octave);
+  axes_[1].Init(kMinTotalHead, kMaxTotalHead, cells_per_octave);
+  axes_[2].Init(kMinViscosity, kMaxViscosity, cells_per_octave);
+}
+
+bool CorrectionGrid::Build(std::size_t cells_per_octave, BatchEngine *engine) {
+  if (cells_per_octave == 0 || cells_per_octave > kMaxCellsPerOctave)
+    return false;
+
+  InitAxes(cells_per_octave);
+  const std::size_t flowrate_nodes = axes_[0].count;
+  const std::size_t total_head_nodes = axes_[1].count;
+  const std::size_t viscosity_nodes = axes_[2].count;
+  nodes_.assign(flowrate_nodes * total_head_nodes * viscosity_nodes *
+                    kNodeStride,
+                0.0f);
+
+  // One flowrate slice at a time keeps the temporary buffers small
+  vccore::Calculator calculator;
+  std::vector<vccore::Parameters> params;
+  std::vector<vccore::CorrectionFactors> results;
+  params.reserve(total_head_nodes * viscosity_nodes);
+
+  for (std::size_t i = 0; i < flowrate_nodes; i++) {
+    params.clear();
+    for (std::size_t j = 0; j < total_head_nodes; j++)
+      for (std::size_t k = 0; k < viscosity_nodes; k++)
+        params.push_back(CanonicalPoint(axes_[0].Value(i), axes_[1].Value(j),
+                                        axes_[2].Value(k)));
+    CalculateSlice(params, results, calculator, engine);
+
+    float *node = &nodes_[NodeIndex(i, 0, 0)];
+    for (const auto &result : results) {
+      node[0] = static_cast<float>(result.eta);
+      node[1] = static_cast<float>(result.q);
+      for (std::size_t h = 0; h < 4; h++)
+        node[2 + h] = static_cast<float>(result.h.at(h));
+      node[kFlagOffset] = static_cast<float>(result.error_flag);
+      node += kNodeStride;
+    }
+  }
+
+  // Sample the error in the centre of every cell
+  error_ = GridError();
+  vccore::CorrectionFactors interpolated;
+  for (std::size_t i = 0; i + 1 < flowrate_nodes; i++) {
+    params.clear();
+    for (std::size_t j = 0; j + 1 < total_head_nodes; j++)
+      for (std::size_t k = 0; k + 1 < viscosity_nodes; k++)
+        params.push_back(CanonicalPoint(axes_[0].Value(i + 0.5),
+                                        axes_[1].Value(j + 0.5),
+                                        axes_[2].Value(k + 0.5)));
+    CalculateSlice(params, results, calculator, engine);
+
+    for (std::size_t n = 0; n < params.size(); n++) {
+      if (results[n].error_flag) continue;
+      if (Lookup(params[n].flowrate, params[n].total_head,
+                 params[n].viscosity, interpolated))
+        AccumulateError(results[n], interpolated, error_);
+    }
+  }
+  return true;
+}
+
+GridError CorrectionGrid::Validate(std::size_t samples,
+                                   std::uint64_t seed) const {
+  GridError error;
+  if (empty()) return error;
+
+  std::mt19937_64 rng(seed);
+  std::uniform_real_distribution<double> unit(0.0, 1.0);
+  auto log_uniform = [&](double min, double max) {
+    return min * std::pow(max / min, unit(rng));
+  };
+
+  vccore::Calculator calculator;
+  const vccore::Units units = CanonicalUnits();
+  vccore::CorrectionFactors interpolated;
+  for (std::size_t n = 0; n < samples; n++) {
+    vccore::Parameters params = CanonicalPoint(
+        log_uniform(kMinFlowrate, kMaxFlowrate),
+        log_uniform(kMinTotalHead, kMaxTotalHead),
+        log_uniform(kMinViscosity, kMaxViscosity));
+    vccore::CorrectionFactors exact = calculator.Calculate(params, units);
+    if (exact.error_flag) continue;
+    if (Lookup(params.flowrate, params.total_head, params.viscosity,
+               interpolated))
+      AccumulateError(exact, interpolated, error);
+  }
+  return error;
+}
+
+bool CorrectionGrid::Save(const std::string &path) const {
+  if (empty() || std::endian::native != std::endian::little) return false;
+
+  std::FILE *file = std::fopen(path.c_str(), "wb");
+  if (!file) return false;
+
+  const std::uint32_t cells_per_octave =
+      static_cast<std::uint32_t>(cells_per_octave_);
+  const double estimate[3] = {error_.eta, error_.q, error_.h};
+  const std::uint64_t samples = error_.samples;
+
+  bool ok = std::fwrite(kMagic, sizeof(kMagic), 1, file) == 1 &&
+            std::fwrite(&kFileVersion, sizeof(kFileVersion), 1, file) == 1 &&
+            std::fwrite(&cells_per_octave, sizeof(cells_per_octave), 1,
+                        file) == 1 &&
+            std::fwrite(estimate, sizeof(estimate), 1, file) == 1 &&
+            std::fwrite(&samples, sizeof(samples), 1, file) == 1 &&
+            std::fwrite(nodes_.data(), sizeof(float), nodes_.size(), file) ==
+                nodes_.size();
+  return (std::fclose(file) == 0) && ok;
+}
+
+bool CorrectionGrid::Load(const std::string &path) {
+  if (std::endian::native != std::endian::little) return false;
+
+  std::FILE *file = std::fopen(path.c_str(), "rb");
+  if (!file) return false;
+
+  char magic[4] = {};
+  std::uint32_t version = 0;
+  std::uint32_t cells_per_octave = 0;
+  double estimate[3] = {};
+  std::uint64_t samples = 0;
+  bool ok = std::fread(magic, sizeof(magic), 1, file) == 1 &&
+            std::memcmp(magic, kMagic, sizeof(kMagic)) == 0 &&
+            std::fread(&version, sizeof(version), 1, file) == 1 &&
+            version == kFileVersion &&
+            std::fread(&cells_per_octave, sizeof(cells_per_octave), 1,
+                       file) == 1 &&
+            cells_per_octave != 0 && cells_per_octave <= kMaxCellsPerOctave &&
+            std::fread(estimate, sizeof(estimate), 1, file) == 1 &&
+            std::fread(&samples, sizeof(samples), 1, file) == 1;
+
+  CorrectionGrid grid;
+  if (ok) {
+    grid.InitAxes(cells_per_octave);
+    grid.nodes_.resize(grid.axes_[0].count * grid.axes_[1].count *
+                       grid.axes_[2].count * kNodeStride);
+    ok = std::fread(grid.nodes_.data(), sizeof(float), grid.nodes_.size(),
+                    file) == grid.nodes_.size();
+  }
+  std::fclose(file);
+  if (!ok) return false;
+
+  cells_per_octave_ = grid.cells_per_octave_;
+  axes_ = grid.axes_;
+  nodes_ = std::move(grid.nodes_);
+  error_.eta = estimate[0];
+  error_.q = estimate[1];
+  error_.h = estimate[2];
+  error_.samples = static_cast<std::size_t>(samples);
+  return true;
+}
+
+bool CorrectionGrid::Lookup(double flowrate, double total_head,
+                            double viscosity,
+                            vccore::CorrectionFactors &result) const {
+  if (empty()) return false;
+
+  double fx, fy, fz;
+  const std::size_t i = axes_[0].Locate(flowrate, fx);
+  const std::size_t j = axes_[1].Locate(total_head, fy);
+  const std::size_t k = axes_[2].Locate(viscosity, fz);
+
+  const std::size_t dk = kNodeStride;
+  const std::size_t dj = axes_[2].count * kNodeStride;
+  const std::size_t di = axes_[1].count * dj;
+  const float *n = &nodes_[NodeIndex(i, j, k)];
+  const float *corners[8] = {n,           n + dk,           n + dj,
+                             n + dj + dk, n + di,           n + di + dk,
+                             n + di + dj, n + di + dj + dk};
+
+  // All lanes of a node, including the error flag, are interpolated at once.
+  // Flags are non-negative, so the interpolated flag is only zero if no
+  // contributing corner carries one.
+  alignas(16) float values[kNodeStride];
+#if defined(VCD_GRID_SSE)
+  const __m128 wz = _mm_set1_ps(static_cast<float>(fz));
+  const __m128 wy = _mm_set1_ps(static_cast<float>(fy));
+  const __m128 wx = _mm_set1_ps(static_cast<float>(fx));
+  auto lerp = [](__m128 a, __m128 b, __m128 w) {
+    return _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), w));
+  };
+  for (std::size_t half = 0; half < kNodeStride; half += 4) {
+    __m128 c00 = lerp(_mm_loadu_ps(corners[0] + half),
+                      _mm_loadu_ps(corners[1] + half), wz);
+    __m128 c01 = lerp(_mm_loadu_ps(corners[2] + half),
+                      _mm_loadu_ps(corners[3] + half), wz);
+    __m128 c10 = lerp(_mm_loadu_ps(corners[4] + half),
+                      _mm_loadu_ps(corners[5] + half), wz);
+    __m128 c11 = lerp(_mm_loadu_ps(corners[6] + half),
+                      _mm_loadu_ps(corners[7] + half), wz);
+    _mm_store_ps(values + half,
+                 lerp(lerp(c00, c01, wy), lerp(c10, c11, wy), wx));
+  }
+#else
+  const float wz = static_cast<float>(fz);
+  const float wy = static_cast<float>(fy);
+  const float wx = static_cast<float>(fx);
+  for (std::size_t c = 0; c < kNodeStride; c++) {
+    float c00 = corners[0][c] + (corners[1][c] - corners[0][c]) * wz;
+    float c01 = corners[2][c] + (corners[3][c] - corners[2][c]) * wz;
+    float c10 = corners[4][c] + (corners[5][c] - corners[4][c]) * wz;
+    float c11 = corners[6][c] + (corners[7][c] - corners[6][c]) * wz;
+    float c0 = c00 + (c01 - c00) * wy;
+    float c1 = c10 + (c11 - c10) * wy;
+    values[c] = c0 + (c1 - c0) * wx;
+  }
+#endif
+  if (values[kFlagOffset] != 0.0f) return false;
+
+  result.eta = values[0];
+  result.q = values[1];
+  for (std::size_t h = 0; h < 4; h++) result.h.at(h) = values[2 + h];
+  result.error_flag = static_cast<decltype(result.error_flag)>(0);
+  return true;
+}
+
+vccore::CorrectionFactors GridCalculator::Calculate(
+    const vccore::Parameters &params, const vccore::Units &units,
+    CalculationMode mode) {
+  // Points outside the chart, including unknown units, are left to the core
+  // in their own units, so both modes return its factors and flags
+  const vccore::Parameters canonical = Normalise(params, GetUnitScale(units));
+  if (CheckRanges(canonical) != 0) return calculator_.Calculate(params, units);
+
+  vccore::CorrectionFactors result;
+  if (mode == CalculationMode::kGrid && grid_ &&
+      grid_->Lookup(canonical.flowrate, canonical.total_head,
+                    canonical.viscosity, result))
+    return result;
+  return calculator_.Calculate(canonical, CanonicalUnits());
+}
+
+bool GridCalculator::Calculate(const SoaInput &in, const vccore::Units &units,
+                               const SoaOutput &out, CalculationMode mode) {
+  if (mode == CalculationMode::kExact || !grid_ || grid_->empty() ||
+      !IsValidUnits(units))
+    return soa_calculator_.Calculate(in, units, out);
+
+  const std::size_t size = in.size();
+  const UnitScale scale = GetUnitScale(units);
+  if (in.total_head.size() != size || in.viscosity.size() != size ||
+      (scale.dynamic_viscosity && in.density.size() != size) ||
+      out.size() < size)
+    return false;
+
+  // Normalised once per block by the kernel of the unit combination
+  flowrate_.resize(kNormaliseBlock);
+  total_head_.resize(kNormaliseBlock);
+  viscosity_.resize(kNormaliseBlock);
+  flags_.resize(kNormaliseBlock);
+  const vccore::Units canonical_units = CanonicalUnits();
+  for (std::size_t offset = 0; offset < size; offset += kNormaliseBlock) {
+    const std::size_t count = std::min(kNormaliseBlock, size - offset);
+    NormaliseColumns(in.subspan(offset, count), units, flowrate_, total_head_,
+                     viscosity_, flags_);
+
+    for (std::size_t i = 0; i < count; i++) {
+      const std::size_t row = offset + i;
+      vccore::CorrectionFactors result;
+      if (flags_[i] != 0) {
+        vccore::Parameters params;
+        params.flowrate = in.flowrate[row];
+        params.total_head = in.total_head[row];
+        params.viscosity = in.viscosity[row];
+        if (!in.density.empty()) params.density = in.density[row];
+        result = calculator_.Calculate(params, units);
+      } else if (!grid_->Lookup(flowrate_[i], total_head_[i], viscosity_[i],
+                                result)) {
+        vccore::Parameters params;
+        params.flowrate = flowrate_[i];
+        params.total_head = total_head_[i];
+        params.viscosity = viscosity_[i];
+        params.density =
+            in.density.empty() ? 0.0 : in.density[row] * scale.density;
+        result = calculator_.Calculate(params, canonical_units);
+      }
+      out.eta[row] = result.eta;
+      out.q[row] = result.q;
+      for (std::size_t h = 0; h < out.h.size(); h++)
+        out.h[h][row] = result.h.at(h);
+      out.error_flag[row] = static_cast<std::int32_t>(result.error_flag);
+    }
+  }
+  return true;
+}
+
+bool GridCalculator::Calculate(std::span<const OperatingPoint> points,
+                               std::span<vccore::CorrectionFactors> out,
+                               CalculationMode mode) {
+  if (mode == CalculationMode::kExact || !grid_ || grid_->empty())
+    return soa_calculator_.Calculate(points, out);
+
+  if (out.size() < points.size()) return false;
+  for (std::size_t i = 0; i < points.size(); i++)
+    out[i] = Calculate(points[i].params, points[i].units, mode);
+  return true;
+}
+
+}  // namespace batch
+
+}  // namespace visco
+
+}  // namespace spauly
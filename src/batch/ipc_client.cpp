@@ -0,0 +1,183 @@
+// Visco Correct Desktop - Correction factors for centrifugal pumps
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Visco-Correct-Desktop>
+#include "spauly/visco/batch/ipc_client.h"
+
+#include <cstring>
+
+#ifndef _WIN32
+#include <errno.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace spauly {
+namespace visco {
+namespace batch {
+
+IpcClient::IpcClient()
+    : buffer_(IpcResponseBytes(kIpcMaxFrameRows) / 8),
+      zeros_(kIpcMaxFrameRows, 0.0) {}
+
+#ifdef _WIN32
+
+bool IpcClient::Connect(const std::string &) { return false; }
+void IpcClient::Close() {}
+bool IpcClient::Send(std::uint32_t, const SoaInput &, const vccore::Units &) {
+  return false;
+}
+bool IpcClient::Receive(std::uint32_t &, IpcStatus &, ResultColumns &) {
+  return false;
+}
+
+#else
+
+namespace {
+
+#ifdef MSG_NOSIGNAL
+constexpr int kSendFlags = MSG_NOSIGNAL;
+#else
+constexpr int kSendFlags = 0;
+#endif
+
+bool ReceiveAll(int fd, unsigned char *data, std::size_t size) {
+  while (size > 0) {
+    ssize_t received = ::recv(fd, data, size, 0);
+    if (received < 0 && errno == EINTR) continue;
+    if (received <= 0) return false;
+    data += received;
+    size -= static_cast<std::size_t>(received);
+  }
+  return true;
+}
+
+}  // namespace
+
+bool IpcClient::Connect(const std::string &path) {
+  Close();
+
+  sockaddr_un address = {};
+  address.sun_family = AF_UNIX;
+  if (path.size() >= sizeof(address.sun_path)) return false;
+  std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+  fd_ = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd_ < 0) return false;
+#ifdef SO_NOSIGPIPE
+  int on = 1;
+  ::setsockopt(fd_, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+  if (::connect(fd_, reinterpret_cast<const sockaddr *>(&address),
+                sizeof(address)) != 0) {
+    Close();
+    return false;
+  }
+  return true;
+}
+
+void IpcClient::Close() {
+  if (fd_ >= 0) ::close(fd_);
+  fd_ = -1;
+}
+
+bool IpcClient::Send(std::uint32_t id, const SoaInput &in,
+                     const vccore::Units &units) {
+  const std::size_t rows = in.size();
+  if (fd_ < 0 || rows > kIpcMaxFrameRows || in.total_head.size() != rows ||
+      in.viscosity.size() != rows ||
+      (!in.density.empty() && in.density.size() != rows))
+    return false;
+
+  IpcRequestHeader header;
+  std::memcpy(header.magic, kIpcRequestMagic, 4);
+  header.id = id;
+  header.rows = static_cast<std::uint32_t>(rows);
+  EncodeUnits(units, header.units);
+
+  const double *density =
+      in.density.empty() ? zeros_.data() : in.density.data();
+  iovec parts[5] = {
+      {&header, sizeof(header)},
+      {const_cast<double *>(in.flowrate.data()), rows * sizeof(double)},
+      {const_cast<double *>(in.total_head.data()), rows * sizeof(double)},
+      {const_cast<double *>(in.viscosity.data()), rows * sizeof(double)},
+      {const_cast<double *>(density), rows * sizeof(double)}};
+
+  // sendmsg() may stop anywhere in the frame, the parts are advanced until
+  // everything is written
+  msghdr message = {};
+  message.msg_iov = parts;
+  message.msg_iovlen = 5;
+  while (message.msg_iovlen > 0) {
+    ssize_t sent = ::sendmsg(fd_, &message, kSendFlags);
+    if (sent < 0 && errno == EINTR) continue;
+    if (sent <= 0) return false;
+
+    std::size_t remaining = static_cast<std::size_t>(sent);
+    while (message.msg_iovlen > 0 &&
+           remaining >= message.msg_iov->iov_len) {
+      remaining -= message.msg_iov->iov_len;
+      message.msg_iov++;
+      message.msg_iovlen--;
+    }
+    if (message.msg_iovlen > 0) {
+      message.msg_iov->iov_base =
+          static_cast<unsigned char *>(message.msg_iov->iov_base) + remaining;
+      message.msg_iov->iov_len -= remaining;
+    }
+  }
+  return true;
+}
+
+bool IpcClient::Receive(std::uint32_t &id, IpcStatus &status,
+                        ResultColumns &columns) {
+  auto *buffer = reinterpret_cast<unsigned char *>(buffer_.data());
+  IpcResponseHeader header;
+  if (fd_ < 0 || !ReceiveAll(fd_, buffer, sizeof(header))) return false;
+  std::memcpy(&header, buffer, sizeof(header));
+  if (std::memcmp(header.magic, kIpcResponseMagic, 4) != 0 ||
+      header.rows > kIpcMaxFrameRows)
+    return false;
+
+  const std::size_t rows = header.rows;
+  if (!ReceiveAll(fd_, buffer + sizeof(header),
+                  IpcResponseBytes(rows) - sizeof(header)))
+    return false;
+
+  const auto *results =
+      reinterpret_cast<const double *>(buffer + sizeof(header));
+  columns.eta = {results, rows};
+  columns.q = {results + rows, rows};
+  for (std::size_t i = 0; i < columns.h.size(); i++)
+    columns.h[i] = {results + (2 + i) * rows, rows};
+  columns.error_flag = {
+      reinterpret_cast<const std::int32_t *>(results + 6 * rows), rows};
+
+  id = header.id;
+  status = static_cast<IpcStatus>(header.status);
+  return true;
+}
+
+#endif
+
+}  // namespace batch
+
+}  // namespace visco
+
+}  // namespace spauly
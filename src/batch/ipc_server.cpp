@@ -0,0 +1,351 @@
+// Visco Correct Desktop - Correction factors for centrifugal pumps
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Visco-Correct-Desktop>
+#include "spauly/visco/batch/ipc_server.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+#ifndef _WIN32
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace spauly {
+namespace visco {
+namespace batch {
+
+namespace {
+
+constexpr std::size_t kInWords = IpcRequestBytes(kIpcMaxFrameRows) / 8;
+constexpr std::size_t kOutWords = 2 * IpcResponseBytes(kIpcMaxFrameRows) / 8;
+
+#ifdef MSG_NOSIGNAL
+constexpr int kSendFlags = MSG_NOSIGNAL;
+#else
+constexpr int kSendFlags = 0;
+#endif
+
+}  // namespace
+
+IpcServer::IpcServer(std::size_t thread_count)
+    : engine_(thread_count), connections_(kMaxConnections) {}
+
+IpcServer::~IpcServer() { Close(); }
+
+void IpcServer::SetMode(CalculationMode mode, const CorrectionGrid *grid) {
+  engine_.SetMode(mode, grid);
+  calculator_.set_grid(grid);
+}
+
+#ifdef _WIN32
+
+bool IpcServer::Listen(const std::string &) { return false; }
+bool IpcServer::Serve() { return false; }
+void IpcServer::Stop() { stop_ = true; }
+void IpcServer::Close() {}
+void IpcServer::Accept() {}
+bool IpcServer::Receive(Connection &) { return false; }
+bool IpcServer::Process(Connection &) { return false; }
+bool IpcServer::Send(Connection &) { return false; }
+void IpcServer::Disconnect(Connection &) {}
+
+#else
+
+bool IpcServer::Listen(const std::string &path) {
+  Close();
+
+  sockaddr_un address = {};
+  address.sun_family = AF_UNIX;
+  if (std::endian::native != std::endian::little ||
+      path.size() >= sizeof(address.sun_path))
+    return false;
+  std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+  if (::pipe(wake_fds_) != 0) return false;
+  listen_fd_ = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  if (listen_fd_ < 0) {
+    Close();
+    return false;
+  }
+  ::fcntl(listen_fd_, F_SETFL, O_NONBLOCK);
+  ::fcntl(wake_fds_[0], F_SETFL, O_NONBLOCK);
+  ::fcntl(wake_fds_[1], F_SETFL, O_NONBLOCK);
+
+  // A socket file without a server behind it refuses connections
+  ::unlink(path.c_str());
+  if (::bind(listen_fd_, reinterpret_cast<const sockaddr *>(&address),
+             sizeof(address)) != 0 ||
+      ::listen(listen_fd_, static_cast<int>(kMaxConnections)) != 0) {
+    Close();
+    return false;
+  }
+
+  path_ = path;
+  rows_served_ = 0;
+  stop_ = false;
+  return true;
+}
+
+bool IpcServer::Serve() {
+  if (listen_fd_ < 0) return false;
+
+  // Index 0 is the wake pipe, 1 the listening socket
+  std::vector<pollfd> fds;
+  std::vector<Connection *> polled;
+  fds.reserve(kMaxConnections + 2);
+  polled.reserve(kMaxConnections + 2);
+
+  while (!stop_) {
+    fds.clear();
+    polled.clear();
+    fds.push_back({wake_fds_[0], POLLIN, 0});
+    fds.push_back({listen_fd_, POLLIN, 0});
+    polled.resize(2, nullptr);
+    for (Connection &connection : connections_) {
+      if (connection.fd < 0) continue;
+      short events = 0;
+      if (!connection.eof && connection.in_end < connection.in.size() * 8)
+        events |= POLLIN;
+      if (connection.out_begin != connection.out_end) events |= POLLOUT;
+      fds.push_back({connection.fd, events, 0});
+      polled.push_back(&connection);
+    }
+
+    if (::poll(fds.data(), fds.size(), -1) < 0) {
+      if (errno == EINTR) continue;
+      return false;
+    }
+
+    if (fds[0].revents != 0) {
+      char drain[64];
+      while (::read(wake_fds_[0], drain, sizeof(drain)) > 0) {
+      }
+    }
+    if (fds[1].revents & POLLIN) Accept();
+
+    for (std::size_t i = 2; i < fds.size(); i++) {
+      Connection &connection = *polled[i];
+      short revents = fds[i].revents;
+      if (revents == 0) continue;
+
+      bool open = true;
+      if (!connection.eof && (revents & (POLLIN | POLLHUP | POLLERR)))
+        open = Receive(connection);
+      // Sending first makes room for the results of further requests
+      if (open && (revents & POLLOUT)) open = Send(connection);
+      if (open) open = Process(connection) && Send(connection);
+
+      // A client that closed its end still gets the answers to every
+      // complete request it sent. The connection is closed once they are all
+      // sent and only an incomplete frame, if any, is left.
+      while (open && connection.eof &&
+             connection.out_begin == connection.out_end) {
+        const std::size_t buffered = connection.in_end;
+        open = Process(connection) && Send(connection);
+        if (connection.in_end == buffered &&
+            connection.out_begin == connection.out_end)
+          open = false;
+      }
+      if (!open) Disconnect(connection);
+    }
+  }
+  return true;
+}
+
+void IpcServer::Stop() {
+  stop_ = true;
+  if (wake_fds_[1] >= 0) {
+    char wake = 1;
+    [[maybe_unused]] ssize_t written = ::write(wake_fds_[1], &wake, 1);
+  }
+}
+
+void IpcServer::Close() {
+  for (Connection &connection : connections_)
+    if (connection.fd >= 0) Disconnect(connection);
+
+  if (listen_fd_ >= 0) {
+    ::close(listen_fd_);
+    listen_fd_ = -1;
+    ::unlink(path_.c_str());
+  }
+  for (int &fd : wake_fds_) {
+    if (fd >= 0) ::close(fd);
+    fd = -1;
+  }
+  path_.clear();
+}
+
+void IpcServer::Accept() {
+  while (true) {
+    int fd = ::accept(listen_fd_, nullptr, nullptr);
+    if (fd < 0) return;
+
+    auto slot = std::find_if(connections_.begin(), connections_.end(),
+                             [](const Connection &c) { return c.fd < 0; });
+    if (slot == connections_.end()) {
+      ::close(fd);
+      continue;
+    }
+    ::fcntl(fd, F_SETFL, O_NONBLOCK);
+#ifdef SO_NOSIGPIPE
+    int on = 1;
+    ::setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+
+    // The buffers of a slot are kept for the following connections
+    slot->fd = fd;
+    slot->in.resize(kInWords);
+    slot->out.resize(kOutWords);
+    slot->in_begin = slot->in_end = 0;
+    slot->out_begin = slot->out_end = 0;
+    slot->eof = false;
+    active_++;
+  }
+}
+
+bool IpcServer::Receive(Connection &connection) {
+  auto *buffer = reinterpret_cast<unsigned char *>(connection.in.data());
+  const std::size_t capacity = connection.in.size() * 8;
+  while (connection.in_end < capacity) {
+    ssize_t received = ::recv(connection.fd, buffer + connection.in_end,
+                              capacity - connection.in_end, 0);
+    if (received > 0) {
+      connection.in_end += static_cast<std::size_t>(received);
+      continue;
+    }
+    if (received == 0) {
+      // The client closed its end, it may still wait for answers
+      connection.eof = true;
+      return true;
+    }
+    if (errno == EAGAIN || errno == EWOULDBLOCK) return true;
+    if (errno == EINTR) continue;
+    return false;
+  }
+  return true;
+}
+
+bool IpcServer::Process(Connection &connection) {
+  auto *in = reinterpret_cast<unsigned char *>(connection.in.data());
+  auto *out = reinterpret_cast<unsigned char *>(connection.out.data());
+  const std::size_t out_capacity = connection.out.size() * 8;
+
+  while (connection.in_end - connection.in_begin >= sizeof(IpcRequestHeader)) {
+    IpcRequestHeader request;
+    std::memcpy(&request, in + connection.in_begin, sizeof(request));
+    if (std::memcmp(request.magic, kIpcRequestMagic, 4) != 0 ||
+        request.rows > kIpcMaxFrameRows)
+      return false;
+
+    const std::size_t rows = request.rows;
+    if (connection.in_end - connection.in_begin < IpcRequestBytes(rows)) break;
+
+    vccore::Units units;
+    const bool valid = DecodeUnits(request.units, units);
+    const std::size_t response_rows = valid ? rows : 0;
+    if (connection.out_begin == connection.out_end)
+      connection.out_begin = connection.out_end = 0;
+    if (out_capacity - connection.out_end < IpcResponseBytes(response_rows))
+      break;
+
+    IpcResponseHeader response;
+    std::memcpy(response.magic, kIpcResponseMagic, 4);
+    response.id = request.id;
+    response.rows = static_cast<std::uint32_t>(response_rows);
+    response.status = static_cast<std::uint32_t>(
+        valid ? IpcStatus::kOk : IpcStatus::kInvalidUnits);
+    std::memcpy(out + connection.out_end, &response, sizeof(response));
+
+    if (valid) {
+      const auto *columns = reinterpret_cast<const double *>(
+          in + connection.in_begin + sizeof(IpcRequestHeader));
+      SoaInput soa_in;
+      soa_in.flowrate = {columns, rows};
+      soa_in.total_head = {columns + rows, rows};
+      soa_in.viscosity = {columns + 2 * rows, rows};
+      soa_in.density = {columns + 3 * rows, rows};
+
+      auto *results = reinterpret_cast<double *>(out + connection.out_end +
+                                                 sizeof(IpcResponseHeader));
+      SoaOutput soa_out;
+      soa_out.eta = {results, rows};
+      soa_out.q = {results + rows, rows};
+      for (std::size_t i = 0; i < soa_out.h.size(); i++)
+        soa_out.h[i] = {results + (2 + i) * rows, rows};
+      soa_out.error_flag = {
+          reinterpret_cast<std::int32_t *>(results + 6 * rows), rows};
+
+      if (rows < engine_.chunk_size())
+        calculator_.Calculate(soa_in, units, soa_out, engine_.mode());
+      else
+        engine_.Calculate(soa_in, units, soa_out);
+      rows_served_ += rows;
+    }
+
+    connection.in_begin += IpcRequestBytes(rows);
+    connection.out_end += IpcResponseBytes(response_rows);
+  }
+
+  // Moves the incomplete frame to the front, frames keep their alignment as
+  // every frame size is a multiple of 8
+  if (connection.in_begin > 0) {
+    std::memmove(in, in + connection.in_begin,
+                 connection.in_end - connection.in_begin);
+    connection.in_end -= connection.in_begin;
+    connection.in_begin = 0;
+  }
+  return true;
+}
+
+bool IpcServer::Send(Connection &connection) {
+  const auto *out = reinterpret_cast<const unsigned char *>(
+      connection.out.data());
+  while (connection.out_begin < connection.out_end) {
+    ssize_t sent = ::send(connection.fd, out + connection.out_begin,
+                          connection.out_end - connection.out_begin,
+                          kSendFlags);
+    if (sent > 0) {
+      connection.out_begin += static_cast<std::size_t>(sent);
+      continue;
+    }
+    if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return true;
+    if (sent < 0 && errno == EINTR) continue;
+    return false;
+  }
+  return true;
+}
+
+void IpcServer::Disconnect(Connection &connection) {
+  ::close(connection.fd);
+  connection.fd = -1;
+  active_--;
+}
+
+#endif
+
+}  // namespace batch
+
+}  // namespace visco
+
+}  // namespace spauly
@@ -0,0 +1,137 @@
+// Visco Correct Desktop - Correction factors for centrifugal pumps
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Visco-Correct-Desktop>
+#include "spauly/visco/batch/mapped_file.h"
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace spauly {
+namespace visco {
+namespace batch {
+
+#ifdef _WIN32
+
+bool MappedFile::Open(const std::string &path) {
+  Close();
+
+  HANDLE file = ::CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ,
+                              nullptr, OPEN_EXISTING,
+                              FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+  if (file == INVALID_HANDLE_VALUE) return false;
+
+  LARGE_INTEGER size;
+  if (!::GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+    ::CloseHandle(file);
+    return false;
+  }
+
+  HANDLE mapping =
+      ::CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (!mapping) {
+    ::CloseHandle(file);
+    return false;
+  }
+
+  void *data = ::MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  if (!data) {
+    ::CloseHandle(mapping);
+    ::CloseHandle(file);
+    return false;
+  }
+
+  file_ = file;
+  mapping_ = mapping;
+  data_ = static_cast<const unsigned char *>(data);
+  size_ = static_cast<std::size_t>(size.QuadPart);
+  return true;
+}
+
+void MappedFile::Close() {
+  if (data_) ::UnmapViewOfFile(data_);
+  if (mapping_) ::CloseHandle(mapping_);
+  if (file_) ::CloseHandle(file_);
+  data_ = nullptr;
+  mapping_ = nullptr;
+  file_ = nullptr;
+  size_ = 0;
+}
+
+void MappedFile::Release(std::size_t, std::size_t) {
+  // Windows trims the working set of file backed views on its own
+}
+
+#else
+
+bool MappedFile::Open(const std::string &path) {
+  Close();
+
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) return false;
+
+  struct stat info;
+  if (::fstat(fd, &info) != 0 || info.st_size == 0) {
+    ::close(fd);
+    return false;
+  }
+
+  void *data = ::mmap(nullptr, static_cast<std::size_t>(info.st_size),
+                      PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);  // The mapping keeps its own reference
+  if (data == MAP_FAILED) return false;
+
+  ::madvise(data, static_cast<std::size_t>(info.st_size), MADV_SEQUENTIAL);
+  data_ = static_cast<const unsigned char *>(data);
+  size_ = static_cast<std::size_t>(info.st_size);
+  return true;
+}
+
+void MappedFile::Close() {
+  if (data_) ::munmap(const_cast<unsigned char *>(data_), size_);
+  data_ = nullptr;
+  size_ = 0;
+}
+
+void MappedFile::Release(std::size_t offset, std::size_t size) {
+  if (!data_ || offset >= size_) return;
+
+  // madvise needs page aligned ranges, only whole pages are released
+  const std::size_t page = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+  std::size_t begin = (offset + page - 1) / page * page;
+  std::size_t end = (offset + size > size_) ? size_ : offset + size;
+  end = end / page * page;
+  if (end > begin)
+    ::madvise(const_cast<unsigned char *>(data_) + begin, end - begin,
+              MADV_DONTNEED);
+}
+
+#endif
+
+}  // namespace batch
+
+}  // namespace visco
+
+}  // namespace spauly
@@ -0,0 +1,340 @@
+// Visco Correct Desktop - Correction factors for centrifugal pumps
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Visco-Correct-Desktop>
+#include "spauly/visco/batch/parametric_study.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstdio>
+
+#include "spauly/visco/batch/binary_format.h"
+
+namespace spauly {
+namespace visco {
+namespace batch {
+
+namespace {
+
+/// @brief Appends value in the shortest form that reads back exactly.
+void AppendNumber(std::vector<char> &line, double value) {
+  char buffer[32];
+  auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+  line.insert(line.end(), buffer, result.ptr);
+}
+
+}  // namespace
+
+ParameterAxis ParameterAxis::Fixed(double value) {
+  ParameterAxis axis;
+  axis.values.push_back(value);
+  return axis;
+}
+
+ParameterAxis ParameterAxis::Linear(double first, double last,
+                                    std::size_t steps) {
+  ParameterAxis axis;
+  if (steps == 1) axis.values.push_back(first);
+  if (steps < 2) return axis;
+
+  axis.values.resize(steps);
+  for (std::size_t i = 0; i < steps; i++)
+    axis.values[i] = first + (last - first) * static_cast<double>(i) /
+                                 static_cast<double>(steps - 1);
+  axis.values.back() = last;
+  return axis;
+}
+
+ParameterAxis ParameterAxis::Log(double first, double last,
+                                 std::size_t steps) {
+  if (!(first > 0.0 && last > 0.0)) return {};
+
+  ParameterAxis axis = Linear(std::log10(first), std::log10(last), steps);
+  for (double &value : axis.values) value = std::pow(10.0, value);
+  if (!axis.values.empty()) {
+    axis.values.front() = first;
+    if (steps > 1) axis.values.back() = last;
+  }
+  return axis;
+}
+
+std::uint64_t StudyDefinition::rows() const {
+  std::uint64_t rows = 1;
+  for (const ParameterAxis &axis : axes) {
+    if (axis.size() == 0) return 0;
+    // Saturates instead of overflowing, ParametricStudy rejects it anyway
+    if (rows > UINT64_MAX / axis.size()) return UINT64_MAX;
+    rows *= axis.size();
+  }
+  return rows;
+}
+
+vccore::Parameters StudyDefinition::PointAt(std::uint64_t row) const {
+  std::array<double, kStudyFieldCount> values;
+  for (std::size_t i = kStudyFieldCount; i-- > 0;) {
+    const std::uint64_t size = axes[i].size();
+    values[i] = axes[i].values[row % size];
+    row /= size;
+  }
+
+  vccore::Parameters params;
+  params.flowrate = values[kStudyFlowrate];
+  params.total_head = values[kStudyTotalHead];
+  params.viscosity = values[kStudyViscosity];
+  params.density = values[kStudyDensity];
+  return params;
+}
+
+ParametricStudy::ParametricStudy(StudyDefinition definition, ThreadPool &pool)
+    : definition_(std::move(definition)), pool_(pool) {
+  rows_ = definition_.rows();
+  if (rows_ > kMaxRows) rows_ = 0;
+  blocks_ = static_cast<std::size_t>((rows_ + kBlockRows - 1) / kBlockRows);
+
+  results_.resize(static_cast<std::size_t>(rows_));
+  block_done_ = std::make_unique<std::atomic<bool>[]>(blocks_);
+  claimed_.assign(blocks_, false);
+}
+
+bool ParametricStudy::Start() {
+  if (rows_ == 0) return false;
+
+  // On a shared pool one worker stays free for the other jobs
+  const std::size_t loops = std::max<std::size_t>(pool_.size() - 1, 1);
+  for (std::size_t i = 0; i < loops; i++)
+    pool_.Submit(
+        [self = shared_from_this()](std::size_t) { self->BlockLoop(); });
+  return true;
+}
+
+void ParametricStudy::Request(std::uint64_t first, std::uint64_t last) {
+  last = std::min(last, rows_);
+  std::lock_guard<std::mutex> lock(mutex_);
+  requested_.clear();
+  if (first >= last) return;
+
+  const std::size_t end = static_cast<std::size_t>((last - 1) / kBlockRows);
+  for (auto block = static_cast<std::size_t>(first / kBlockRows); block <= end;
+       block++)
+    if (!claimed_[block]) requested_.push_back(block);
+}
+
+void ParametricStudy::Cancel() {
+  cancel_.store(true, std::memory_order_relaxed);
+}
+
+bool ParametricStudy::Get(std::uint64_t row, vccore::Parameters &params,
+                          vccore::CorrectionFactors &factors) const {
+  if (row >= rows_) return false;
+  params = definition_.PointAt(row);
+  if (!block_done_[row / kBlockRows].load(std::memory_order_acquire))
+    return false;
+
+  const auto index = static_cast<std::size_t>(row);
+  factors.eta = results_.eta[index];
+  factors.q = results_.q[index];
+  for (std::size_t i = 0; i < factors.h.size(); i++)
+    factors.h.at(i) = results_.h[i][index];
+  factors.error_flag = static_cast<decltype(factors.error_flag)>(
+      results_.error_flag[index]);
+  return true;
+}
+
+bool ParametricStudy::ClaimBlock(std::size_t &block) {
+  if (cancelled()) return false;
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  while (!requested_.empty()) {
+    block = requested_.front();
+    requested_.pop_front();
+    if (!claimed_[block]) {
+      claimed_[block] = true;
+      computing_++;
+      return true;
+    }
+  }
+  while (next_block_ < blocks_) {
+    block = next_block_++;
+    if (!claimed_[block]) {
+      claimed_[block] = true;
+      computing_++;
+      return true;
+    }
+  }
+  return false;
+}
+
+void ParametricStudy::BlockLoop() {
+  SoaCalculator calculator;
+  std::array<std::vector<double>, 4> columns;
+  for (auto &column : columns) column.resize(kBlockRows);
+
+  std::size_t block;
+  for (std::size_t i = 0; i < kBlocksPerTask; i++) {
+    if (!ClaimBlock(block)) return;
+    ComputeBlock(block, calculator, columns);
+  }
+
+  // Holding the worker until the study is done would stall every other job
+  // of a shared pool, so the loop continues behind them
+  pool_.Defer(
+      [self = shared_from_this()](std::size_t) { self->BlockLoop(); });
+}
+
+void ParametricStudy::ComputeBlock(
+    std::size_t block, SoaCalculator &calculator,
+    std::array<std::vector<double>, 4> &columns) {
+  const std::uint64_t first = std::uint64_t{block} * kBlockRows;
+  const auto count =
+      static_cast<std::size_t>(std::min<std::uint64_t>(kBlockRows,
+                                                       rows_ - first));
+
+  // Counts through the axes like an odometer instead of dividing per row
+  std::array<std::size_t, kStudyFieldCount> digits;
+  std::uint64_t rest = first;
+  for (std::size_t i = kStudyFieldCount; i-- > 0;) {
+    digits[i] = static_cast<std::size_t>(rest % definition_.axes[i].size());
+    rest /= definition_.axes[i].size();
+  }
+  for (std::size_t row = 0; row < count; row++) {
+    for (std::size_t i = 0; i < kStudyFieldCount; i++)
+      columns[i][row] = definition_.axes[i].values[digits[i]];
+    for (std::size_t i = kStudyFieldCount; i-- > 0;) {
+      if (++digits[i] < definition_.axes[i].size()) break;
+      digits[i] = 0;
+    }
+  }
+
+  SoaInput in;
+  in.flowrate = std::span<const double>(columns[kStudyFlowrate]).first(count);
+  in.total_head =
+      std::span<const double>(columns[kStudyTotalHead]).first(count);
+  in.viscosity =
+      std::span<const double>(columns[kStudyViscosity]).first(count);
+  in.density = std::span<const double>(columns[kStudyDensity]).first(count);
+  calculator.Calculate(in, definition_.units,
+                       results_.view().subspan(
+                           static_cast<std::size_t>(first), count));
+
+  block_done_[block].store(true, std::memory_order_release);
+  rows_done_.fetch_add(count, std::memory_order_relaxed);
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (--computing_ == 0) computed_.notify_all();
+}
+
+bool ParametricStudy::Finish() {
+  {
+    SoaCalculator calculator;
+    std::array<std::vector<double>, 4> columns;
+    for (auto &column : columns) column.resize(kBlockRows);
+
+    std::size_t block;
+    while (ClaimBlock(block)) ComputeBlock(block, calculator, columns);
+  }
+
+  // Every claimed block is being computed by a running thread, queued loops
+  // that have not started yet find nothing left to claim
+  std::unique_lock<std::mutex> lock(mutex_);
+  computed_.wait(lock, [this] { return computing_ == 0; });
+  return !cancelled() && done();
+}
+
+bool ParametricStudy::ExportCsv(const std::string &path, char delimiter) {
+  if (!Finish()) return false;
+
+  std::FILE *file = std::fopen(path.c_str(), "w");
+  if (!file) return false;
+
+  std::fprintf(file,
+               "flowrate%ctotal_head%cviscosity%cdensity%ceta%cq%ch_0.6%ch_0.8%c"
+               "h_1.0%ch_1.2%cerror_flag\n",
+               delimiter, delimiter, delimiter, delimiter, delimiter,
+               delimiter, delimiter, delimiter, delimiter, delimiter);
+
+  std::vector<char> line;
+  line.reserve(512);
+  bool ok = true;
+  for (std::uint64_t row = 0; ok && row < rows_; row++) {
+    vccore::Parameters params;
+    vccore::CorrectionFactors factors;
+    Get(row, params, factors);
+
+    line.clear();
+    for (double value :
+         {params.flowrate, params.total_head, params.viscosity, params.density,
+          factors.eta, factors.q, factors.h.at(0), factors.h.at(1),
+          factors.h.at(2), factors.h.at(3)}) {
+      AppendNumber(line, value);
+      line.push_back(delimiter);
+    }
+    char flag[16];
+    auto result = std::to_chars(flag, flag + sizeof(flag),
+                                static_cast<int>(factors.error_flag));
+    line.insert(line.end(), flag, result.ptr);
+    line.push_back('\n');
+    ok = std::fwrite(line.data(), 1, line.size(), file) == line.size();
+  }
+  return (std::fclose(file) == 0) && ok;
+}
+
+bool ParametricStudy::ExportDataset(const std::string &inputs_path,
+                                    const std::string &results_path) {
+  if (!Finish()) return false;
+
+  DatasetWriter inputs;
+  DatasetWriter results;
+  if (!inputs.Open(inputs_path, DatasetKind::kInputs) ||
+      !results.Open(results_path, DatasetKind::kResults))
+    return false;
+
+  std::array<std::vector<double>, 4> columns;
+  for (auto &column : columns) column.resize(kBlockRows);
+
+  bool ok = true;
+  for (std::uint64_t first = 0; ok && first < rows_; first += kBlockRows) {
+    const auto count = static_cast<std::size_t>(
+        std::min<std::uint64_t>(kBlockRows, rows_ - first));
+    for (std::size_t row = 0; row < count; row++) {
+      const vccore::Parameters params = definition_.PointAt(first + row);
+      columns[kStudyFlowrate][row] = params.flowrate;
+      columns[kStudyTotalHead][row] = params.total_head;
+      columns[kStudyViscosity][row] = params.viscosity;
+      columns[kStudyDensity][row] = params.density;
+    }
+
+    SoaInput in;
+    in.flowrate = std::span<const double>(columns[kStudyFlowrate]).first(count);
+    in.total_head =
+        std::span<const double>(columns[kStudyTotalHead]).first(count);
+    in.viscosity =
+        std::span<const double>(columns[kStudyViscosity]).first(count);
+    in.density = std::span<const double>(columns[kStudyDensity]).first(count);
+    ok = inputs.Append(in, definition_.units) &&
+         results.Append(results_.view().subspan(
+             static_cast<std::size_t>(first), count));
+  }
+
+  ok = inputs.Close() && ok;
+  return results.Close() && ok;
+}
+
+}  // namespace batch
+
+}  // namespace visco
+
+}  // namespace spauly
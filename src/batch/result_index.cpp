@@ -0,0 +1,145 @@
+// Visco Correct Desktop - Correction factors for centrifugal pumps
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Visco-Correct-Desktop>
+#include "spauly/visco/batch/result_index.h"
+
+#include <algorithm>
+#include <cmath>
+#include <type_traits>
+
+namespace spauly {
+namespace visco {
+namespace batch {
+
+namespace {
+
+template <typename T>
+struct Entry {
+  T key;
+  std::uint32_t row;
+};
+
+template <typename T>
+struct EntryLess {
+  bool descending;
+
+  bool operator()(const Entry<T> &a, const Entry<T> &b) const {
+    if (a.key != b.key) return descending ? b.key < a.key : a.key < b.key;
+    return a.row < b.row;
+  }
+};
+
+/// @brief Sorts one run per worker and merges the runs pairwise, ping-ponging
+/// between entries and a buffer of the same size.
+template <typename T>
+void ParallelSort(std::vector<Entry<T>> &entries, const EntryLess<T> &less,
+                  ThreadPool *pool) {
+  const std::size_t count = entries.size();
+  if (!pool || pool->size() < 2 || count <= kParallelSortThreshold) {
+    std::sort(entries.begin(), entries.end(), less);
+    return;
+  }
+
+  const std::size_t run = (count + pool->size() - 1) / pool->size();
+  pool->ParallelFor(count, run,
+                    [&](std::size_t begin, std::size_t end, std::size_t) {
+                      std::sort(entries.begin() + begin,
+                                entries.begin() + end, less);
+                    });
+
+  std::vector<Entry<T>> buffer(count);
+  for (std::size_t width = run; width < count; width *= 2) {
+    const std::size_t pairs = (count + 2 * width - 1) / (2 * width);
+    pool->ParallelFor(pairs, 1,
+                      [&](std::size_t begin, std::size_t end, std::size_t) {
+                        for (std::size_t pair = begin; pair < end; pair++) {
+                          const std::size_t first = pair * 2 * width;
+                          const std::size_t middle =
+                              std::min(first + width, count);
+                          const std::size_t last =
+                              std::min(first + 2 * width, count);
+                          std::merge(entries.begin() + first,
+                                     entries.begin() + middle,
+                                     entries.begin() + middle,
+                                     entries.begin() + last,
+                                     buffer.begin() + first, less);
+                        }
+                      });
+    entries.swap(buffer);
+  }
+}
+
+template <typename T>
+void SortRowsImpl(std::span<std::uint32_t> rows, std::span<const T> key,
+                  bool descending, ThreadPool *pool) {
+  std::vector<Entry<T>> entries;
+  entries.reserve(rows.size());
+  std::vector<std::uint32_t> nan_rows;
+  for (std::uint32_t row : rows) {
+    const T value = key[row];
+    if constexpr (std::is_floating_point_v<T>) {
+      if (std::isnan(value)) {
+        nan_rows.push_back(row);
+        continue;
+      }
+    }
+    entries.push_back({value, row});
+  }
+
+  ParallelSort(entries, EntryLess<T>{descending}, pool);
+  std::sort(nan_rows.begin(), nan_rows.end());
+
+  std::size_t i = 0;
+  for (const auto &entry : entries) rows[i++] = entry.row;
+  for (std::uint32_t row : nan_rows) rows[i++] = row;
+}
+
+}  // namespace
+
+std::vector<std::uint32_t> FilterRows(std::span<const std::int32_t> flags,
+                                      const FlagFilter &filter) {
+  // Counted first so that the index is allocated exactly once
+  std::size_t count = flags.size();
+  if (filter.mode != FlagFilter::kAll)
+    count = static_cast<std::size_t>(
+        std::count_if(flags.begin(), flags.end(),
+                      [&](std::int32_t flag) { return filter.Accepts(flag); }));
+
+  std::vector<std::uint32_t> rows;
+  rows.reserve(count);
+  for (std::size_t row = 0; row < flags.size(); row++)
+    if (filter.Accepts(flags[row]))
+      rows.push_back(static_cast<std::uint32_t>(row));
+  return rows;
+}
+
+void SortRows(std::span<std::uint32_t> rows, std::span<const double> key,
+              bool descending, ThreadPool *pool) {
+  SortRowsImpl(rows, key, descending, pool);
+}
+
+void SortRows(std::span<std::uint32_t> rows,
+              std::span<const std::int32_t> key, bool descending,
+              ThreadPool *pool) {
+  SortRowsImpl(rows, key, descending, pool);
+}
+
+}  // namespace batch
+
+}  // namespace visco
+
+}  // namespace spauly
@@ -0,0 +1,235 @@
+// Visco Correct Desktop - Correction factors for centrifugal pumps
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Visco-Correct-Desktop>
+#include "spauly/visco/batch/reverse_solver.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace spauly {
+namespace visco {
+namespace batch {
+
+namespace {
+
+constexpr double kNaN = std::numeric_limits<double>::quiet_NaN();
+
+// ITP parameters, see Oliveira and Takahashi (2020)
+constexpr double kItpK1 = 0.2;
+constexpr double kItpK2 = 2.0;
+constexpr int kItpN0 = 1;
+
+double &Field(vccore::Parameters &params, StudyField field) {
+  switch (field) {
+    case kStudyFlowrate:
+      return params.flowrate;
+    case kStudyTotalHead:
+      return params.total_head;
+    case kStudyDensity:
+      return params.density;
+    default:
+      return params.viscosity;
+  }
+}
+
+}  // namespace
+
+double FactorValue(const vccore::CorrectionFactors &factors,
+                   FactorField field) {
+  switch (field) {
+    case kFactorQ:
+      return factors.q;
+    case kFactorH06:
+    case kFactorH08:
+    case kFactorH10:
+    case kFactorH12:
+      return factors.h.at(static_cast<std::size_t>(field - kFactorH06));
+    default:
+      return factors.eta;
+  }
+}
+
+ReverseSolver::ReverseSolver(std::size_t samples, double tolerance)
+    : samples_(std::max<std::size_t>(samples, 2)),
+      tolerance_(tolerance > 0.0 ? tolerance : kDefaultTolerance) {
+  for (auto &column : columns_) column.resize(samples_);
+  residuals_.resize(samples_);
+  results_.resize(samples_);
+}
+
+vccore::CorrectionFactors ReverseSolver::Evaluate(const SolverQuery &query,
+                                                  double x) {
+  vccore::Parameters params = query.params;
+  Field(params, query.variable) = x;
+  evaluations_++;
+  return calculator_.Calculate(params, query.units);
+}
+
+SolverResult ReverseSolver::Solve(const SolverQuery &query) {
+  SolverResult result;
+  result.value = kNaN;
+  evaluations_ = 0;
+  if (!(query.lower < query.upper) || !std::isfinite(query.lower) ||
+      !std::isfinite(query.upper) || !std::isfinite(query.target) ||
+      query.variable >= kStudyFieldCount || query.factor < kFactorEta ||
+      query.factor >= kFactorFieldCount)
+    return result;
+
+  // Bracketing: one batch over the interval
+  vccore::Parameters fixed = query.params;
+  for (std::size_t field = 0; field < kStudyFieldCount; field++)
+    std::fill(columns_[field].begin(), columns_[field].end(),
+              Field(fixed, static_cast<StudyField>(field)));
+
+  std::vector<double> &x = columns_[query.variable];
+  const bool log = query.lower > 0.0 && query.upper > 10.0 * query.lower;
+  const double step = 1.0 / static_cast<double>(samples_ - 1);
+  for (std::size_t i = 0; i < samples_; i++) {
+    const double t = static_cast<double>(i) * step;
+    x[i] = log ? query.lower * std::pow(query.upper / query.lower, t)
+               : query.lower + (query.upper - query.lower) * t;
+  }
+  x.back() = query.upper;
+
+  soa_.Calculate({columns_[kStudyFlowrate], columns_[kStudyTotalHead],
+                  columns_[kStudyViscosity], columns_[kStudyDensity]},
+                 query.units, results_.view());
+  evaluations_ += samples_;
+
+  const auto residual = [&](const vccore::CorrectionFactors &factors) {
+    return FactorValue(factors, query.factor) - query.target;
+  };
+  std::vector<double> &d = residuals_;
+  bool any_valid = false;
+  for (std::size_t i = 0; i < samples_; i++) {
+    vccore::CorrectionFactors factors;
+    factors.eta = results_.eta[i];
+    factors.q = results_.q[i];
+    for (std::size_t j = 0; j < factors.h.size(); j++)
+      factors.h.at(j) = results_.h[j][i];
+    d[i] = residual(factors);
+    any_valid |= results_.error_flag[i] == 0;
+  }
+
+  if (!any_valid) {
+    result.status = SolverResult::kOutOfRange;
+    result.evaluations = evaluations_;
+    return result;
+  }
+
+  // The first sign change between valid neighbours, seen from the requested
+  // end of the interval
+  std::size_t found = samples_;
+  for (std::size_t k = 0; k + 1 < samples_; k++) {
+    const std::size_t i = query.highest ? samples_ - 2 - k : k;
+    if (results_.error_flag[i] != 0 || results_.error_flag[i + 1] != 0)
+      continue;
+    if (d[i] * d[i + 1] <= 0.0) {
+      found = i;
+      break;
+    }
+  }
+  if (found == samples_) {
+    result.status = SolverResult::kNoCrossing;
+    result.evaluations = evaluations_;
+    return result;
+  }
+
+  double a = x[found];
+  double b = x[found + 1];
+  double root = kNaN;
+  if (d[found + 1] == 0.0 && (query.highest || d[found] != 0.0))
+    root = b;
+  else if (d[found] == 0.0)
+    root = a;
+
+  if (std::isnan(root)) {
+    // ITP on the bracket, oriented so that the residual rises from a to b
+    const double sign = d[found] < 0.0 ? 1.0 : -1.0;
+    double ya = sign * d[found];
+    double yb = sign * d[found + 1];
+    const double epsilon =
+        std::max(tolerance_ * (query.upper - query.lower), 1e-300) * 0.5;
+    const double k1 = kItpK1 / (b - a);
+    const int n_half =
+        static_cast<int>(std::ceil(std::log2((b - a) / (2.0 * epsilon))));
+    const int n_max = std::max(n_half, 0) + kItpN0;
+
+    for (int j = 0; b - a > 2.0 * epsilon && j <= n_max; j++) {
+      const double half = 0.5 * (a + b);
+      const double r = epsilon * std::ldexp(1.0, n_max - j) - 0.5 * (b - a);
+      const double delta = k1 * std::pow(b - a, kItpK2);
+
+      // Truncated regula falsi, projected onto the bisection neighbourhood
+      const double falsi = (yb * a - ya * b) / (yb - ya);
+      const double direction = (half - falsi) >= 0.0 ? 1.0 : -1.0;
+      const double truncated = (delta <= std::abs(half - falsi))
+                                   ? falsi + direction * delta
+                                   : half;
+      const double next = (std::abs(truncated - half) <= r)
+                              ? truncated
+                              : half - direction * r;
+
+      const vccore::CorrectionFactors factors = Evaluate(query, next);
+      // The chart range is a box, so a bracket between two valid samples
+      // only contains valid points
+      if (factors.error_flag != 0) {
+        result.status = SolverResult::kOutOfRange;
+        result.evaluations = evaluations_;
+        return result;
+      }
+      const double y = sign * residual(factors);
+      if (y > 0.0) {
+        b = next;
+        yb = y;
+      } else if (y < 0.0) {
+        a = next;
+        ya = y;
+      } else {
+        a = b = next;
+      }
+    }
+    root = 0.5 * (a + b);
+  }
+
+  result.status = SolverResult::kSolved;
+  result.value = root;
+  result.factors = Evaluate(query, root);
+  result.evaluations = evaluations_;
+  return result;
+}
+
+bool SolveAll(std::span<const SolverQuery> queries,
+              std::span<SolverResult> results, ThreadPool &pool) {
+  if (results.size() < queries.size()) return false;
+
+  std::vector<ReverseSolver> solvers(pool.size());
+  pool.ParallelFor(queries.size(), 64,
+                   [&](std::size_t begin, std::size_t end,
+                       std::size_t worker) {
+                     for (std::size_t i = begin; i < end; i++)
+                       results[i] = solvers[worker].Solve(queries[i]);
+                   });
+  return true;
+}
+
+}  // namespace batch
+
+}  // namespace visco
+
+}  // namespace spauly
@@ -0,0 +1,287 @@
+// Visco Correct Desktop - Correction factors for centrifugal pumps
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Visco-Correct-Desktop>
+#include "spauly/visco/batch/row_io.h"
+
+#include <array>
+#include <charconv>
+#include <cstring>
+
+namespace spauly {
+namespace visco {
+namespace batch {
+
+namespace {
+
+constexpr std::size_t kBufferSize = 1 << 20;
+constexpr std::size_t kMaxColumns = 8;
+
+std::string_view Trim(std::string_view text) {
+  while (!text.empty() && (text.front() == ' ' || text.front() == '"'))
+    text.remove_prefix(1);
+  while (!text.empty() && (text.back() == ' ' || text.back() == '"' ||
+                           text.back() == '\r'))
+    text.remove_suffix(1);
+  return text;
+}
+
+bool EqualsNoCase(std::string_view lhs, std::string_view rhs) {
+  if (lhs.size() != rhs.size()) return false;
+  for (std::size_t i = 0; i < lhs.size(); i++) {
+    char l = lhs[i], r = rhs[i];
+    if (l >= 'A' && l <= 'Z') l += 'a' - 'A';
+    if (r >= 'A' && r <= 'Z') r += 'a' - 'A';
+    if (l != r) return false;
+  }
+  return true;
+}
+
+/// @brief Looks the token up in names and falls back to the numeric combo
+/// index as it is used by the calculator view.
+template <typename Enum, std::size_t N>
+bool ParseUnit(std::string_view token,
+               const std::array<std::string_view, N> &names, int count,
+               Enum &unit) {
+  token = Trim(token);
+  for (std::size_t i = 0; i < names.size(); i++) {
+    // Several spellings map onto the same index, separated by '|'.
+    std::string_view alternatives = names[i];
+    while (!alternatives.empty()) {
+      std::size_t split = alternatives.find('|');
+      if (EqualsNoCase(token, alternatives.substr(0, split))) {
+        unit = static_cast<Enum>(i);
+        return true;
+      }
+      if (split == std::string_view::npos) break;
+      alternatives.remove_prefix(split + 1);
+    }
+  }
+
+  int index = -1;
+  auto [ptr, ec] = std::from_chars(token.data(), token.data() + token.size(),
+                                   index);
+  if (ec != std::errc() || ptr != token.data() + token.size() || index < 0 ||
+      index >= count)
+    return false;
+  unit = static_cast<Enum>(index);
+  return true;
+}
+
+bool ParseDouble(std::string_view token, double &value) {
+  token = Trim(token);
+  if (token.empty()) return false;
+  auto [ptr, ec] =
+      std::from_chars(token.data(), token.data() + token.size(), value);
+  return ec == std::errc() && ptr == token.data() + token.size();
+}
+
+/// @brief Returns true if no field of line is a number. A data row with a
+/// single malformed field is not a header and must fail the read instead of
+/// shifting all following rows.
+bool IsHeader(std::string_view line, char delimiter) {
+  while (true) {
+    const std::size_t split = line.find(delimiter);
+    double value = 0.0;
+    if (ParseDouble(line.substr(0, split), value)) return false;
+    if (split == std::string_view::npos) return true;
+    line.remove_prefix(split + 1);
+  }
+}
+
+}  // namespace
+
+bool ParseFlowrateUnit(std::string_view token, vccore::FlowrateUnit &unit) {
+  static constexpr std::array<std::string_view, 3> kNames = {
+      "m^3/h|m3/h|m\xC2\xB3/h", "l/min", "gpm"};
+  return ParseUnit(token, kNames, 3, unit);
+}
+
+bool ParseTotalHeadUnit(std::string_view token, vccore::TotalHeadUnit &unit) {
+  static constexpr std::array<std::string_view, 2> kNames = {"m", "ft"};
+  return ParseUnit(token, kNames, 2, unit);
+}
+
+bool ParseViscosityUnit(std::string_view token, vccore::ViscosityUnit &unit) {
+  static constexpr std::array<std::string_view, 4> kNames = {
+      "mm^2/s|mm2/s|mm\xC2\xB2/s", "cst", "cp", "mpas|mpa*s"};
+  return ParseUnit(token, kNames, 4, unit);
+}
+
+bool ParseDensityUnit(std::string_view token, vccore::DensityUnit &unit) {
+  static constexpr std::array<std::string_view, 2> kNames = {
+      "g/l", "kg/m^3|kg/m3|kg/m\xC2\xB3"};
+  return ParseUnit(token, kNames, 2, unit);
+}
+
+RowReader::RowReader(std::FILE *file, const vccore::Units &default_units)
+    : file_(file), default_units_(default_units), buffer_(kBufferSize) {}
+
+std::size_t RowReader::Read(std::vector<OperatingPoint> &out,
+                            std::size_t max_rows) {
+  std::size_t read = 0;
+  while (read < max_rows && !failed_) {
+    const char *data = buffer_.data() + begin_;
+    const void *newline = std::memchr(data, '\n', end_ - begin_);
+
+    if (!newline) {
+      if (eof_) {
+        if (begin_ == end_) break;
+        newline = buffer_.data() + end_;  // Last line without terminator
+      } else {
+        if (!Refill() && begin_ == end_) break;
+        continue;
+      }
+    }
+
+    std::size_t length = static_cast<const char *>(newline) - data;
+    std::string_view line(data, length);
+    begin_ = (begin_ + length + 1 > end_) ? end_ : begin_ + length + 1;
+    line_++;
+
+    line = Trim(line);
+    if (line.empty() || line.front() == '#') continue;
+
+    if (delimiter_ == '\0') {
+      // The first line decides on the delimiter and whether there is a header
+      delimiter_ = ',';
+      if (line.find('\t') != std::string_view::npos)
+        delimiter_ = '\t';
+      else if (line.find(';') != std::string_view::npos)
+        delimiter_ = ';';
+
+      if (IsHeader(line, delimiter_)) continue;
+    }
+
+    OperatingPoint point;
+    if (!ParseLine(line, point)) {
+      failed_ = true;
+      break;
+    }
+    out.push_back(point);
+    read++;
+  }
+  return read;
+}
+
+bool RowReader::Refill() {
+  if (eof_) return false;
+  if (begin_ == 0 && end_ == buffer_.size()) {
+    failed_ = true;  // A single line does not fit into the buffer
+    return false;
+  }
+
+  std::memmove(buffer_.data(), buffer_.data() + begin_, end_ - begin_);
+  end_ -= begin_;
+  begin_ = 0;
+
+  std::size_t count =
+      std::fread(buffer_.data() + end_, 1, buffer_.size() - end_, file_);
+  end_ += count;
+  if (count == 0) eof_ = true;
+  return count != 0;
+}
+
+bool RowReader::ParseLine(std::string_view line, OperatingPoint &point) {
+  std::array<std::string_view, kMaxColumns> columns;
+  std::size_t count = 0;
+  while (count < kMaxColumns) {
+    std::size_t split = line.find(delimiter_);
+    columns[count++] = line.substr(0, split);
+    if (split == std::string_view::npos) break;
+    line.remove_prefix(split + 1);
+  }
+
+  // The density is only needed for dynamic viscosities and may be left empty
+  if (count < 3) return false;
+  point.units = default_units_;
+  if (!ParseDouble(columns[0], point.params.flowrate) ||
+      !ParseDouble(columns[1], point.params.total_head) ||
+      !ParseDouble(columns[2], point.params.viscosity))
+    return false;
+  if (count > 3 && !Trim(columns[3]).empty() &&
+      !ParseDouble(columns[3], point.params.density))
+    return false;
+
+  if (count > 4 && !ParseFlowrateUnit(columns[4], point.units.flowrate))
+    return false;
+  if (count > 5 && !ParseTotalHeadUnit(columns[5], point.units.total_head))
+    return false;
+  if (count > 6 && !ParseViscosityUnit(columns[6], point.units.viscosity))
+    return false;
+  if (count > 7 && !ParseDensityUnit(columns[7], point.units.density))
+    return false;
+  return true;
+}
+
+RowWriter::RowWriter(std::FILE *file, char delimiter)
+    : file_(file), delimiter_(delimiter), buffer_(kBufferSize) {}
+
+void RowWriter::WriteHeader() {
+  const char delimiter[2] = {delimiter_, '\0'};
+  Append("eta");
+  for (std::string_view column :
+       {"q", "h_0.6", "h_0.8", "h_1.0", "h_1.2", "error_flag"}) {
+    Append(delimiter);
+    Append(column);
+  }
+  Append("\n");
+}
+
+void RowWriter::Write(const vccore::CorrectionFactors &factors) {
+  // Worst case: 6 doubles with delimiter plus the flag
+  if (buffer_.size() - size_ < 256) Flush();
+
+  AppendDouble(factors.eta);
+  buffer_[size_++] = delimiter_;
+  AppendDouble(factors.q);
+  for (std::size_t i = 0; i < 4; i++) {
+    buffer_[size_++] = delimiter_;
+    AppendDouble(factors.h.at(i));
+  }
+  buffer_[size_++] = delimiter_;
+  auto [ptr, ec] = std::to_chars(buffer_.data() + size_,
+                                 buffer_.data() + buffer_.size(),
+                                 static_cast<int>(factors.error_flag));
+  size_ = ptr - buffer_.data();
+  buffer_[size_++] = '\n';
+}
+
+bool RowWriter::Flush() {
+  if (size_ != 0 && std::fwrite(buffer_.data(), 1, size_, file_) != size_)
+    failed_ = true;
+  size_ = 0;
+  return !failed_;
+}
+
+void RowWriter::Append(std::string_view text) {
+  if (buffer_.size() - size_ < text.size()) Flush();
+  std::memcpy(buffer_.data() + size_, text.data(), text.size());
+  size_ += text.size();
+}
+
+void RowWriter::AppendDouble(double value) {
+  auto [ptr, ec] =
+      std::to_chars(buffer_.data() + size_, buffer_.data() + buffer_.size(),
+                    value, std::chars_format::general, 6);
+  size_ = ptr - buffer_.data();
+}
+
+}  // namespace batch
+
+}  // namespace visco
+
+}  // namespace spauly
@@ -0,0 +1,498 @@
+// Visco Correct Desktop - Correction factors for centrifugal pumps
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Visco-Correct-Desktop>
+#include "spauly/visco/batch/soa_batch.h"
+
+#include <algorithm>
+#include <array>
+
+#include "spauly/visco/batch/unit_conversion.h"
+
+#if defined(__AVX2__)
+#define VCD_SOA_AVX2
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define VCD_SOA_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace spauly {
+namespace visco {
+namespace batch {
+
+namespace {
+
+// Number of points normalised at once, small enough to stay in L1
+constexpr std::size_t kBlockSize = 512;
+
+// Number of mixed-unit points grouped by units at once, their results have
+// to fit into the L2 cache
+constexpr std::size_t kGroupWindow = 1024;
+
+// Shorter runs of equal units are sorted instead of calculated in place
+constexpr std::size_t kMinRunLength = 32;
+
+/// @brief Pointers and factors of one block for the normalisation kernels.
+struct Block {
+  const double *flowrate;
+  const double *total_head;
+  const double *viscosity;
+  const double *density;
+  std::size_t size;
+
+  double *flowrate_out;
+  double *total_head_out;
+  double *viscosity_out;
+  std::int32_t *flags_out;
+};
+
+/// @brief Scalar reference kernel, also handles the tail of the SIMD kernels.
+template <typename Units>
+void NormaliseScalar(const Block &block, std::size_t begin) {
+  for (std::size_t i = begin; i < block.size; i++) {
+    vccore::Parameters params;
+    params.flowrate = block.flowrate[i];
+    params.total_head = block.total_head[i];
+    params.viscosity = block.viscosity[i];
+    if constexpr (Units::kDynamic) params.density = block.density[i];
+
+    vccore::Parameters canonical = Units::Normalise(params);
+    block.flowrate_out[i] = canonical.flowrate;
+    block.total_head_out[i] = canonical.total_head;
+    block.viscosity_out[i] = canonical.viscosity;
+    block.flags_out[i] = CheckRanges(canonical);
+  }
+}
+
+#if defined(VCD_SOA_AVX2)
+
+template <typename Units>
+void NormaliseBlock(const Block &block) {
+  const __m256d q_min = _mm256_set1_pd(kMinFlowrate);
+  const __m256d q_max = _mm256_set1_pd(kMaxFlowrate);
+  const __m256d h_min = _mm256_set1_pd(kMinTotalHead);
+  const __m256d h_max = _mm256_set1_pd(kMaxTotalHead);
+  const __m256d v_min = _mm256_set1_pd(kMinViscosity);
+  const __m256d v_max = _mm256_set1_pd(kMaxViscosity);
+  const __m256d q_flag = _mm256_set1_pd(
+      static_cast<double>(vccore::ErrorFlag::kFlowrateError));
+  const __m256d h_flag = _mm256_set1_pd(
+      static_cast<double>(vccore::ErrorFlag::kTotalHeadError));
+  const __m256d v_flag = _mm256_set1_pd(
+      static_cast<double>(vccore::ErrorFlag::kViscosityError));
+
+  std::size_t i = 0;
+  for (; i + 4 <= block.size; i += 4) {
+    __m256d q = _mm256_loadu_pd(block.flowrate + i);
+    __m256d h = _mm256_loadu_pd(block.total_head + i);
+    __m256d v = _mm256_loadu_pd(block.viscosity + i);
+    if constexpr (Units::kScalesFlowrate)
+      q = _mm256_mul_pd(q, _mm256_set1_pd(Units::kScale.flowrate));
+    if constexpr (Units::kScalesTotalHead)
+      h = _mm256_mul_pd(h, _mm256_set1_pd(Units::kScale.total_head));
+    if constexpr (Units::kScalesViscosity)
+      v = _mm256_mul_pd(v, _mm256_set1_pd(Units::kScale.viscosity));
+    if constexpr (Units::kDynamic) {
+      __m256d rho = _mm256_loadu_pd(block.density + i);
+      if constexpr (Units::kScalesDensity)
+        rho = _mm256_mul_pd(rho, _mm256_set1_pd(Units::kScale.density));
+      v = _mm256_div_pd(v, rho);
+    }
+
+    // Ordered compares are false for NaN, so NaN ends up flagged
+    __m256d q_ok = _mm256_and_pd(_mm256_cmp_pd(q, q_min, _CMP_GE_OQ),
+                                 _mm256_cmp_pd(q, q_max, _CMP_LE_OQ));
+    __m256d h_ok = _mm256_and_pd(_mm256_cmp_pd(h, h_min, _CMP_GE_OQ),
+                                 _mm256_cmp_pd(h, h_max, _CMP_LE_OQ));
+    __m256d v_ok = _mm256_and_pd(_mm256_cmp_pd(v, v_min, _CMP_GE_OQ),
+                                 _mm256_cmp_pd(v, v_max, _CMP_LE_OQ));
+    __m256d flags = _mm256_add_pd(
+        _mm256_add_pd(_mm256_andnot_pd(q_ok, q_flag),
+                      _mm256_andnot_pd(h_ok, h_flag)),
+        _mm256_andnot_pd(v_ok, v_flag));
+
+    _mm256_storeu_pd(block.flowrate_out + i, q);
+    _mm256_storeu_pd(block.total_head_out + i, h);
+    _mm256_storeu_pd(block.viscosity_out + i, v);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(block.flags_out + i),
+                     _mm256_cvtpd_epi32(flags));
+  }
+  NormaliseScalar<Units>(block, i);
+}
+
+#elif defined(VCD_SOA_SSE2)
+
+template <typename Units>
+void NormaliseBlock(const Block &block) {
+  const __m128d q_min = _mm_set1_pd(kMinFlowrate);
+  const __m128d q_max = _mm_set1_pd(kMaxFlowrate);
+  const __m128d h_min = _mm_set1_pd(kMinTotalHead);
+  const __m128d h_max = _mm_set1_pd(kMaxTotalHead);
+  const __m128d v_min = _mm_set1_pd(kMinViscosity);
+  const __m128d v_max = _mm_set1_pd(kMaxViscosity);
+  const __m128d q_flag =
+      _mm_set1_pd(static_cast<double>(vccore::ErrorFlag::kFlowrateError));
+  const __m128d h_flag =
+      _mm_set1_pd(static_cast<double>(vccore::ErrorFlag::kTotalHeadError));
+  const __m128d v_flag =
+      _mm_set1_pd(static_cast<double>(vccore::ErrorFlag::kViscosityError));
+
+  std::size_t i = 0;
+  for (; i + 2 <= block.size; i += 2) {
+    __m128d q = _mm_loadu_pd(block.flowrate + i);
+    __m128d h = _mm_loadu_pd(block.total_head + i);
+    __m128d v = _mm_loadu_pd(block.viscosity + i);
+    if constexpr (Units::kScalesFlowrate)
+      q = _mm_mul_pd(q, _mm_set1_pd(Units::kScale.flowrate));
+    if constexpr (Units::kScalesTotalHead)
+      h = _mm_mul_pd(h, _mm_set1_pd(Units::kScale.total_head));
+    if constexpr (Units::kScalesViscosity)
+      v = _mm_mul_pd(v, _mm_set1_pd(Units::kScale.viscosity));
+    if constexpr (Units::kDynamic) {
+      __m128d rho = _mm_loadu_pd(block.density + i);
+      if constexpr (Units::kScalesDensity)
+        rho = _mm_mul_pd(rho, _mm_set1_pd(Units::kScale.density));
+      v = _mm_div_pd(v, rho);
+    }
+
+    // Ordered compares are false for NaN, so NaN ends up flagged
+    __m128d q_ok = _mm_and_pd(_mm_cmpge_pd(q, q_min), _mm_cmple_pd(q, q_max));
+    __m128d h_ok = _mm_and_pd(_mm_cmpge_pd(h, h_min), _mm_cmple_pd(h, h_max));
+    __m128d v_ok = _mm_and_pd(_mm_cmpge_pd(v, v_min), _mm_cmple_pd(v, v_max));
+    __m128d flags =
+        _mm_add_pd(_mm_add_pd(_mm_andnot_pd(q_ok, q_flag),
+                              _mm_andnot_pd(h_ok, h_flag)),
+                   _mm_andnot_pd(v_ok, v_flag));
+
+    _mm_storeu_pd(block.flowrate_out + i, q);
+    _mm_storeu_pd(block.total_head_out + i, h);
+    _mm_storeu_pd(block.viscosity_out + i, v);
+    _mm_storel_epi64(reinterpret_cast<__m128i *>(block.flags_out + i),
+                     _mm_cvtpd_epi32(flags));
+  }
+  NormaliseScalar<Units>(block, i);
+}
+
+#else
+
+template <typename Units>
+void NormaliseBlock(const Block &block) {
+  NormaliseScalar<Units>(block, 0);
+}
+
+#endif
+
+using NormaliseKernel = void (*)(const Block &block);
+
+/// @brief One kernel per unit combination, selected once per batch.
+struct NormaliseKernels {
+  template <typename Units>
+  static constexpr NormaliseKernel Get() {
+    return &NormaliseBlock<Units>;
+  }
+};
+constexpr auto kNormaliseKernels = MakeUnitTable<NormaliseKernels>();
+
+// Combination index of rows with unknown units, they have no kernel
+constexpr std::size_t kUnknownUnits = kUnitCombinations;
+static_assert(kUnknownUnits <= UINT8_MAX);
+
+/// @brief Reads row of in as it was given, in its own units.
+vccore::Parameters LoadRow(const SoaInput &in, std::size_t row) {
+  vccore::Parameters params;
+  params.flowrate = in.flowrate[row];
+  params.total_head = in.total_head[row];
+  params.viscosity = in.viscosity[row];
+  if (!in.density.empty()) params.density = in.density[row];
+  return params;
+}
+
+void StoreRow(const vccore::CorrectionFactors &factors, const SoaOutput &out,
+              std::size_t row) {
+  out.eta[row] = factors.eta;
+  out.q[row] = factors.q;
+  for (std::size_t j = 0; j < out.h.size(); j++)
+    out.h[j][row] = factors.h.at(j);
+  out.error_flag[row] = static_cast<std::int32_t>(factors.error_flag);
+}
+
+}  // namespace
+
+SoaInput SoaInput::subspan(std::size_t offset, std::size_t count) const {
+  SoaInput result;
+  result.flowrate = flowrate.subspan(offset, count);
+  result.total_head = total_head.subspan(offset, count);
+  result.viscosity = viscosity.subspan(offset, count);
+  if (!density.empty()) result.density = density.subspan(offset, count);
+  return result;
+}
+
+SoaOutput SoaOutput::subspan(std::size_t offset, std::size_t count) const {
+  SoaOutput result;
+  result.eta = eta.subspan(offset, count);
+  result.q = q.subspan(offset, count);
+  for (std::size_t i = 0; i < h.size(); i++)
+    result.h[i] = h[i].subspan(offset, count);
+  result.error_flag = error_flag.subspan(offset, count);
+  return result;
+}
+
+void SoaResults::resize(std::size_t size) {
+  eta.resize(size);
+  q.resize(size);
+  for (auto &column : h) column.resize(size);
+  error_flag.resize(size);
+}
+
+SoaOutput SoaResults::view() {
+  SoaOutput out;
+  out.eta = eta;
+  out.q = q;
+  for (std::size_t i = 0; i < h.size(); i++) out.h[i] = h[i];
+  out.error_flag = error_flag;
+  return out;
+}
+
+const char *SoaKernelName() {
+#if defined(VCD_SOA_AVX2)
+  return "avx2";
+#elif defined(VCD_SOA_SSE2)
+  return "sse2";
+#else
+  return "scalar";
+#endif
+}
+
+void NormaliseColumns(const SoaInput &in, const vccore::Units &units,
+                      std::span<double> flowrate, std::span<double> total_head,
+                      std::span<double> viscosity,
+                      std::span<std::int32_t> flags) {
+  if (!IsValidUnits(units)) {
+    // No kernel exists, the NaN scale flags every row
+    const UnitScale scale = GetUnitScale(units);
+    for (std::size_t row = 0; row < in.size(); row++) {
+      const vccore::Parameters canonical = Normalise(LoadRow(in, row), scale);
+      flowrate[row] = canonical.flowrate;
+      total_head[row] = canonical.total_head;
+      viscosity[row] = canonical.viscosity;
+      flags[row] = CheckRanges(canonical);
+    }
+    return;
+  }
+
+  const NormaliseKernel normalise = kNormaliseKernels[UnitIndex(units)];
+  for (std::size_t offset = 0; offset < in.size(); offset += kBlockSize) {
+    Block block;
+    block.size = std::min(kBlockSize, in.size() - offset);
+    block.flowrate = in.flowrate.data() + offset;
+    block.total_head = in.total_head.data() + offset;
+    block.viscosity = in.viscosity.data() + offset;
+    block.density = in.density.empty() ? nullptr : in.density.data() + offset;
+    block.flowrate_out = flowrate.data() + offset;
+    block.total_head_out = total_head.data() + offset;
+    block.viscosity_out = viscosity.data() + offset;
+    block.flags_out = flags.data() + offset;
+    normalise(block);
+  }
+}
+
+SoaCalculator::SoaCalculator()
+    : flowrate_(kBlockSize),
+      total_head_(kBlockSize),
+      viscosity_(kBlockSize),
+      flags_(kBlockSize) {
+  for (auto &column : gathered_) column.resize(kBlockSize);
+  gathered_results_.resize(kBlockSize);
+  window_.resize(kGroupWindow);
+  identity_.resize(kGroupWindow);
+  for (std::size_t i = 0; i < kGroupWindow; i++)
+    identity_[i] = static_cast<std::uint32_t>(i);
+}
+
+bool SoaCalculator::Calculate(const SoaInput &in, const vccore::Units &units,
+                              const SoaOutput &out) {
+  const std::size_t size = in.size();
+  const UnitScale scale = GetUnitScale(units);
+  if (in.total_head.size() != size || in.viscosity.size() != size ||
+      (scale.dynamic_viscosity && in.density.size() != size) ||
+      (!in.density.empty() && in.density.size() != size))
+    return false;
+  if (out.eta.size() < size || out.q.size() < size ||
+      out.error_flag.size() < size)
+    return false;
+  for (const auto &column : out.h)
+    if (column.size() < size) return false;
+
+  // Unknown units are left to the core as they are
+  if (!IsValidUnits(units)) {
+    for (std::size_t row = 0; row < size; row++)
+      StoreRow(calculator_.Calculate(LoadRow(in, row), units), out, row);
+    return true;
+  }
+
+  constexpr vccore::Units kCanonicalUnits = CanonicalUnits();
+  const NormaliseKernel normalise = kNormaliseKernels[UnitIndex(units)];
+
+  for (std::size_t offset = 0; offset < size; offset += kBlockSize) {
+    Block block;
+    block.size = std::min(kBlockSize, size - offset);
+    block.flowrate = in.flowrate.data() + offset;
+    block.total_head = in.total_head.data() + offset;
+    block.viscosity = in.viscosity.data() + offset;
+    block.density = in.density.empty() ? nullptr : in.density.data() + offset;
+    block.flowrate_out = flowrate_.data();
+    block.total_head_out = total_head_.data();
+    block.viscosity_out = viscosity_.data();
+    block.flags_out = flags_.data();
+    normalise(block);
+
+    // Points inside the chart are handed to the core already normalised.
+    // Points outside are handed over in their own units, so their factors
+    // and error flags are exactly the ones of vccore::Calculator.
+    for (std::size_t i = 0; i < block.size; i++) {
+      const std::size_t row = offset + i;
+      if (flags_[i] != 0) [[unlikely]] {
+        StoreRow(calculator_.Calculate(LoadRow(in, row), units), out, row);
+        continue;
+      }
+
+      vccore::Parameters params;
+      params.flowrate = flowrate_[i];
+      params.total_head = total_head_[i];
+      params.viscosity = viscosity_[i];
+      params.density = block.density ? block.density[i] * scale.density : 0.0;
+      StoreRow(calculator_.Calculate(params, kCanonicalUnits), out, row);
+    }
+  }
+  return true;
+}
+
+bool SoaCalculator::Calculate(std::span<const OperatingPoint> points,
+                              std::span<vccore::CorrectionFactors> out) {
+  if (out.size() < points.size()) return false;
+
+  // Grouped per window, so that gathering and scattering stay in the cache
+  for (std::size_t offset = 0; offset < points.size();
+       offset += kGroupWindow) {
+    const std::size_t size = std::min(kGroupWindow, points.size() - offset);
+    CalculateWindow(points.subspan(offset, size), out.subspan(offset, size));
+  }
+  return true;
+}
+
+void SoaCalculator::CalculateWindow(std::span<const OperatingPoint> points,
+                                    std::span<vccore::CorrectionFactors> out) {
+  std::array<std::size_t, kUnknownUnits + 2> offsets{};
+  std::size_t runs = 0;
+  combinations_.resize(points.size());
+  for (std::size_t row = 0; row < points.size(); row++) {
+    const vccore::Units &units = points[row].units;
+    const std::size_t combination =
+        IsValidUnits(units) ? UnitIndex(units) : kUnknownUnits;
+    combinations_[row] = static_cast<std::uint8_t>(combination);
+    offsets[combination + 1]++;
+    if (row == 0 || combinations_[row - 1] != combination) runs++;
+  }
+
+  // Files collected from a few sources hold long runs of the same units,
+  // these are calculated in place
+  if (runs * kMinRunLength <= points.size()) {
+    for (std::size_t begin = 0; begin < points.size();) {
+      std::size_t end = begin + 1;
+      while (end < points.size() && combinations_[end] == combinations_[begin])
+        end++;
+      const auto rows = std::span(identity_).subspan(begin, end - begin);
+      if (combinations_[begin] == kUnknownUnits)
+        CalculateUnknownUnits(points, rows, out);
+      else
+        CalculateGroup(points, rows, UnitsAt(combinations_[begin]), out);
+      begin = end;
+    }
+    return;
+  }
+
+  // Otherwise the rows are sorted by unit combination (counting sort)
+  for (std::size_t i = 1; i < offsets.size(); i++)
+    offsets[i] += offsets[i - 1];
+  order_.resize(points.size());
+  std::array<std::size_t, kUnknownUnits + 1> cursor;
+  std::copy(offsets.begin(), offsets.end() - 1, cursor.begin());
+  for (std::size_t row = 0; row < points.size(); row++)
+    order_[cursor[combinations_[row]]++] = static_cast<std::uint32_t>(row);
+
+  for (std::size_t combination = 0; combination <= kUnknownUnits;
+       combination++) {
+    const std::size_t begin = offsets[combination];
+    const std::size_t end = offsets[combination + 1];
+    if (begin == end) continue;
+    const auto rows = std::span(order_).subspan(begin, end - begin);
+    if (combination == kUnknownUnits)
+      CalculateUnknownUnits(points, rows, window_);
+    else
+      CalculateGroup(points, rows, UnitsAt(combination), window_);
+  }
+
+  // Scattered within the cache first, out is written sequentially
+  std::copy(window_.begin(), window_.begin() + points.size(), out.begin());
+}
+
+void SoaCalculator::CalculateUnknownUnits(
+    std::span<const OperatingPoint> points,
+    std::span<const std::uint32_t> rows,
+    std::span<vccore::CorrectionFactors> out) {
+  for (std::uint32_t row : rows)
+    out[row] = calculator_.Calculate(points[row].params, points[row].units);
+}
+
+void SoaCalculator::CalculateGroup(std::span<const OperatingPoint> points,
+                                   std::span<const std::uint32_t> rows,
+                                   const vccore::Units &units,
+                                   std::span<vccore::CorrectionFactors> out) {
+  for (std::size_t begin = 0; begin < rows.size(); begin += kBlockSize) {
+    const std::size_t size = std::min(kBlockSize, rows.size() - begin);
+    for (std::size_t i = 0; i < size; i++) {
+      const vccore::Parameters &params = points[rows[begin + i]].params;
+      gathered_[0][i] = params.flowrate;
+      gathered_[1][i] = params.total_head;
+      gathered_[2][i] = params.viscosity;
+      gathered_[3][i] = params.density;
+    }
+
+    const SoaInput in = {std::span<const double>(gathered_[0]).first(size),
+                         std::span<const double>(gathered_[1]).first(size),
+                         std::span<const double>(gathered_[2]).first(size),
+                         std::span<const double>(gathered_[3]).first(size)};
+    Calculate(in, units, gathered_results_.view().subspan(0, size));
+
+    for (std::size_t i = 0; i < size; i++) {
+      vccore::CorrectionFactors &factors = out[rows[begin + i]];
+      factors.eta = gathered_results_.eta[i];
+      factors.q = gathered_results_.q[i];
+      for (std::size_t j = 0; j < factors.h.size(); j++)
+        factors.h.at(j) = gathered_results_.h[j][i];
+      factors.error_flag = static_cast<decltype(factors.error_flag)>(
+          gathered_results_.error_flag[i]);
+    }
+  }
+}
+
+}  // namespace batch
+
+}  // namespace visco
+
+}  // namespace spauly
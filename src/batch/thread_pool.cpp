@@ -0,0 +1,180 @@
+// Visco Correct Desktop - Correction factors for centrifugal pumps
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Visco-Correct-Desktop>
+#include "spauly/visco/batch/thread_pool.h"
+
+#include <algorithm>
+
+namespace spauly {
+namespace visco {
+namespace batch {
+
+namespace {
+
+// Identifies the pool and worker the current thread belongs to
+thread_local const ThreadPool *tls_pool = nullptr;
+thread_local std::size_t tls_worker = 0;
+
+}  // namespace
+
+ThreadPool::ThreadPool(std::size_t thread_count) {
+  if (thread_count == 0)
+    thread_count = std::max(1u, std::thread::hardware_concurrency());
+
+  queues_.reserve(thread_count);
+  for (std::size_t i = 0; i < thread_count; i++)
+    queues_.push_back(std::make_unique<Queue>());
+
+  threads_.reserve(thread_count);
+  for (std::size_t i = 0; i < thread_count; i++)
+    threads_.emplace_back(&ThreadPool::WorkerLoop, this, i);
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(wake_mutex_);
+    stop_ = true;
+  }
+  wake_.notify_all();
+  for (std::thread &thread : threads_) thread.join();
+}
+
+void ThreadPool::Submit(Task task) {
+  std::size_t queue = (tls_pool == this)
+                          ? tls_worker
+                          : next_queue_.fetch_add(1, std::memory_order_relaxed);
+  Push(queue % queues_.size(), std::move(task));
+}
+
+void ThreadPool::Defer(Task task) {
+  std::size_t queue = (tls_pool == this)
+                          ? tls_worker
+                          : next_queue_.fetch_add(1, std::memory_order_relaxed);
+  Push(queue % queues_.size(), std::move(task), true);
+}
+
+void ThreadPool::ParallelFor(std::size_t count, std::size_t grain,
+                             const RangeTask &body) {
+  if (count == 0) return;
+  grain = std::max<std::size_t>(grain, 1);
+
+  const std::size_t chunks = (count + grain - 1) / grain;
+  const std::size_t chunks_per_queue =
+      (chunks + queues_.size() - 1) / queues_.size();
+
+  struct {
+    std::mutex mutex;
+    std::condition_variable done;
+    std::size_t remaining;
+  } state;
+  state.remaining = chunks;
+
+  for (std::size_t chunk = 0; chunk < chunks; chunk++) {
+    std::size_t begin = chunk * grain;
+    std::size_t end = std::min(begin + grain, count);
+    Push(chunk / chunks_per_queue,
+         [&body, &state, begin, end](std::size_t worker) {
+           body(begin, end, worker);
+
+           std::lock_guard<std::mutex> lock(state.mutex);
+           if (--state.remaining == 0) state.done.notify_all();
+         });
+  }
+
+  // A worker would block one of the threads the chunks need, it helps instead
+  if (tls_pool == this) {
+    while (true) {
+      {
+        std::lock_guard<std::mutex> lock(state.mutex);
+        if (state.remaining == 0) return;
+      }
+      // With nothing left to pop, the other chunks are already running
+      if (!RunOne(tls_worker)) break;
+    }
+  }
+
+  std::unique_lock<std::mutex> lock(state.mutex);
+  state.done.wait(lock, [&state] { return state.remaining == 0; });
+}
+
+void ThreadPool::WorkerLoop(std::size_t index) {
+  tls_pool = this;
+  tls_worker = index;
+
+  while (true) {
+    if (RunOne(index)) continue;
+
+    std::unique_lock<std::mutex> lock(wake_mutex_);
+    wake_.wait(lock, [this] { return stop_ || pending_.load() != 0; });
+    if (stop_ && pending_.load() == 0) return;
+  }
+}
+
+bool ThreadPool::RunOne(std::size_t index) {
+  Task task;
+  if (!TryPop(index, task)) return false;
+  pending_.fetch_sub(1, std::memory_order_relaxed);
+  task(index);
+  return true;
+}
+
+bool ThreadPool::TryPop(std::size_t index, Task &task) {
+  {
+    Queue &own = *queues_[index];
+    std::lock_guard<std::mutex> lock(own.mutex);
+    if (!own.tasks.empty()) {
+      task = std::move(own.tasks.back());
+      own.tasks.pop_back();
+      return true;
+    }
+  }
+
+  // Steal the oldest task of the next busy worker
+  for (std::size_t i = 1; i < queues_.size(); i++) {
+    Queue &victim = *queues_[(index + i) % queues_.size()];
+    std::lock_guard<std::mutex> lock(victim.mutex);
+    if (!victim.tasks.empty()) {
+      task = std::move(victim.tasks.front());
+      victim.tasks.pop_front();
+      return true;
+    }
+  }
+  return false;
+}
+
+void ThreadPool::Push(std::size_t queue, Task task, bool front) {
+  {
+    // Count the task before it is published, a worker that pops it right
+    // away must not decrement pending_ below zero. Under the wake mutex so
+    // no sleeping worker misses it
+    std::lock_guard<std::mutex> lock(wake_mutex_);
+    pending_.fetch_add(1, std::memory_order_relaxed);
+    Queue &target = *queues_[queue];
+    std::lock_guard<std::mutex> queue_lock(target.mutex);
+    if (front)
+      target.tasks.push_front(std::move(task));
+    else
+      target.tasks.push_back(std::move(task));
+  }
+  wake_.notify_one();
+}
+
+}  // namespace batch
+
+}  // namespace visco
+
+}  // namespace spauly
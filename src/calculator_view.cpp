@@ -19,103 +19,262 @@
 
 #include <imgui.h>
 
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+
 #include "spauly/visco/utils/ui_helpers.h"
 
 namespace spauly {
 namespace visco {
 
+namespace {
+
+constexpr const char *kHeading = "Correction factors:";
+
+}  // namespace
+
+CalculatorView::CalculatorView() {
+  main_project_ = active_ = projects_.Add("Calculator").id;
+}
+
+ProjectId CalculatorView::AddProject() {
+  focus_request_ = projects_.Add().id;
+  version_++;
+  return focus_request_;
+}
+
+void CalculatorView::SetProjects(ProjectStore &&projects) {
+  projects_ = std::move(projects);
+  if (projects_.empty()) projects_.Add("Calculator");
+  main_project_ = active_ = projects_[0].id;
+  focus_request_ = ProjectStore::kInvalidId;
+  result_text_.clear();
+  version_++;
+  PostEvent(utils::InputChangedEvent{active_});
+}
+
+void CalculatorView::Touch(Project &project) {
+  project.version++;
+  version_++;
+  PostEvent(utils::InputChangedEvent{project.id});
+}
+
+const CalculatorView::ResultText &CalculatorView::GetResultText(
+    std::size_t index, const Project &project) {
+  ResultText &text = result_text_[index];
+  if (text.id == project.id && text.version == project.version) return text;
+
+  const vccore::CorrectionFactors &result = project.result;
+  text.id = project.id;
+  text.version = project.version;
+  std::snprintf(text.eta, sizeof(text.eta), "eta: %.2f", result.eta);
+  std::snprintf(text.q, sizeof(text.q), "Q: %.2f", result.q);
+  constexpr const char *kFlowRatios[4] = {"0.6", "0.8", "1.0", "1.2"};
+  for (std::size_t i = 0; i < result.h.size(); i++)
+    std::snprintf(text.h[i], sizeof(text.h[i]), "%s x Q_opt: %.2f",
+                  kFlowRatios[i], result.h.at(i));
+  return text;
+}
+
+const Project &CalculatorView::active_project() const {
+  const Project *project = projects_.Find(active_);
+  return project ? *project : projects_[0];
+}
+
+Project &CalculatorView::active_project() {
+  Project *project = projects_.Find(active_);
+  return project ? *project : projects_[0];
+}
+
+void CalculatorView::SetInputs(const vccore::Parameters &params,
+                               const vccore::Units &units) {
+  Project &project = active_project();
+  project.params = params;
+  project.units = units;
+  Touch(project);
+}
+
+void CalculatorView::Calculate() {
+  Project &project = active_project();
+  Calculate(project);
+  Touch(project);
+}
+
+void CalculatorView::Calculate(Project &project) {
+  project.result = cache_.GetOrCalculate(
+      project.params, project.units,
+      [this](const vccore::Parameters &point,
+             const vccore::Units &point_units) {
+        return calculator_.Calculate(point, point_units);
+      });
+  PostEvent(utils::ResultReadyEvent{project.id});
+}
+
 void CalculatorView::OnUIRender(const ImGuiWindowFlags &flags) {
-  ImGui::Begin("Calculator", nullptr, flags);
+  ProjectId closed = ProjectStore::kInvalidId;
+  // Only allocates when projects were added
+  result_text_.resize(projects_.size());
+
+  for (std::size_t i = 0; i < projects_.size(); i++) {
+    Project &project = projects_[i];
+    if (dock_id_ != 0)
+      ImGui::SetNextWindowDockID(dock_id_, ImGuiCond_FirstUseEver);
+    if (project.id == focus_request_) {
+      ImGui::SetNextWindowFocus();
+      focus_request_ = ProjectStore::kInvalidId;
+    }
+
+    // The main calculator can not be closed
+    bool open = true;
+    bool *p_open = (project.id == main_project_) ? nullptr : &open;
 
+    // Begin() returns false for hidden tabs and collapsed windows
+    if (ImGui::Begin(project.title, p_open, flags)) {
+      if (active_ != project.id &&
+          ImGui::IsWindowFocused(ImGuiFocusedFlags_RootAndChildWindows)) {
+        active_ = project.id;
+        version_++;
+        PostEvent(utils::InputChangedEvent{active_});
+      }
+      RenderProject(i, project);
+    }
+    ImGui::End();
+
+    if (!open) closed = project.id;
+  }
+
+  if (closed != ProjectStore::kInvalidId) {
+    projects_.Remove(closed);
+    if (active_ == closed) {
+      active_ = main_project_;
+      PostEvent(utils::InputChangedEvent{active_});
+    }
+    version_++;
+  }
+  rendered_version_ = version_;
+}
+
+void CalculatorView::RenderProject(std::size_t index, Project &project) {
+  vccore::Parameters &params = project.params;
+  vccore::Units &units = project.units;
+  const vccore::CorrectionFactors &result = project.result;
+
+  bool changed = false;
   ImGui::PushItemWidth(100);
-  ImGui::InputDouble("Q - Flowrate in", &static_cast<double>(params_.flowrate),
-                     0.0, 0.0, "%.3f");
+  changed |= ImGui::InputDouble("Q - Flowrate in", &params.flowrate, 0.0,
+                                0.0, "%.3f");
   ImGui::SameLine();
-  ImGui::Combo("##flowunit", reinterpret_cast<int *>(&units_.flowrate),
-               "m^3/h\0l/min\0GPM\0\0");
-  ImGui::InputDouble("H - Total differential head in",
-                     &static_cast<double>(params_.total_head), 0.0, 0.0,
-                     "%.3f");
+  changed |= ImGui::Combo("##flowunit",
+                          reinterpret_cast<int *>(&units.flowrate),
+                          "m^3/h\0l/min\0GPM\0\0");
+  changed |= ImGui::InputDouble("H - Total differential head in",
+                                &params.total_head, 0.0, 0.0, "%.3f");
   ImGui::SameLine();
-  ImGui::Combo("##totalhunit", reinterpret_cast<int *>(&units_.total_head),
-               "m\0ft\0\0");
-  ImGui::InputDouble("v - Viscosity in",
-                     &static_cast<double>(params_.viscosity), 0.0, 0.0, "%.3f");
+  changed |= ImGui::Combo("##totalhunit",
+                          reinterpret_cast<int *>(&units.total_head),
+                          "m\0ft\0\0");
+  changed |= ImGui::InputDouble("v - Viscosity in", &params.viscosity, 0.0,
+                                0.0, "%.3f");
   ImGui::SameLine();
-  ImGui::Combo("##viscounit", reinterpret_cast<int *>(&units_.viscosity),
-               "mm^2/h\0cSt\0cP\0mPas\0\0");
-  if (units_.viscosity == vccore::ViscosityUnit::kcP ||
-      units_.viscosity == vccore::ViscosityUnit::kmPas) {  // Dynamic viscosity
-    ImGui::InputDouble("Density", &static_cast<double>(params_.density), 0.0,
-                       0.0, "%.3f");
+  changed |= ImGui::Combo("##viscounit",
+                          reinterpret_cast<int *>(&units.viscosity),
+                          "mm^2/h\0cSt\0cP\0mPas\0\0");
+  if (units.viscosity == vccore::ViscosityUnit::kcP ||
+      units.viscosity == vccore::ViscosityUnit::kmPas) {  // Dynamic viscosity
+    changed |= ImGui::InputDouble("Density", &params.density, 0.0, 0.0,
+                                  "%.3f");
     ImGui::SameLine();
-    ImGui::Combo("##Densityunit", reinterpret_cast<int *>(&units_.density),
-                 "g/l\0kg/m^3\0\0");
+    changed |= ImGui::Combo("##Densityunit",
+                            reinterpret_cast<int *>(&units.density),
+                            "g/l\0kg/m^3\0\0");
   }
 
   ImGui::PopItemWidth();
 
   if (ImGui::Button("Calculate", ImVec2(100, 0))) {
-    result_ = calculator_.Calculate(params_, units_);
+    Calculate(project);
+    changed = true;
   }
+  if (changed) Touch(project);
 
   ImGui::Separator();
 
-  if (result_.error_flag) [[unlikely]] {
-    if (result_.error_flag & vccore::ErrorFlag::kFlowrateError) {
+  if (result.error_flag) [[unlikely]] {
+    if (result.error_flag & vccore::ErrorFlag::kFlowrateError) {
       ImGui::TextColored(ImVec4(1.0f, 0.0f, 0.0f, 1.0f),
                          "Flowrate must be in the range of 6 - 2000 m³/h");
     }
-    if (result_.error_flag & vccore::ErrorFlag::kTotalHeadError) {
+    if (result.error_flag & vccore::ErrorFlag::kTotalHeadError) {
       ImGui::TextColored(ImVec4(1.0f, 0.0f, 0.0f, 1.0f),
                          "Total head must be in the range of 5 - 200 m");
     }
-    if (result_.error_flag & vccore::ErrorFlag::kViscosityError) {
+    if (result.error_flag & vccore::ErrorFlag::kViscosityError) {
       ImGui::TextColored(ImVec4(1.0f, 0.0f, 0.0f, 1.0f),
                          "Viscosity must be in the range of 10 - 4000 mm²/s");
     }
   }
 
+  // The heading is only measured again when the font changes
   ImGui::Separator();
-  ImGui::SetCursorPosX(
-      (ImGui::GetWindowWidth() - ImGui::CalcTextSize("Correction factors:").x) *
-      0.5f);
-  ImGui::Text("Correction factors:\n");
-
-  ImGui::Text("eta: %.2f", result_.eta);
-  ImGui::Text("Q: %.2f", result_.q);
-  ImGui::Text("H:");
+  if (ImGui::GetFontSize() != heading_font_size_) {
+    heading_font_size_ = ImGui::GetFontSize();
+    heading_width_ = ImGui::CalcTextSize(kHeading).x;
+  }
+  ImGui::SetCursorPosX((ImGui::GetWindowWidth() - heading_width_) * 0.5f);
+  ImGui::TextUnformatted("Correction factors:\n");
+
+  const ResultText &text = GetResultText(index, project);
+  ImGui::TextUnformatted(text.eta);
+  ImGui::TextUnformatted(text.q);
+  ImGui::TextUnformatted("H:");
   ImGui::Indent();
-  ImGui::Text("0.6 x Q_opt: %.2f", result_.h.at(0));
-  ImGui::Text("0.8 x Q_opt: %.2f", result_.h.at(1));
-  ImGui::Text("1.0 x Q_opt: %.2f", result_.h.at(2));
-  ImGui::Text("1.2 x Q_opt: %.2f", result_.h.at(3));
+  for (const char *line : text.h) ImGui::TextUnformatted(line);
   ImGui::Unindent();
 
+  if (ImGui::CollapsingHeader("Viscosity sweep")) {
+    SweepDefinition &sweep = project.sweep;
+    int samples = static_cast<int>(sweep.samples);
+    ImGui::PushItemWidth(100);
+    bool sweep_changed = ImGui::InputDouble("Minimum viscosity in mm^2/s",
+                                            &sweep.viscosity_min, 0.0, 0.0,
+                                            "%.3f");
+    sweep_changed |= ImGui::InputDouble("Maximum viscosity in mm^2/s",
+                                        &sweep.viscosity_max, 0.0, 0.0,
+                                        "%.3f");
+    if (ImGui::InputInt("Samples", &samples, 0, 0)) {
+      sweep.samples = static_cast<std::uint32_t>(std::clamp<int>(
+          samples, 2, static_cast<int>(SweepDefinition::kMaxSamples)));
+      sweep_changed = true;
+    }
+    ImGui::PopItemWidth();
+    if (sweep_changed) Touch(project);
+  }
+
   ImGui::Dummy(ImVec2(0.0f, 40.0f));  // Add some vertical space
   Disclaimer();
-
-  ImGui::End();
 }
 
 void CalculatorView::Disclaimer() {
   ImGui::Separator();
-  ImGui::Text("");
-  ImGui::Text("                    !!! DISCLAIMER !!!");
-  ImGui::Text("This software currently is purely experimental and all ");
-  ImGui::Text("calculated values should be verified manually. ViscoCorrect");
-  ImGui::Text("uses a graphical approach based on ");
+  ImGui::TextUnformatted("");
+  ImGui::TextUnformatted("                    !!! DISCLAIMER !!!");
+  ImGui::TextUnformatted(
+      "This software currently is purely experimental and all ");
+  ImGui::TextUnformatted(
+      "calculated values should be verified manually. ViscoCorrect");
+  ImGui::TextUnformatted("uses a graphical approach based on ");
   ImGui::SameLine();
   utils::HyperLink(
       "https:\\\\www.researchgate.net\\figure\\The-graph-obtained-by-the-"
       "American-Institute-of-hydraulics_fig1_335209726",
       "this graph");
   ImGui::SameLine();
-  ImGui::Text(" obtained by");
-  ImGui::Text("the American Institute of Hydraulics.");
-  ImGui::Text(
+  ImGui::TextUnformatted(" obtained by");
+  ImGui::TextUnformatted("the American Institute of Hydraulics.");
+  ImGui::TextUnformatted(
       "Note that the used standard is deprecated! The HI advises only ");
-  ImGui::Text("using the latest ");
+  ImGui::TextUnformatted("using the latest ");
   ImGui::SameLine();
   utils::HyperLink(
       "https:\\\\www.pumps.org\\what-we-do\\standards\\?pumps-search-product="
@@ -123,16 +282,16 @@ void CalculatorView::Disclaimer() {
       "6.7",
       "ANSI/HI 9.6.7 Standard");
   ImGui::SameLine();
-  ImGui::Text("!");
-  ImGui::Text("Use at your own risk.");
-  ImGui::Text("");
-  ImGui::Text("Please ");
+  ImGui::TextUnformatted("!");
+  ImGui::TextUnformatted("Use at your own risk.");
+  ImGui::TextUnformatted("");
+  ImGui::TextUnformatted("Please ");
   ImGui::SameLine();
   if (ImGui::SmallButton("provide feedback"))
     ;  /// TODO: Implement helper function for feedback
   ImGui::SameLine();
-  ImGui::Text(" in case the calculated values are");
-  ImGui::Text("incorrect. Thank you :)");
+  ImGui::TextUnformatted(" in case the calculated values are");
+  ImGui::TextUnformatted("incorrect. Thank you :)");
 }
 
 }  // namespace visco
@@ -0,0 +1,506 @@
+// Visco Correct Desktop - Correction factors for centrifugal pumps
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Visco-Correct-Desktop>
+//
+// Headless batch frontend: reads operating points as CSV/TSV rows or binary
+// datasets and writes one row of correction factors per input row.
+#include <charconv>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <string_view>
+#include <vector>
+
+#include "spauly/vccore/data.h"
+#include "spauly/visco/batch/batch_engine.h"
+#include "spauly/visco/batch/binary_format.h"
+#include "spauly/visco/batch/ipc_server.h"
+#include "spauly/visco/batch/reverse_solver.h"
+#include "spauly/visco/batch/row_io.h"
+
+namespace {
+
+using namespace spauly;
+
+constexpr std::size_t kRowsPerChunk = 1 << 18;
+
+void PrintUsage() {
+  std::fputs(
+      "Usage: Visco-Correct-CLI [options] [input]\n"
+      "\n"
+      "Reads rows of 'flowrate,head,viscosity,density[,flow unit,head unit,\n"
+      "viscosity unit,density unit]' from input (default: stdin) and writes\n"
+      "'eta,q,h_0.6,h_0.8,h_1.0,h_1.2,error_flag' per row. Binary datasets\n"
+      "(.vcdb) are detected by their header and read memory mapped.\n"
+      "\n"
+      "Options:\n"
+      "  -o <file>             Write the results to file (default: stdout)\n"
+      "  --binary              Write the results as binary dataset (needs -o)\n"
+      "  --convert             Only convert the CSV input into a binary\n"
+      "                        dataset (needs -o)\n"
+      "  -j <threads>          Number of worker threads (default: all cores)\n"
+      "  --grid <file>         Interpolate in the precomputed grid stored in\n"
+      "                        file, it is built and saved if missing\n"
+      "  --solve <input>       Instead of the factors, write the value of\n"
+      "                        input (flowrate, head, viscosity, density)\n"
+      "                        at which the factor reaches the target, the\n"
+      "                        rows provide the fixed inputs. Writes\n"
+      "                        'value,factor,evaluations,status' per row\n"
+      "  --factor <factor>     Factor to solve for (eta, q, h_0.6, h_0.8,\n"
+      "                        h_1.0, h_1.2; default: eta)\n"
+      "  --target <value>      Target value of the factor (default: 0.7)\n"
+      "  --range <low>,<high>  Search interval of the solved input\n"
+      "                        (default: 10,4000)\n"
+      "  --lowest              Find the lowest instead of the highest value\n"
+      "                        that reaches the target\n"
+      "  --serve <socket>      Serve calculation requests of other tools on\n"
+      "                        the Unix domain socket until interrupted\n"
+      "  --tsv                 Separate the output columns by tabs\n"
+      "  --no-header           Do not write the output header\n"
+      "  --flow-unit <unit>    Default flowrate unit (m^3/h, l/min, GPM)\n"
+      "  --head-unit <unit>    Default total head unit (m, ft)\n"
+      "  --visc-unit <unit>    Default viscosity unit (mm^2/s, cSt, cP, mPas)\n"
+      "  --density-unit <unit> Default density unit (g/l, kg/m^3)\n"
+      "  -h, --help            Show this help\n",
+      stdout);
+}
+
+/// @brief Writes results either as text rows or into a results dataset.
+class ResultSink {
+ public:
+  ResultSink(visco::batch::RowWriter &rows,
+             visco::batch::DatasetWriter &dataset)
+      : rows_(rows), dataset_(dataset) {}
+
+  void Write(const vccore::CorrectionFactors &factors) {
+    if (dataset_.is_open())
+      ok_ = dataset_.Append(factors) && ok_;
+    else
+      rows_.Write(factors);
+  }
+
+  void Write(const visco::batch::SoaOutput &out) {
+    if (dataset_.is_open()) {
+      ok_ = dataset_.Append(out) && ok_;
+      return;
+    }
+    for (std::size_t i = 0; i < out.size(); i++) {
+      vccore::CorrectionFactors factors;
+      factors.eta = out.eta[i];
+      factors.q = out.q[i];
+      for (std::size_t j = 0; j < out.h.size(); j++)
+        factors.h.at(j) = out.h[j][i];
+      factors.error_flag =
+          static_cast<decltype(factors.error_flag)>(out.error_flag[i]);
+      rows_.Write(factors);
+    }
+  }
+
+  /// @return Returns false if any write failed.
+  bool Finish() {
+    bool ok = dataset_.is_open() ? dataset_.Close() : rows_.Flush();
+    return ok && ok_;
+  }
+
+ private:
+  visco::batch::RowWriter &rows_;
+  visco::batch::DatasetWriter &dataset_;
+  bool ok_ = true;
+};
+
+/// @brief Calculates all blocks of a mapped inputs dataset. The blocks are
+/// handed to the engine without copying.
+/// @return Returns false if the dataset is malformed.
+bool ProcessDataset(visco::batch::DatasetReader &reader,
+                    visco::batch::BatchEngine &engine,
+                    const visco::batch::CorrectionGrid *grid,
+                    ResultSink &sink) {
+  visco::batch::SoaResults results;
+  results.resize(reader.block_rows());
+
+  // Files with frequently changing units consist of tiny blocks, these are
+  // not worth a round trip through the pool
+  visco::batch::GridCalculator calculator(grid);
+
+  vccore::Units units;
+  visco::batch::SoaInput block;
+  while (reader.NextBlock(units, block)) {
+    visco::batch::SoaOutput out = results.view().subspan(0, block.size());
+    bool valid = (block.size() < engine.chunk_size())
+                     ? calculator.Calculate(block, units, out, engine.mode())
+                     : engine.Calculate(block, units, out);
+    if (!valid) return false;
+    sink.Write(out);
+  }
+  return !reader.Failed();
+}
+
+bool ParseDouble(std::string_view token, double &value) {
+  auto [ptr, ec] =
+      std::from_chars(token.data(), token.data() + token.size(), value);
+  return ec == std::errc() && ptr == token.data() + token.size();
+}
+
+bool ParseSolveField(std::string_view token, visco::batch::StudyField &field) {
+  constexpr std::string_view kNames[] = {"flowrate", "head", "viscosity",
+                                         "density"};
+  for (std::size_t i = 0; i < std::size(kNames); i++) {
+    if (token == kNames[i]) {
+      field = static_cast<visco::batch::StudyField>(i);
+      return true;
+    }
+  }
+  return false;
+}
+
+bool ParseFactor(std::string_view token, visco::batch::FactorField &factor) {
+  constexpr std::string_view kNames[] = {"eta",   "q",     "h_0.6",
+                                         "h_0.8", "h_1.0", "h_1.2"};
+  for (std::size_t i = 0; i < std::size(kNames); i++) {
+    if (token == kNames[i]) {
+      factor = static_cast<visco::batch::FactorField>(i);
+      return true;
+    }
+  }
+  return false;
+}
+
+bool ParseRange(std::string_view token, double &lower, double &upper) {
+  const std::size_t comma = token.find(',');
+  return comma != std::string_view::npos &&
+         ParseDouble(token.substr(0, comma), lower) &&
+         ParseDouble(token.substr(comma + 1), upper);
+}
+
+/// @brief Solves query once per input row, the rows provide the fixed
+/// inputs and their units.
+/// @return Returns false if the input is malformed or a write failed.
+bool SolveRows(std::FILE *input, std::FILE *output,
+               const vccore::Units &default_units,
+               const visco::batch::SolverQuery &query, char delimiter,
+               bool header, std::size_t threads) {
+  constexpr const char *kStatusNames[] = {"solved", "no_crossing",
+                                          "out_of_range", "invalid"};
+
+  visco::batch::RowReader reader(input, default_units);
+  visco::batch::ThreadPool pool(threads);
+  std::vector<visco::batch::OperatingPoint> rows;
+  std::vector<visco::batch::SolverQuery> queries;
+  std::vector<visco::batch::SolverResult> results;
+  rows.reserve(kRowsPerChunk);
+
+  if (header)
+    std::fprintf(output, "value%cfactor%cevaluations%cstatus\n", delimiter,
+                 delimiter, delimiter);
+
+  while (reader.Read(rows, kRowsPerChunk) != 0) {
+    queries.assign(rows.size(), query);
+    for (std::size_t i = 0; i < rows.size(); i++) {
+      queries[i].params = rows[i].params;
+      queries[i].units = rows[i].units;
+    }
+    results.resize(rows.size());
+    visco::batch::SolveAll(queries, results, pool);
+
+    for (const auto &result : results)
+      std::fprintf(output, "%.9g%c%.9g%c%zu%c%s\n", result.value, delimiter,
+                   visco::batch::FactorValue(result.factors, query.factor),
+                   delimiter, result.evaluations, delimiter,
+                   kStatusNames[result.status]);
+    rows.clear();
+  }
+
+  if (reader.Failed()) {
+    std::fprintf(stderr, "Malformed input in line %zu\n", reader.line());
+    return false;
+  }
+  if (std::fflush(output) != 0 || std::ferror(output)) {
+    std::fputs("Could not write the results\n", stderr);
+    return false;
+  }
+  return true;
+}
+
+/// @brief Loads the grid from path, it is built and saved if the file is
+/// missing.
+/// @return Returns false if the grid could neither be loaded nor built, the
+/// caller then stays in exact mode.
+bool LoadGrid(const char *path, visco::batch::CorrectionGrid &grid,
+              visco::batch::BatchEngine *engine) {
+  if (!grid.Load(path)) {
+    std::fputs("Building the correction grid...\n", stderr);
+    if (!grid.Build(visco::batch::CorrectionGrid::kDefaultCellsPerOctave,
+                    engine) ||
+        grid.empty()) {
+      std::fputs("Could not build the grid, using the exact calculator\n",
+                 stderr);
+      return false;
+    }
+    if (!grid.Save(path))
+      std::fprintf(stderr, "Could not save the grid to %s\n", path);
+  }
+  std::fprintf(stderr,
+               "Grid error estimate (largest deviation at %zu cell centres): "
+               "eta %.2e, q %.2e, h %.2e\n",
+               grid.error().samples, grid.error().eta, grid.error().q,
+               grid.error().h);
+  return true;
+}
+
+visco::batch::IpcServer *g_server = nullptr;
+
+void StopServer(int) {
+  if (g_server) g_server->Stop();
+}
+
+/// @brief Answers requests on the socket at path until SIGINT or SIGTERM.
+/// @return Returns false if the socket can not be bound.
+bool ServeRequests(const char *path, std::size_t threads,
+                   const char *grid_path) {
+  visco::batch::IpcServer server(threads);
+  visco::batch::CorrectionGrid grid;
+  if (grid_path && LoadGrid(grid_path, grid, nullptr))
+    server.SetMode(visco::batch::CalculationMode::kGrid, &grid);
+
+  if (!server.Listen(path)) {
+    std::fprintf(stderr, "Could not listen on %s\n", path);
+    return false;
+  }
+  std::fprintf(stderr, "Serving on %s\n", path);
+
+  g_server = &server;
+  std::signal(SIGINT, StopServer);
+  std::signal(SIGTERM, StopServer);
+  bool ok = server.Serve();
+  g_server = nullptr;
+
+  std::fprintf(stderr, "Served %llu rows\n",
+               static_cast<unsigned long long>(server.rows_served()));
+  return ok;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  const char *input_path = nullptr;
+  const char *output_path = nullptr;
+  const char *grid_path = nullptr;
+  const char *socket_path = nullptr;
+  char delimiter = ',';
+  bool header = true;
+  bool binary_output = false;
+  bool convert = false;
+  bool solve = false;
+  visco::batch::SolverQuery query;
+  std::size_t threads = 0;
+  vccore::Units default_units;
+
+  for (int i = 1; i < argc; i++) {
+    std::string_view arg = argv[i];
+    bool has_value = i + 1 < argc;
+    bool valid = true;
+
+    if (arg == "-h" || arg == "--help") {
+      PrintUsage();
+      return 0;
+    } else if (arg == "--tsv") {
+      delimiter = '\t';
+    } else if (arg == "--no-header") {
+      header = false;
+    } else if (arg == "--binary") {
+      binary_output = true;
+    } else if (arg == "--convert") {
+      convert = true;
+    } else if (arg == "--solve" && has_value) {
+      solve = true;
+      valid = ParseSolveField(argv[++i], query.variable);
+    } else if (arg == "--factor" && has_value) {
+      valid = ParseFactor(argv[++i], query.factor);
+    } else if (arg == "--target" && has_value) {
+      valid = ParseDouble(argv[++i], query.target);
+    } else if (arg == "--range" && has_value) {
+      valid = ParseRange(argv[++i], query.lower, query.upper);
+    } else if (arg == "--lowest") {
+      query.highest = false;
+    } else if (arg == "-j" && has_value) {
+      std::string_view value = argv[++i];
+      auto [ptr, ec] =
+          std::from_chars(value.data(), value.data() + value.size(), threads);
+      valid = ec == std::errc() && ptr == value.data() + value.size();
+    } else if (arg == "--serve" && has_value) {
+      socket_path = argv[++i];
+    } else if (arg == "--grid" && has_value) {
+      grid_path = argv[++i];
+    } else if (arg == "-o" && has_value) {
+      output_path = argv[++i];
+    } else if (arg == "--flow-unit" && has_value) {
+      valid =
+          visco::batch::ParseFlowrateUnit(argv[++i], default_units.flowrate);
+    } else if (arg == "--head-unit" && has_value) {
+      valid =
+          visco::batch::ParseTotalHeadUnit(argv[++i], default_units.total_head);
+    } else if (arg == "--visc-unit" && has_value) {
+      valid =
+          visco::batch::ParseViscosityUnit(argv[++i], default_units.viscosity);
+    } else if (arg == "--density-unit" && has_value) {
+      valid = visco::batch::ParseDensityUnit(argv[++i], default_units.density);
+    } else if (!input_path &&
+               (arg == "-" || (!arg.empty() && arg.front() != '-'))) {
+      input_path = argv[i];
+    } else {
+      valid = false;
+    }
+
+    if (!valid) {
+      std::fprintf(stderr, "Invalid argument: %s\n", argv[i]);
+      PrintUsage();
+      return 2;
+    }
+  }
+
+  if (socket_path) {
+    if (input_path || output_path || binary_output || convert || solve) {
+      std::fputs("--serve does not read input or write output\n", stderr);
+      return 2;
+    }
+    return ServeRequests(socket_path, threads, grid_path) ? 0 : 1;
+  }
+
+  if ((binary_output || convert) && !output_path) {
+    std::fputs("--binary and --convert need an output file (-o)\n", stderr);
+    return 2;
+  }
+  if (solve && (binary_output || convert)) {
+    std::fputs("--solve can not be combined with --binary or --convert\n",
+               stderr);
+    return 2;
+  }
+
+  // Binary datasets are mapped instead of streamed through stdio
+  bool binary_input = input_path && std::strcmp(input_path, "-") != 0 &&
+                      visco::batch::IsDatasetFile(input_path);
+  visco::batch::DatasetReader dataset_reader;
+  if (binary_input) {
+    if (convert) {
+      std::fprintf(stderr, "%s is already a binary dataset\n", input_path);
+      return 2;
+    }
+    if (solve) {
+      std::fputs("--solve reads CSV/TSV input only\n", stderr);
+      return 2;
+    }
+    if (!dataset_reader.Open(input_path) ||
+        dataset_reader.kind() != visco::batch::DatasetKind::kInputs) {
+      std::fprintf(stderr, "Not a valid input dataset: %s\n", input_path);
+      return 1;
+    }
+  }
+
+  std::FILE *input = stdin;
+  if (!binary_input && input_path && std::strcmp(input_path, "-") != 0) {
+    input = std::fopen(input_path, "rb");
+    if (!input) {
+      std::fprintf(stderr, "Could not open input file: %s\n", input_path);
+      return 1;
+    }
+  }
+
+  if (convert) {
+    visco::batch::RowReader reader(input, default_units);
+    visco::batch::DatasetWriter writer;
+    int exit_code = 0;
+    if (!writer.Open(output_path, visco::batch::DatasetKind::kInputs)) {
+      std::fprintf(stderr, "Could not open output file: %s\n", output_path);
+      exit_code = 1;
+    } else if (!visco::batch::ConvertRows(reader, writer) || !writer.Close()) {
+      if (reader.Failed())
+        std::fprintf(stderr, "Malformed input in line %zu\n", reader.line());
+      else
+        std::fputs("Could not write the dataset\n", stderr);
+      exit_code = 1;
+    }
+    if (input != stdin) std::fclose(input);
+    return exit_code;
+  }
+
+  std::FILE *output = stdout;
+  visco::batch::DatasetWriter dataset_writer;
+  if (binary_output) {
+    if (!dataset_writer.Open(output_path,
+                             visco::batch::DatasetKind::kResults)) {
+      std::fprintf(stderr, "Could not open output file: %s\n", output_path);
+      if (input != stdin) std::fclose(input);
+      return 1;
+    }
+  } else if (output_path) {
+    output = std::fopen(output_path, "wb");
+    if (!output) {
+      std::fprintf(stderr, "Could not open output file: %s\n", output_path);
+      if (input != stdin) std::fclose(input);
+      return 1;
+    }
+  }
+
+  int exit_code = 0;
+  if (solve) {
+    if (!SolveRows(input, output, default_units, query, delimiter, header,
+                   threads))
+      exit_code = 1;
+  } else {
+    visco::batch::RowWriter writer(output, delimiter);
+    ResultSink sink(writer, dataset_writer);
+    visco::batch::BatchEngine engine(threads);
+    visco::batch::CorrectionGrid grid;
+    const bool use_grid = grid_path && LoadGrid(grid_path, grid, &engine);
+    if (use_grid) engine.SetMode(visco::batch::CalculationMode::kGrid, &grid);
+
+    if (header && !binary_output) writer.WriteHeader();
+
+    if (binary_input) {
+      if (!ProcessDataset(dataset_reader, engine, use_grid ? &grid : nullptr,
+                          sink)) {
+        std::fprintf(stderr, "Malformed dataset: %s\n", input_path);
+        exit_code = 1;
+      }
+    } else {
+      visco::batch::RowReader reader(input, default_units);
+      std::vector<visco::batch::OperatingPoint> rows;
+      std::vector<vccore::CorrectionFactors> results(kRowsPerChunk);
+      rows.reserve(kRowsPerChunk);
+
+      while (reader.Read(rows, kRowsPerChunk) != 0) {
+        engine.Calculate(rows, results);
+        for (std::size_t i = 0; i < rows.size(); i++) sink.Write(results[i]);
+        rows.clear();
+      }
+
+      if (reader.Failed()) {
+        std::fprintf(stderr, "Malformed input in line %zu\n", reader.line());
+        exit_code = 1;
+      }
+    }
+
+    if (!sink.Finish()) {
+      std::fputs("Could not write the results\n", stderr);
+      exit_code = 1;
+    }
+  }
+
+  if (input != stdin) std::fclose(input);
+  if (output != stdout) std::fclose(output);
+  return exit_code;
+}
@@ -0,0 +1,331 @@
+// Visco Correct Desktop - Correction factors for centrifugal pumps
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Visco-Correct-Desktop>
+#include "spauly/visco/graph_view.h"
+
+#include <imgui.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <variant>
+
+#include "spauly/visco/batch/unit_conversion.h"
+
+namespace spauly {
+namespace visco {
+
+namespace {
+
+constexpr float kFlowRatios[4] = {0.6f, 0.8f, 1.0f, 1.2f};
+constexpr float kNaN = std::numeric_limits<float>::quiet_NaN();
+
+bool SameInputs(const vccore::Parameters &a_params,
+                const vccore::Units &a_units,
+                const vccore::Parameters &b_params,
+                const vccore::Units &b_units) {
+  return a_params.flowrate == b_params.flowrate &&
+         a_params.total_head == b_params.total_head &&
+         a_params.viscosity == b_params.viscosity &&
+         a_params.density == b_params.density &&
+         a_units.flowrate == b_units.flowrate &&
+         a_units.total_head == b_units.total_head &&
+         a_units.viscosity == b_units.viscosity &&
+         a_units.density == b_units.density;
+}
+
+}  // namespace
+
+GraphView::GraphView(std::shared_ptr<const CalculatorView> calculator_view,
+                     utils::JobSystem &jobs)
+    : calculator_view_(std::move(calculator_view)), jobs_(jobs) {
+  water_.label = "Water";
+  water_.color = IM_COL32(128, 128, 128, 255);
+  head_.label = "H_vis / H_w";
+  head_.color = IM_COL32(235, 125, 20, 255);
+  efficiency_.label = "eta_vis / eta_w";
+  efficiency_.color = IM_COL32(45, 110, 220, 255);
+  for (Series *series : {&water_, &head_, &efficiency_}) {
+    series->points.assign(std::size(kFlowRatios), ImVec2(0.0f, kNaN));
+    series->screen.resize(std::size(kFlowRatios));
+  }
+
+  sweep_q_.label = "C_Q";
+  sweep_q_.color = IM_COL32(40, 160, 70, 255);
+  sweep_eta_.label = "C_eta";
+  sweep_eta_.color = efficiency_.color;
+  sweep_h_.label = "C_H (1.0 x Q_opt)";
+  sweep_h_.color = head_.color;
+  ResizeSweep();
+}
+
+GraphView::~GraphView() { sweep_job_.Cancel(); }
+
+bool GraphView::InputsChanged() {
+  const vccore::Parameters &params = calculator_view_->params();
+  const vccore::Units &units = calculator_view_->units();
+  const SweepDefinition &sweep = calculator_view_->sweep();
+  const bool same_sweep = sweep == sweep_;
+  if (initialized_ && same_sweep && SameInputs(params, units, params_, units_))
+    return false;
+
+  params_ = params;
+  units_ = units;
+  initialized_ = true;
+  if (!same_sweep) {
+    sweep_ = sweep;
+    ResizeSweep();
+  }
+  return true;
+}
+
+void GraphView::ResizeSweep() {
+  // Viscosities outside of the chart have no factors
+  double min = std::clamp(sweep_.viscosity_min, batch::kMinViscosity,
+                          batch::kMaxViscosity);
+  double max = std::clamp(sweep_.viscosity_max, batch::kMinViscosity,
+                          batch::kMaxViscosity);
+  if (!(min < max)) {
+    min = batch::kMinViscosity;
+    max = batch::kMaxViscosity;
+  }
+  const std::size_t samples = std::clamp<std::size_t>(
+      sweep_.samples, 2, SweepDefinition::kMaxSamples);
+
+  const float log_min = std::log10(static_cast<float>(min));
+  const float log_max = std::log10(static_cast<float>(max));
+  for (Series *series : {&sweep_q_, &sweep_eta_, &sweep_h_}) {
+    series->points.resize(samples);
+    series->screen.resize(samples);
+    for (std::size_t i = 0; i < samples; i++) {
+      float x = log_min + (log_max - log_min) * static_cast<float>(i) /
+                              static_cast<float>(samples - 1);
+      series->points[i] = ImVec2(x, kNaN);
+    }
+    series->dirty = true;
+  }
+}
+
+void GraphView::RebuildFlowCurves() {
+  const vccore::CorrectionFactors factors =
+      calculator_.Calculate(params_, units_);
+  const bool valid = !factors.error_flag;
+
+  // The corrected curves are relative to the water curve: the flow is scaled
+  // by C_Q, the head by C_H of the flow and the efficiency by C_eta
+  for (std::size_t i = 0; i < std::size(kFlowRatios); i++) {
+    const float flow = kFlowRatios[i] * static_cast<float>(factors.q);
+    water_.points[i] = ImVec2(kFlowRatios[i], 1.0f);
+    head_.points[i] =
+        ImVec2(flow, valid ? static_cast<float>(factors.h.at(i)) : kNaN);
+    efficiency_.points[i] =
+        ImVec2(flow, valid ? static_cast<float>(factors.eta) : kNaN);
+  }
+  water_.dirty = head_.dirty = efficiency_.dirty = true;
+
+  const vccore::Parameters canonical =
+      batch::Normalise(params_, batch::GetUnitScale(units_));
+  current_viscosity_ = (canonical.viscosity > 0.0)
+                           ? std::log10(static_cast<float>(canonical.viscosity))
+                           : kNaN;
+}
+
+void GraphView::StartSweep() {
+  sweep_job_.Cancel();
+  const std::uint64_t generation = ++sweep_generation_;
+
+  // The sweep runs in mm^2/s, so the density does not matter
+  vccore::Parameters params = params_;
+  vccore::Units units = units_;
+  units.viscosity = static_cast<vccore::ViscosityUnit>(0);
+
+  const std::size_t samples = sweep_q_.points.size();
+  const double log_min = sweep_q_.points.front().x;
+  const double log_max = sweep_q_.points.back().x;
+  auto factors =
+      std::make_shared<std::vector<vccore::CorrectionFactors>>(samples);
+
+  sweep_job_ = jobs_.Submit(
+      [params, units, samples, log_min, log_max,
+       factors](utils::Job &job) mutable {
+        vccore::Calculator calculator;
+        for (std::size_t i = 0; i < samples && !job.cancelled(); i++) {
+          params.viscosity = std::pow(
+              10.0, log_min + (log_max - log_min) * static_cast<double>(i) /
+                                  static_cast<double>(samples - 1));
+          (*factors)[i] = calculator.Calculate(params, units);
+          if (i % 64 == 0)
+            job.set_progress(static_cast<float>(i) /
+                             static_cast<float>(samples));
+        }
+      },
+      [this, generation, factors](utils::JobStatus status) {
+        // Older sweeps may finish before their cancellation was seen
+        if (generation != sweep_generation_) return;
+        sweep_job_.reset();
+        if (status == utils::JobStatus::kFinished) ApplySweep(*factors);
+      });
+}
+
+void GraphView::ApplySweep(
+    const std::vector<vccore::CorrectionFactors> &factors) {
+  for (std::size_t i = 0; i < factors.size(); i++) {
+    const bool valid = !factors[i].error_flag;
+    sweep_q_.points[i].y = valid ? static_cast<float>(factors[i].q) : kNaN;
+    sweep_eta_.points[i].y = valid ? static_cast<float>(factors[i].eta) : kNaN;
+    sweep_h_.points[i].y =
+        valid ? static_cast<float>(factors[i].h.at(2)) : kNaN;
+  }
+  sweep_q_.dirty = sweep_eta_.dirty = sweep_h_.dirty = true;
+}
+
+void GraphView::OnEvent(const utils::Event &event) {
+  if (std::holds_alternative<utils::InputChangedEvent>(event)) {
+    inputs_dirty_ = true;
+  } else if (const auto *mode =
+                 std::get_if<utils::WorkspaceModeChangedEvent>(&event)) {
+    // Fixed windows go back to their place next to the calculator
+    if (!mode->open) reset_layout_ = true;
+  } else if (const auto *theme =
+                 std::get_if<utils::ThemeChangedEvent>(&event)) {
+    // Keeps the water curve readable on the dark background
+    water_.color = theme->dark_mode ? IM_COL32(190, 190, 190, 255)
+                                    : IM_COL32(128, 128, 128, 255);
+  }
+}
+
+void GraphView::OnUIRender(const ImGuiWindowFlags &flags) {
+  // The inputs are only compared after the calculator view reported a change
+  if (inputs_dirty_) {
+    inputs_dirty_ = false;
+    if (InputsChanged()) {
+      RebuildFlowCurves();
+      StartSweep();
+    }
+  }
+
+  // Right of the calculator unless the user moved it
+  const ImGuiCond layout_cond =
+      reset_layout_ ? ImGuiCond_Always : ImGuiCond_FirstUseEver;
+  reset_layout_ = false;
+  const ImVec2 work_pos = ImGui::GetMainViewport()->WorkPos;
+  ImGui::SetNextWindowPos(ImVec2(work_pos.x + 445.0f, work_pos.y),
+                          layout_cond);
+  ImGui::SetNextWindowSize(ImVec2(445.0f, 650.0f), layout_cond);
+  ImGui::Begin("Graph", nullptr, flags);
+
+  const float line_height = ImGui::GetTextLineHeightWithSpacing();
+  const ImVec2 available = ImGui::GetContentRegionAvail();
+  const ImVec2 plot_size(available.x,
+                         std::max((available.y - 6.0f * line_height) * 0.5f,
+                                  4.0f * line_height));
+
+  Series *flow_series[] = {&water_, &head_, &efficiency_};
+  ImGui::TextUnformatted("Corrected curves over Q / Q_opt");
+  DrawPlot("##flow", plot_size, {0.5f, 1.3f, 0.0f, 1.1f}, flow_series,
+           std::size(flow_series), kNaN);
+  Legend(flow_series, std::size(flow_series));
+
+  Series *sweep_series[] = {&sweep_q_, &sweep_eta_, &sweep_h_};
+  ImGui::TextUnformatted("Correction factors over viscosity in mm^2/s");
+  DrawPlot("##sweep", plot_size,
+           {sweep_q_.points.front().x, sweep_q_.points.back().x, 0.0f, 1.1f},
+           sweep_series, std::size(sweep_series), current_viscosity_);
+  Legend(sweep_series, std::size(sweep_series));
+
+  if (std::isnan(head_.points.front().y))
+    ImGui::TextDisabled("The operating point is outside of the chart");
+  else if (!sweep_complete())
+    ImGui::ProgressBar(sweep_job_.progress(), ImVec2(-1.0f, 0.0f));
+
+  ImGui::End();
+}
+
+void GraphView::DrawPlot(const char *id, const ImVec2 &size,
+                         const PlotRange &range, Series *const *series,
+                         std::size_t count, float marker_x) {
+  const ImVec2 origin = ImGui::GetCursorScreenPos();
+  ImGui::InvisibleButton(id, size);
+
+  ImDrawList *draw_list = ImGui::GetWindowDrawList();
+  const ImVec2 corner(origin.x + size.x, origin.y + size.y);
+  draw_list->AddRectFilled(origin, corner,
+                           ImGui::GetColorU32(ImGuiCol_FrameBg));
+  draw_list->AddRect(origin, corner, ImGui::GetColorU32(ImGuiCol_Border));
+
+  const float scale_x = size.x / (range.x_max - range.x_min);
+  const float scale_y = size.y / (range.y_max - range.y_min);
+
+  // Horizontal grid every 0.25
+  const ImU32 grid_color = ImGui::GetColorU32(ImGuiCol_TableBorderLight);
+  for (float y = 0.25f; y < range.y_max; y += 0.25f) {
+    const float screen_y = corner.y - (y - range.y_min) * scale_y;
+    draw_list->AddLine(ImVec2(origin.x, screen_y), ImVec2(corner.x, screen_y),
+                       grid_color);
+  }
+
+  for (std::size_t s = 0; s < count; s++) {
+    Series &curve = *series[s];
+
+    // The screen positions only change with the samples or the plot area
+    if (curve.dirty || curve.origin.x != origin.x ||
+        curve.origin.y != origin.y || curve.size.x != size.x ||
+        curve.size.y != size.y) {
+      for (std::size_t i = 0; i < curve.points.size(); i++) {
+        curve.screen[i] =
+            ImVec2(origin.x + (curve.points[i].x - range.x_min) * scale_x,
+                   corner.y - (curve.points[i].y - range.y_min) * scale_y);
+      }
+      curve.origin = origin;
+      curve.size = size;
+      curve.dirty = false;
+    }
+
+    // Draw every run of valid samples as its own polyline
+    const std::size_t samples = curve.points.size();
+    std::size_t begin = 0;
+    while (begin < samples) {
+      while (begin < samples && std::isnan(curve.points[begin].y)) begin++;
+      std::size_t end = begin;
+      while (end < samples && !std::isnan(curve.points[end].y)) end++;
+      if (end - begin >= 2)
+        draw_list->AddPolyline(&curve.screen[begin],
+                               static_cast<int>(end - begin), curve.color, 0,
+                               2.0f);
+      begin = end;
+    }
+  }
+
+  if (!std::isnan(marker_x) && marker_x >= range.x_min &&
+      marker_x <= range.x_max) {
+    const float screen_x = origin.x + (marker_x - range.x_min) * scale_x;
+    draw_list->AddLine(ImVec2(screen_x, origin.y), ImVec2(screen_x, corner.y),
+                       ImGui::GetColorU32(ImGuiCol_PlotLinesHovered));
+  }
+}
+
+void GraphView::Legend(Series *const *series, std::size_t count) {
+  for (std::size_t s = 0; s < count; s++) {
+    if (s != 0) ImGui::SameLine();
+    ImGui::TextColored(ImGui::ColorConvertU32ToFloat4(series[s]->color), "%s",
+                       series[s]->label);
+  }
+}
+
+}  // namespace visco
+
+}  // namespace spauly
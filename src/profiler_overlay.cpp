@@ -0,0 +1,96 @@
+// Visco Correct Desktop - Correction factors for centrifugal pumps
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Visco-Correct-Desktop>
+#include "spauly/visco/profiler_overlay.h"
+
+#include <imgui.h>
+
+#include <memory_resource>
+#include <vector>
+
+namespace spauly {
+namespace visco {
+
+void ProfilerOverlay::OnUIRender(const ImGuiWindowFlags &flags) {
+  ImGui::SetNextWindowBgAlpha(0.85f);
+  ImGui::Begin("Profiler", nullptr, ImGuiWindowFlags_AlwaysAutoResize);
+
+  utils::Profiler &profiler = utils::Profiler::Get();
+  // Only needed until the frame is rendered
+  std::pmr::vector<utils::Profiler::ScopeStats> stats(&frame_arena());
+  profiler.CollectStats(stats);
+
+  ImGui::Text("Frames: %llu (window %zu)",
+              static_cast<unsigned long long>(profiler.frame_count()),
+              utils::Profiler::kWindowFrames);
+
+  // Steady-state frames should not allocate at all
+  const utils::Profiler::AllocationStats allocations =
+      profiler.allocation_stats();
+  ImGui::Text("Heap allocations per frame: %llu (max %llu)",
+              static_cast<unsigned long long>(allocations.last),
+              static_cast<unsigned long long>(allocations.max));
+  const utils::FrameArena &arena = frame_arena();
+  ImGui::Text("Frame arena: %zu of %zu KiB (peak %zu KiB)",
+              arena.used() / 1024, arena.capacity() / 1024,
+              arena.peak() / 1024);
+
+  if (ImGui::BeginTable("##scopes", 6,
+                        ImGuiTableFlags_RowBg | ImGuiTableFlags_Borders |
+                            ImGuiTableFlags_SizingFixedFit)) {
+    ImGui::TableSetupColumn("Scope");
+    ImGui::TableSetupColumn("last ms");
+    ImGui::TableSetupColumn("p50");
+    ImGui::TableSetupColumn("p95");
+    ImGui::TableSetupColumn("p99");
+    ImGui::TableSetupColumn("max");
+    ImGui::TableHeadersRow();
+
+    for (const auto &scope : stats) {
+      ImGui::TableNextRow();
+      ImGui::TableNextColumn();
+      ImGui::TextUnformatted(scope.name);
+      ImGui::TableNextColumn();
+      ImGui::Text("%.3f", scope.last);
+      ImGui::TableNextColumn();
+      ImGui::Text("%.3f", scope.p50);
+      ImGui::TableNextColumn();
+      ImGui::Text("%.3f", scope.p95);
+      ImGui::TableNextColumn();
+      ImGui::Text("%.3f", scope.p99);
+      ImGui::TableNextColumn();
+      ImGui::Text("%.3f", scope.max);
+    }
+    ImGui::EndTable();
+  }
+
+  if (ImGui::Button("Export trace")) {
+    status_ = profiler.ExportChromeTrace(kTracePath)
+                  ? std::string("Written to ") + kTracePath
+                  : std::string("Could not write ") + kTracePath;
+  }
+  if (!status_.empty()) {
+    ImGui::SameLine();
+    ImGui::TextUnformatted(status_.c_str());
+  }
+
+  ImGui::End();
+}
+
+}  // namespace visco
+
+}  // namespace spauly
@@ -0,0 +1,344 @@
+// Visco Correct Desktop - Correction factors for centrifugal pumps
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Visco-Correct-Desktop>
+#include "spauly/visco/project_file.h"
+
+#include <bit>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <system_error>
+#include <utility>
+
+#include "spauly/visco/batch/mapped_file.h"
+
+namespace spauly {
+namespace visco {
+
+namespace {
+
+constexpr char kMagic[4] = {'V', 'C', 'P', 'J'};
+
+struct FileHeader {
+  char magic[4];
+  std::uint32_t version;
+  std::uint32_t record_size;
+  std::uint32_t count;
+  std::uint64_t reserved[2];
+};
+
+static_assert(sizeof(FileHeader) == 32,
+              "The on-disk header must not contain padding");
+
+// Number of enumerators per unit, in the order of the combo boxes
+constexpr std::uint8_t kUnitCounts[4] = {3, 2, 4, 2};
+
+FileHeader MakeHeader(std::size_t count) {
+  FileHeader header = {};
+  std::memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kProjectFileVersion;
+  header.record_size = sizeof(ProjectRecord);
+  header.count = static_cast<std::uint32_t>(count);
+  return header;
+}
+
+/// @brief Writes the header and records to a temporary file and moves it
+/// over path.
+bool WriteFile(const std::string &path, const ProjectRecord *records,
+               std::size_t count) {
+  const std::string temp_path = path + ".tmp";
+  std::FILE *file = std::fopen(temp_path.c_str(), "wb");
+  if (!file) return false;
+
+  const FileHeader header = MakeHeader(count);
+  bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1 &&
+            std::fwrite(records, sizeof(ProjectRecord), count, file) == count;
+  ok = (std::fclose(file) == 0) && ok;
+
+  std::error_code error;
+  if (ok) std::filesystem::rename(temp_path, path, error);
+  if (!ok || error) {
+    std::filesystem::remove(temp_path, error);
+    return false;
+  }
+  return true;
+}
+
+/// @brief Overwrites single records of an existing file.
+bool PatchFile(const std::string &path,
+               const std::vector<std::pair<std::size_t, ProjectRecord>> &
+                   records) {
+  std::FILE *file = std::fopen(path.c_str(), "r+b");
+  if (!file) return false;
+
+  bool ok = true;
+  for (const auto &[index, record] : records) {
+    const long offset =
+        static_cast<long>(sizeof(FileHeader) + index * sizeof(ProjectRecord));
+    ok = ok && std::fseek(file, offset, SEEK_SET) == 0 &&
+         std::fwrite(&record, sizeof(record), 1, file) == 1;
+  }
+  return (std::fclose(file) == 0) && ok;
+}
+
+/// @brief Prints a string with JSON escapes.
+void WriteJsonString(std::FILE *file, const char *text, std::size_t size) {
+  std::fputc('"', file);
+  for (std::size_t i = 0; i < size && text[i] != '\0'; i++) {
+    const unsigned char c = static_cast<unsigned char>(text[i]);
+    if (c == '"' || c == '\\')
+      std::fprintf(file, "\\%c", c);
+    else if (c < 0x20)
+      std::fprintf(file, "\\u%04x", c);
+    else
+      std::fputc(c, file);
+  }
+  std::fputc('"', file);
+}
+
+/// @brief Prints a number, JSON has no representation for NaN and infinity.
+void WriteJsonNumber(std::FILE *file, double value) {
+  if (std::isfinite(value))
+    std::fprintf(file, "%.17g", value);
+  else
+    std::fputs("null", file);
+}
+
+}  // namespace
+
+ProjectRecord ToRecord(const Project &project) {
+  ProjectRecord record = {};
+  record.id = project.id;
+  record.error_flag = static_cast<std::int32_t>(project.result.error_flag);
+  record.units[0] = static_cast<std::uint8_t>(project.units.flowrate);
+  record.units[1] = static_cast<std::uint8_t>(project.units.total_head);
+  record.units[2] = static_cast<std::uint8_t>(project.units.viscosity);
+  record.units[3] = static_cast<std::uint8_t>(project.units.density);
+  record.sweep_samples = project.sweep.samples;
+  std::memcpy(record.title, project.title, sizeof(record.title));
+  record.title[sizeof(record.title) - 1] = '\0';
+
+  record.params[0] = project.params.flowrate;
+  record.params[1] = project.params.total_head;
+  record.params[2] = project.params.viscosity;
+  record.params[3] = project.params.density;
+  record.result[0] = project.result.eta;
+  record.result[1] = project.result.q;
+  for (std::size_t i = 0; i < 4; i++)
+    record.result[2 + i] = project.result.h.at(i);
+  record.sweep[0] = project.sweep.viscosity_min;
+  record.sweep[1] = project.sweep.viscosity_max;
+  return record;
+}
+
+bool FromRecord(const ProjectRecord &record, Project &project) {
+  for (std::size_t i = 0; i < 4; i++)
+    if (record.units[i] >= kUnitCounts[i]) return false;
+
+  project.id = record.id;
+  std::memcpy(project.title, record.title, sizeof(project.title));
+  project.title[sizeof(project.title) - 1] = '\0';
+
+  project.units.flowrate = static_cast<vccore::FlowrateUnit>(record.units[0]);
+  project.units.total_head =
+      static_cast<vccore::TotalHeadUnit>(record.units[1]);
+  project.units.viscosity =
+      static_cast<vccore::ViscosityUnit>(record.units[2]);
+  project.units.density = static_cast<vccore::DensityUnit>(record.units[3]);
+
+  project.params.flowrate = record.params[0];
+  project.params.total_head = record.params[1];
+  project.params.viscosity = record.params[2];
+  project.params.density = record.params[3];
+  project.result.eta = record.result[0];
+  project.result.q = record.result[1];
+  for (std::size_t i = 0; i < 4; i++)
+    project.result.h.at(i) = record.result[2 + i];
+  project.result.error_flag =
+      static_cast<decltype(project.result.error_flag)>(record.error_flag);
+
+  project.sweep.viscosity_min = record.sweep[0];
+  project.sweep.viscosity_max = record.sweep[1];
+  project.sweep.samples = record.sweep_samples;
+  return true;
+}
+
+bool SaveProjects(const ProjectStore &store, const std::string &path) {
+  if (std::endian::native != std::endian::little) return false;
+
+  std::vector<ProjectRecord> records;
+  records.reserve(store.size());
+  for (const Project &project : store) records.push_back(ToRecord(project));
+  return WriteFile(path, records.data(), records.size());
+}
+
+bool LoadProjects(const std::string &path, ProjectStore &store) {
+  batch::MappedFile file;
+  if (std::endian::native != std::endian::little || !file.Open(path))
+    return false;
+
+  FileHeader header;
+  if (file.size() < sizeof(header)) return false;
+  std::memcpy(&header, file.data(), sizeof(header));
+
+  if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 ||
+      header.version != kProjectFileVersion ||
+      header.record_size < sizeof(ProjectRecord) ||
+      (file.size() - sizeof(header)) / header.record_size < header.count)
+    return false;
+
+  ProjectStore loaded;
+  loaded.reserve(header.count);
+  const unsigned char *data = file.data() + sizeof(header);
+  for (std::uint32_t i = 0; i < header.count; i++) {
+    ProjectRecord record;
+    std::memcpy(&record, data + std::size_t{i} * header.record_size,
+                sizeof(record));
+
+    Project project;
+    if (!FromRecord(record, project) || !loaded.Insert(project)) return false;
+  }
+
+  store = std::move(loaded);
+  return true;
+}
+
+bool ExportProjectsJson(const ProjectStore &store, const std::string &path) {
+  std::FILE *file = std::fopen(path.c_str(), "w");
+  if (!file) return false;
+
+  std::fprintf(file, "{\n  \"version\": %u,\n  \"projects\": [",
+               kProjectFileVersion);
+  bool first = true;
+  for (const Project &project : store) {
+    // The part after ### only keeps the window id stable
+    const char *separator = std::strstr(project.title, "###");
+    const std::size_t name_size = separator
+                                      ? separator - project.title
+                                      : std::strlen(project.title);
+
+    std::fprintf(file, "%s\n    {\n      \"id\": %u,\n      \"name\": ",
+                 first ? "" : ",", project.id);
+    WriteJsonString(file, project.title, name_size);
+    first = false;
+
+    std::fputs(",\n      \"params\": {\"flowrate\": ", file);
+    WriteJsonNumber(file, project.params.flowrate);
+    std::fputs(", \"total_head\": ", file);
+    WriteJsonNumber(file, project.params.total_head);
+    std::fputs(", \"viscosity\": ", file);
+    WriteJsonNumber(file, project.params.viscosity);
+    std::fputs(", \"density\": ", file);
+    WriteJsonNumber(file, project.params.density);
+
+    std::fprintf(file,
+                 "},\n      \"units\": {\"flowrate\": %d, \"total_head\": %d, "
+                 "\"viscosity\": %d, \"density\": %d},\n",
+                 static_cast<int>(project.units.flowrate),
+                 static_cast<int>(project.units.total_head),
+                 static_cast<int>(project.units.viscosity),
+                 static_cast<int>(project.units.density));
+
+    std::fputs("      \"result\": {\"eta\": ", file);
+    WriteJsonNumber(file, project.result.eta);
+    std::fputs(", \"q\": ", file);
+    WriteJsonNumber(file, project.result.q);
+    std::fputs(", \"h\": [", file);
+    for (std::size_t i = 0; i < 4; i++) {
+      if (i != 0) std::fputs(", ", file);
+      WriteJsonNumber(file, project.result.h.at(i));
+    }
+    std::fprintf(file, "], \"error_flag\": %d},\n",
+                 static_cast<int>(project.result.error_flag));
+
+    std::fputs("      \"sweep\": {\"viscosity_min\": ", file);
+    WriteJsonNumber(file, project.sweep.viscosity_min);
+    std::fputs(", \"viscosity_max\": ", file);
+    WriteJsonNumber(file, project.sweep.viscosity_max);
+    std::fprintf(file, ", \"samples\": %u}\n    }", project.sweep.samples);
+  }
+  std::fputs("\n  ]\n}\n", file);
+
+  const bool ok = !std::ferror(file);
+  return (std::fclose(file) == 0) && ok;
+}
+
+ProjectAutosaver::ProjectAutosaver(utils::JobSystem &jobs, std::string path,
+                                   Clock::duration interval)
+    : jobs_(jobs), path_(std::move(path)), interval_(interval) {}
+
+void ProjectAutosaver::Update(const ProjectStore &store,
+                              Clock::time_point now) {
+  if (now < next_save_ || (job_.valid() && !job_.done())) return;
+  next_save_ = now + interval_;
+
+  current_.clear();
+  for (const Project &project : store) current_.push_back(ToRecord(project));
+
+  // Records are compared bytewise, the layout has no padding
+  bool full = rewrite_ || current_.size() != saved_.size();
+  for (std::size_t i = 0; !full && i < current_.size(); i++)
+    full = current_[i].id != saved_[i].id;
+
+  struct Save {
+    bool full = false;
+    std::vector<ProjectRecord> records;
+    std::vector<std::pair<std::size_t, ProjectRecord>> changes;
+    bool ok = false;
+  };
+  auto save = std::make_shared<Save>();
+  save->full = full;
+  if (full) {
+    save->records = current_;
+  } else {
+    for (std::size_t i = 0; i < current_.size(); i++)
+      if (std::memcmp(&current_[i], &saved_[i], sizeof(ProjectRecord)) != 0)
+        save->changes.emplace_back(i, current_[i]);
+    if (save->changes.empty()) return;
+  }
+
+  job_ = jobs_.Submit(
+      [path = path_, save](utils::Job &) {
+        save->ok = save->full ? WriteFile(path, save->records.data(),
+                                          save->records.size())
+                              : PatchFile(path, save->changes);
+      },
+      [this, save](utils::JobStatus status) {
+        job_.reset();
+        if (status != utils::JobStatus::kFinished || !save->ok) {
+          // Rewrite everything next time, the file state is unknown
+          rewrite_ = true;
+          return;
+        }
+        if (save->full) {
+          saved_ = std::move(save->records);
+          rewrite_ = false;
+          records_written_ += saved_.size();
+          full_writes_++;
+        } else {
+          for (const auto &[index, record] : save->changes)
+            saved_[index] = record;
+          records_written_ += save->changes.size();
+        }
+      });
+}
+
+}  // namespace visco
+
+}  // namespace spauly
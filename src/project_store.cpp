@@ -0,0 +1,74 @@
+// Visco Correct Desktop - Correction factors for centrifugal pumps
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Visco-Correct-Desktop>
+#include "spauly/visco/project_store.h"
+
+#include <algorithm>
+#include <cstdio>
+
+namespace spauly {
+namespace visco {
+
+Project &ProjectStore::Add(const char *name) {
+  Project &project = projects_.emplace_back();
+  project.id = next_id_++;
+  if (name)
+    std::snprintf(project.title, sizeof(project.title), "%s###Project%u", name,
+                  project.id);
+  else
+    std::snprintf(project.title, sizeof(project.title),
+                  "Project %u###Project%u", project.id, project.id);
+  return project;
+}
+
+Project *ProjectStore::Insert(const Project &project) {
+  // Ids above all current ones can not be in use, which is the case for
+  // projects inserted in the order they were added
+  if (project.id == kInvalidId || (project.id < next_id_ && Find(project.id)))
+    return nullptr;
+
+  Project &inserted = projects_.emplace_back(project);
+  inserted.title[Project::kTitleSize - 1] = '\0';
+  next_id_ = std::max(next_id_, project.id + 1);
+  return &inserted;
+}
+
+bool ProjectStore::Remove(ProjectId id) {
+  auto it = std::find_if(projects_.begin(), projects_.end(),
+                         [id](const Project &p) { return p.id == id; });
+  if (it == projects_.end()) return false;
+
+  // Keeps the order, so the tabs do not jump around
+  projects_.erase(it);
+  return true;
+}
+
+Project *ProjectStore::Find(ProjectId id) {
+  for (Project &project : projects_)
+    if (project.id == id) return &project;
+  return nullptr;
+}
+
+const Project *ProjectStore::Find(ProjectId id) const {
+  for (const Project &project : projects_)
+    if (project.id == id) return &project;
+  return nullptr;
+}
+
+}  // namespace visco
+
+}  // namespace spauly
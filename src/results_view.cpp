@@ -0,0 +1,319 @@
+// Visco Correct Desktop - Correction factors for centrifugal pumps
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Visco-Correct-Desktop>
+#include "spauly/visco/results_view.h"
+
+#include <imgui.h>
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+#include "spauly/vccore/data.h"
+#include "spauly/visco/batch/binary_format.h"
+
+namespace spauly {
+namespace visco {
+
+namespace {
+
+constexpr const char *kColumnNames[] = {"Q",     "H",     "v",     "rho",
+                                        "eta",   "q",     "h 0.6", "h 0.8",
+                                        "h 1.0", "h 1.2", "flags"};
+
+// Rows moved per mouse wheel step
+constexpr float kWheelRows = 3.0f;
+
+template <typename T>
+void Append(std::vector<T> &column, std::span<const T> values) {
+  column.insert(column.end(), values.begin(), values.end());
+}
+
+}  // namespace
+
+bool LoadResultTable(const std::string &results_path,
+                     const std::string &inputs_path, ResultTable &table) {
+  batch::DatasetReader reader;
+  if (!reader.Open(results_path) ||
+      reader.kind() != batch::DatasetKind::kResults)
+    return false;
+
+  table = ResultTable();
+  batch::SoaResults &results = table.results;
+  const auto rows = static_cast<std::size_t>(reader.rows());
+  results.eta.reserve(rows);
+  results.q.reserve(rows);
+  for (auto &h : results.h) h.reserve(rows);
+  results.error_flag.reserve(rows);
+
+  batch::ResultColumns columns;
+  while (reader.NextBlock(columns)) {
+    Append(results.eta, columns.eta);
+    Append(results.q, columns.q);
+    for (std::size_t i = 0; i < results.h.size(); i++)
+      Append(results.h[i], columns.h[i]);
+    Append(results.error_flag, columns.error_flag);
+  }
+  if (reader.Failed()) return false;
+
+  // The inputs are optional
+  batch::DatasetReader inputs;
+  if (inputs_path.empty() || !inputs.Open(inputs_path) ||
+      inputs.kind() != batch::DatasetKind::kInputs ||
+      inputs.rows() != results.size())
+    return true;
+
+  for (auto &column : table.inputs) column.reserve(results.size());
+  vccore::Units units;
+  batch::SoaInput in;
+  while (inputs.NextBlock(units, in)) {
+    Append(table.inputs[0], in.flowrate);
+    Append(table.inputs[1], in.total_head);
+    Append(table.inputs[2], in.viscosity);
+    // Kinematic viscosities may be stored without density
+    if (in.density.empty())
+      table.inputs[3].resize(table.inputs[3].size() + in.size(),
+                             std::nan(""));
+    else
+      Append(table.inputs[3], in.density);
+  }
+  if (inputs.Failed() || table.inputs[0].size() != results.size())
+    for (auto &column : table.inputs) column = {};
+  return true;
+}
+
+ResultsView::ResultsView(utils::JobSystem &jobs) : jobs_(jobs) {}
+
+void ResultsView::SetTable(std::shared_ptr<const ResultTable> table) {
+  table_ = std::move(table);
+  order_.clear();
+  first_row_ = 0;
+  RebuildIndex();
+}
+
+std::span<const double> ResultsView::Values(const ResultTable &table,
+                                            int column) {
+  if (column >= kColumnFlowrate && column <= kColumnDensity)
+    return table.inputs[column - kColumnFlowrate];
+  switch (column) {
+    case kColumnEta:
+      return table.results.eta;
+    case kColumnQ:
+      return table.results.q;
+    case kColumnH06:
+    case kColumnH08:
+    case kColumnH10:
+    case kColumnH12:
+      return table.results.h[column - kColumnH06];
+    default:
+      return {};
+  }
+}
+
+void ResultsView::Load() {
+  if (load_job_.valid()) return;
+
+  status_ = "Loading...";
+  auto table = std::make_shared<ResultTable>();
+  auto ok = std::make_shared<bool>(false);
+  load_job_ = jobs_.Submit(
+      [table, ok, results = std::string(results_path_),
+       inputs = std::string(inputs_path_)](utils::Job &) {
+        *ok = LoadResultTable(results, inputs, *table);
+      },
+      [this, table, ok](utils::JobStatus status) {
+        load_job_.reset();
+        if (status != utils::JobStatus::kFinished || !*ok) {
+          status_ = "The results could not be read";
+          return;
+        }
+        status_ = table->has_inputs() ? "" : "Loaded without inputs";
+        SetTable(table);
+      });
+}
+
+void ResultsView::RebuildIndex() {
+  if (!table_) return;
+
+  const std::uint64_t generation = ++generation_;
+  if (index_job_.valid()) index_job_.Cancel();
+
+  auto order = std::make_shared<std::vector<std::uint32_t>>();
+  index_job_ = jobs_.Submit(
+      [table = table_, pool = &jobs_.pool(), order, filter = filter_,
+       column = sort_column_, descending = descending_](utils::Job &) {
+        const batch::SoaResults &results = table->results;
+        *order = batch::FilterRows(results.error_flag, filter);
+        if (column == kColumnFlags) {
+          batch::SortRows(*order, results.error_flag, descending,
+                          pool);
+          return;
+        }
+        const std::span<const double> key = Values(*table, column);
+        if (!key.empty())
+          batch::SortRows(*order, key, descending, pool);
+      },
+      [this, generation, order](utils::JobStatus status) {
+        if (generation != generation_) return;
+        index_job_.reset();
+        if (status == utils::JobStatus::kFinished) order_.swap(*order);
+      });
+}
+
+void ResultsView::OnUIRender(const ImGuiWindowFlags &flags) {
+  ImGui::SetNextWindowSize(ImVec2(720.0f, 520.0f), ImGuiCond_FirstUseEver);
+  if (!ImGui::Begin("Results", nullptr, flags)) {
+    ImGui::End();
+    return;
+  }
+
+  ImGui::PushItemWidth(200.0f);
+  ImGui::InputText("Results", results_path_, sizeof(results_path_));
+  ImGui::SameLine();
+  ImGui::InputText("Inputs", inputs_path_, sizeof(inputs_path_));
+  ImGui::PopItemWidth();
+  ImGui::SameLine();
+  if (ImGui::Button("Load")) Load();
+
+  bool filter_changed = false;
+  ImGui::SetNextItemWidth(140.0f);
+  filter_changed |= ImGui::Combo("##filter",
+                                 reinterpret_cast<int *>(&filter_.mode),
+                                 "All rows\0Valid rows\0Rows with errors\0\0");
+  if (filter_.mode == batch::FlagFilter::kErrors) {
+    constexpr std::pair<const char *, vccore::ErrorFlag> kBits[] = {
+        {"Q", vccore::ErrorFlag::kFlowrateError},
+        {"H", vccore::ErrorFlag::kTotalHeadError},
+        {"v", vccore::ErrorFlag::kViscosityError}};
+    for (const auto &[label, bit] : kBits) {
+      ImGui::SameLine();
+      filter_changed |= ImGui::CheckboxFlags(label, &filter_.bits,
+                                             static_cast<int>(bit));
+    }
+  }
+  if (filter_changed) RebuildIndex();
+
+  if (table_) {
+    ImGui::SameLine();
+    ImGui::Text("%zu of %zu rows", order_.size(), table_->size());
+    if (index_job_.valid()) {
+      ImGui::SameLine();
+      ImGui::TextDisabled("(sorting...)");
+    }
+  }
+  if (*status_ != '\0') ImGui::TextUnformatted(status_);
+
+  if (table_) Table();
+
+  ImGui::End();
+}
+
+void ResultsView::Table() {
+  // ImGui places items with float coordinates, at some million rows their
+  // precision is too coarse for a scrolled table. So the table only ever
+  // holds one page of rows and the position is kept here as an index.
+  const float row_height = ImGui::GetTextLineHeightWithSpacing();
+  const ImVec2 region = ImGui::GetContentRegionAvail();
+  const float slider_width = ImGui::GetFrameHeight();
+  const auto page = static_cast<std::size_t>(
+      std::max(region.y / row_height - 1.0f, 1.0f));
+  const std::size_t count = order_.size();
+  const std::size_t last_first = (count > page) ? count - page : 0;
+
+  if (ImGui::IsWindowHovered(ImGuiHoveredFlags_ChildWindows)) {
+    const float wheel = ImGui::GetIO().MouseWheel;
+    const auto steps = static_cast<std::size_t>(
+        std::abs(wheel) * kWheelRows + 0.5f);
+    if (wheel > 0.0f)
+      first_row_ -= std::min(first_row_, steps);
+    else if (wheel < 0.0f)
+      first_row_ += steps;
+  }
+  if (ImGui::IsWindowFocused(ImGuiFocusedFlags_RootAndChildWindows) &&
+      !ImGui::GetIO().WantTextInput) {
+    if (ImGui::IsKeyPressed(ImGuiKey_PageUp))
+      first_row_ -= std::min(first_row_, page);
+    if (ImGui::IsKeyPressed(ImGuiKey_PageDown)) first_row_ += page;
+    if (ImGui::IsKeyPressed(ImGuiKey_Home)) first_row_ = 0;
+    if (ImGui::IsKeyPressed(ImGuiKey_End)) first_row_ = last_first;
+  }
+  first_row_ = std::min(first_row_, last_first);
+
+  constexpr ImGuiTableFlags kTableFlags =
+      ImGuiTableFlags_Sortable | ImGuiTableFlags_SortTristate |
+      ImGuiTableFlags_RowBg | ImGuiTableFlags_Borders |
+      ImGuiTableFlags_Resizable;
+  const bool inputs = table_->has_inputs();
+  const int first_column = inputs ? kColumnFlowrate : kColumnEta;
+
+  ImGui::BeginChild("##rows", ImVec2(region.x - slider_width - 4.0f,
+                                     region.y));
+  if (ImGui::BeginTable(inputs ? "##with_inputs" : "##results",
+                        kColumnCount - first_column, kTableFlags)) {
+    for (int column = first_column; column < kColumnCount; column++)
+      ImGui::TableSetupColumn(kColumnNames[column], ImGuiTableColumnFlags_None,
+                              0.0f, static_cast<ImGuiID>(column));
+
+    if (ImGuiTableSortSpecs *specs = ImGui::TableGetSortSpecs();
+        specs && specs->SpecsDirty) {
+      const int column =
+          (specs->SpecsCount > 0)
+              ? static_cast<int>(specs->Specs[0].ColumnUserID)
+              : -1;
+      const bool descending =
+          specs->SpecsCount > 0 &&
+          specs->Specs[0].SortDirection == ImGuiSortDirection_Descending;
+      specs->SpecsDirty = false;
+      if (column != sort_column_ || descending != descending_) {
+        sort_column_ = column;
+        descending_ = descending;
+        RebuildIndex();
+      }
+    }
+    ImGui::TableHeadersRow();
+
+    const ResultTable &table = *table_;
+    const std::size_t end = std::min(first_row_ + page, count);
+    for (std::size_t i = first_row_; i < end; i++) {
+      const std::uint32_t row = order_[i];
+      ImGui::TableNextRow(0, row_height);
+      for (int column = first_column; column < kColumnFlags; column++) {
+        ImGui::TableNextColumn();
+        ImGui::Text(column < kColumnEta ? "%.3f" : "%.2f",
+                    Values(table, column)[row]);
+      }
+      ImGui::TableNextColumn();
+      ImGui::Text("%d", static_cast<int>(table.results.error_flag[row]));
+    }
+    ImGui::EndTable();
+  }
+  ImGui::EndChild();
+
+  // Reversed range, so that the first row is at the top
+  ImGui::SameLine();
+  std::uint64_t position = first_row_;
+  const std::uint64_t top = 0;
+  const std::uint64_t bottom = last_first;
+  if (ImGui::VSliderScalar("##position", ImVec2(slider_width, region.y),
+                           ImGuiDataType_U64, &position, &bottom, &top, "",
+                           ImGuiSliderFlags_NoInput))
+    first_row_ = static_cast<std::size_t>(position);
+}
+
+}  // namespace visco
+
+}  // namespace spauly
@@ -0,0 +1,188 @@
+// Visco Correct Desktop - Correction factors for centrifugal pumps
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Visco-Correct-Desktop>
+#include "spauly/visco/solver_view.h"
+
+#include <imgui.h>
+
+#include "spauly/visco/batch/unit_conversion.h"
+
+namespace spauly {
+namespace visco {
+
+namespace {
+
+constexpr const char *kVariableNames[] = {"Q - Flowrate", "H - Total head",
+                                          "v - Viscosity", "Density"};
+constexpr const char *kFactorNames[] = {"eta",   "q",     "h 0.6",
+                                        "h 0.8", "h 1.0", "h 1.2"};
+
+}  // namespace
+
+SolverView::SolverView() {
+  query_.params.flowrate = 300.0;
+  query_.params.total_head = 50.0;
+  query_.params.viscosity = 500.0;
+  query_.params.density = 1000.0;
+  DefaultRange();
+  result_ = solver_.Solve(query_);
+}
+
+void SolverView::DefaultRange() {
+  // The chart limits are canonical, the query is in its own units
+  const batch::UnitScale scale = batch::GetUnitScale(query_.units);
+  switch (query_.variable) {
+    case batch::kStudyFlowrate:
+      query_.lower = batch::kMinFlowrate / scale.flowrate;
+      query_.upper = batch::kMaxFlowrate / scale.flowrate;
+      break;
+    case batch::kStudyTotalHead:
+      query_.lower = batch::kMinTotalHead / scale.total_head;
+      query_.upper = batch::kMaxTotalHead / scale.total_head;
+      break;
+    case batch::kStudyDensity:
+      query_.lower = 500.0 / scale.density;
+      query_.upper = 2000.0 / scale.density;
+      break;
+    default: {
+      // Dynamic viscosities are the kinematic limits times the density
+      double factor = 1.0 / scale.viscosity;
+      if (scale.dynamic_viscosity && query_.params.density > 0.0)
+        factor *= query_.params.density * scale.density;
+      query_.lower = batch::kMinViscosity * factor;
+      query_.upper = batch::kMaxViscosity * factor;
+      break;
+    }
+  }
+}
+
+void SolverView::OnUIRender(const ImGuiWindowFlags &flags) {
+  ImGui::SetNextWindowSize(ImVec2(445.0f, 420.0f), ImGuiCond_FirstUseEver);
+  if (!ImGui::Begin("Reverse solver", nullptr, flags)) {
+    ImGui::End();
+    return;
+  }
+
+  bool changed = false;
+  vccore::Parameters &params = query_.params;
+  vccore::Units &units = query_.units;
+
+  ImGui::SeparatorText("Fixed inputs");
+  ImGui::PushItemWidth(120.0f);
+  if (query_.variable != batch::kStudyFlowrate) {
+    changed |= ImGui::InputDouble("Q - Flowrate", &params.flowrate, 0.0, 0.0,
+                                  "%.3f");
+  }
+  if (query_.variable != batch::kStudyTotalHead) {
+    changed |= ImGui::InputDouble("H - Total head", &params.total_head, 0.0,
+                                  0.0, "%.3f");
+  }
+  if (query_.variable != batch::kStudyViscosity) {
+    changed |= ImGui::InputDouble("v - Viscosity", &params.viscosity, 0.0,
+                                  0.0, "%.3f");
+  }
+  if (query_.variable != batch::kStudyDensity) {
+    changed |=
+        ImGui::InputDouble("Density", &params.density, 0.0, 0.0, "%.3f");
+  }
+  ImGui::PopItemWidth();
+
+  ImGui::PushItemWidth(80.0f);
+  bool units_changed = false;
+  units_changed |= ImGui::Combo("##flowunit",
+                                reinterpret_cast<int *>(&units.flowrate),
+                                "m^3/h\0l/min\0GPM\0\0");
+  ImGui::SameLine();
+  units_changed |= ImGui::Combo("##totalhunit",
+                                reinterpret_cast<int *>(&units.total_head),
+                                "m\0ft\0\0");
+  ImGui::SameLine();
+  units_changed |= ImGui::Combo("##viscounit",
+                                reinterpret_cast<int *>(&units.viscosity),
+                                "mm^2/h\0cSt\0cP\0mPas\0\0");
+  ImGui::SameLine();
+  units_changed |= ImGui::Combo("##Densityunit",
+                                reinterpret_cast<int *>(&units.density),
+                                "g/l\0kg/m^3\0\0");
+  ImGui::PopItemWidth();
+  // The interval is in the units of the variable
+  if (units_changed) {
+    DefaultRange();
+    changed = true;
+  }
+
+  ImGui::SeparatorText("Query");
+  ImGui::PushItemWidth(120.0f);
+  int variable = static_cast<int>(query_.variable);
+  if (ImGui::Combo("Solve for", &variable, "Q - Flowrate\0H - Total head\0"
+                   "v - Viscosity\0Density\0\0")) {
+    query_.variable = static_cast<batch::StudyField>(variable);
+    DefaultRange();
+    changed = true;
+  }
+  changed |= ImGui::Combo("Factor", reinterpret_cast<int *>(&query_.factor),
+                          "eta\0q\0h 0.6\0h 0.8\0h 1.0\0h 1.2\0\0");
+  changed |= ImGui::InputDouble("Target", &query_.target, 0.01, 0.1, "%.4f");
+  changed |= ImGui::InputDouble("From", &query_.lower, 0.0, 0.0, "%.3f");
+  changed |= ImGui::InputDouble("To", &query_.upper, 0.0, 0.0, "%.3f");
+  ImGui::PopItemWidth();
+  if (ImGui::RadioButton("Highest", query_.highest)) {
+    query_.highest = true;
+    changed = true;
+  }
+  ImGui::SameLine();
+  if (ImGui::RadioButton("Lowest", !query_.highest)) {
+    query_.highest = false;
+    changed = true;
+  }
+
+  if (changed) result_ = solver_.Solve(query_);
+
+  ImGui::SeparatorText("Result");
+  ShowResult();
+
+  ImGui::End();
+}
+
+void SolverView::ShowResult() {
+  const char *variable = kVariableNames[query_.variable];
+  const char *factor = kFactorNames[query_.factor];
+  switch (result_.status) {
+    case batch::SolverResult::kSolved:
+      ImGui::Text("%s = %.4f", variable, result_.value);
+      ImGui::Text("%s = %.4f after %zu calculations", factor,
+                  batch::FactorValue(result_.factors, query_.factor),
+                  result_.evaluations);
+      break;
+    case batch::SolverResult::kNoCrossing:
+      ImGui::TextWrapped("%s does not reach %.4f for %s between %.3f and "
+                         "%.3f.",
+                         factor, query_.target, variable, query_.lower,
+                         query_.upper);
+      break;
+    case batch::SolverResult::kOutOfRange:
+      ImGui::TextWrapped("The inputs are outside of the chart.");
+      break;
+    default:
+      ImGui::TextWrapped("The search interval is empty.");
+      break;
+  }
+}
+
+}  // namespace visco
+
+}  // namespace spauly
@@ -0,0 +1,254 @@
+// Visco Correct Desktop - Correction factors for centrifugal pumps
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Visco-Correct-Desktop>
+#include "spauly/visco/study_view.h"
+
+#include <imgui.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+
+namespace spauly {
+namespace visco {
+
+StudyView::StudyView(utils::JobSystem &jobs, utils::FrameScheduler &scheduler)
+    : jobs_(jobs), scheduler_(scheduler) {
+  // This pump at 5 flowrates and 200 viscosities
+  axes_[batch::kStudyFlowrate] = {kLinear, 100.0, 500.0, 5};
+  axes_[batch::kStudyTotalHead] = {kFixed, 50.0, 50.0, 1};
+  axes_[batch::kStudyViscosity] = {kLog, 10.0, 4000.0, 200};
+  axes_[batch::kStudyDensity] = {kFixed, 1000.0, 1000.0, 1};
+}
+
+// The queued block loops keep the study alive, without the cancel they would
+// compute it to the end
+StudyView::~StudyView() {
+  if (study_) study_->Cancel();
+}
+
+batch::ParameterAxis StudyView::MakeAxis(const AxisInput &input) {
+  const auto steps = static_cast<std::size_t>(std::max(input.steps, 1));
+  switch (input.mode) {
+    case kLinear:
+      return batch::ParameterAxis::Linear(input.first, input.last, steps);
+    case kLog:
+      return batch::ParameterAxis::Log(input.first, input.last, steps);
+    case kList: {
+      // Numbers separated by anything strtod does not read
+      batch::ParameterAxis axis;
+      const char *begin = input.list;
+      while (*begin != '\0') {
+        char *end = nullptr;
+        const double value = std::strtod(begin, &end);
+        if (end != begin) {
+          axis.values.push_back(value);
+          begin = end;
+        } else {
+          begin++;
+        }
+      }
+      return axis;
+    }
+    default:
+      return batch::ParameterAxis::Fixed(input.first);
+  }
+}
+
+void StudyView::AxisEditor(const char *label, AxisInput &input) {
+  ImGui::PushID(label);
+  ImGui::TextUnformatted(label);
+  ImGui::SameLine(120.0f);
+  ImGui::SetNextItemWidth(80.0f);
+  ImGui::Combo("##mode", &input.mode, "Fixed\0Linear\0Log\0List\0\0");
+
+  ImGui::SameLine();
+  ImGui::PushItemWidth(70.0f);
+  if (input.mode == kList) {
+    ImGui::SetNextItemWidth(-1.0f);
+    ImGui::InputText("##list", input.list, sizeof(input.list));
+  } else if (input.mode == kFixed) {
+    ImGui::InputDouble("##value", &input.first, 0.0, 0.0, "%.3f");
+  } else {
+    ImGui::InputDouble("##first", &input.first, 0.0, 0.0, "%.3f");
+    ImGui::SameLine();
+    ImGui::InputDouble("##last", &input.last, 0.0, 0.0, "%.3f");
+    ImGui::SameLine();
+    ImGui::InputInt("steps", &input.steps, 0, 0);
+  }
+  ImGui::PopItemWidth();
+  ImGui::PopID();
+}
+
+void StudyView::Run() {
+  batch::StudyDefinition definition;
+  for (std::size_t i = 0; i < axes_.size(); i++)
+    definition.axes[i] = MakeAxis(axes_[i]);
+  definition.units = units_;
+
+  if (definition.rows() == 0) {
+    status_ = "Every parameter needs at least one value";
+    return;
+  }
+  if (definition.rows() > batch::ParametricStudy::kMaxRows) {
+    status_ = "Too many rows, use the CLI for studies of this size";
+    return;
+  }
+
+  // Runs on the pool of the job system, so the blocks share its workers
+  if (study_) study_->Cancel();
+  study_ = std::make_shared<batch::ParametricStudy>(std::move(definition),
+                                                    jobs_.pool());
+  // Starts with the first page of the table
+  study_->Request(0, 64);
+  study_->Start();
+  status_ = "";
+}
+
+void StudyView::Export(bool binary) {
+  if (!study_ || (export_job_.valid() && !export_job_.done())) return;
+
+  status_ = "Exporting...";
+  std::shared_ptr<batch::ParametricStudy> study = study_;
+  auto ok = std::make_shared<bool>(false);
+  export_job_ = jobs_.Submit(
+      [study, binary, ok](utils::Job &) {
+        *ok = binary ? study->ExportDataset("study_inputs.vcdb",
+                                            "study_results.vcdb")
+                     : study->ExportCsv("study.csv");
+      },
+      [this, binary, ok](utils::JobStatus) {
+        export_job_.reset();
+        if (!*ok)
+          status_ = "Export failed";
+        else
+          status_ = binary ? "Written to study_inputs.vcdb and "
+                             "study_results.vcdb"
+                           : "Written to study.csv";
+      });
+}
+
+void StudyView::OnUIRender(const ImGuiWindowFlags &flags) {
+  ImGui::SetNextWindowSize(ImVec2(640.0f, 650.0f), ImGuiCond_FirstUseEver);
+  if (!ImGui::Begin("Parametric study", nullptr, flags)) {
+    ImGui::End();
+    return;
+  }
+
+  AxisEditor("Q - Flowrate", axes_[batch::kStudyFlowrate]);
+  AxisEditor("H - Total head", axes_[batch::kStudyTotalHead]);
+  AxisEditor("v - Viscosity", axes_[batch::kStudyViscosity]);
+  AxisEditor("Density", axes_[batch::kStudyDensity]);
+
+  ImGui::PushItemWidth(80.0f);
+  ImGui::Combo("##flowunit", reinterpret_cast<int *>(&units_.flowrate),
+               "m^3/h\0l/min\0GPM\0\0");
+  ImGui::SameLine();
+  ImGui::Combo("##totalhunit", reinterpret_cast<int *>(&units_.total_head),
+               "m\0ft\0\0");
+  ImGui::SameLine();
+  ImGui::Combo("##viscounit", reinterpret_cast<int *>(&units_.viscosity),
+               "mm^2/h\0cSt\0cP\0mPas\0\0");
+  ImGui::SameLine();
+  ImGui::Combo("##Densityunit", reinterpret_cast<int *>(&units_.density),
+               "g/l\0kg/m^3\0\0");
+  ImGui::PopItemWidth();
+
+  if (ImGui::Button("Run", ImVec2(100, 0))) Run();
+  if (study_) {
+    ImGui::SameLine();
+    if (ImGui::Button("Export CSV")) Export(false);
+    ImGui::SameLine();
+    if (ImGui::Button("Export binary")) Export(true);
+  }
+  if (*status_ != '\0') ImGui::TextUnformatted(status_);
+
+  if (study_) {
+    const float progress =
+        static_cast<float>(study_->rows_done()) /
+        static_cast<float>(std::max<std::uint64_t>(study_->rows(), 1));
+    ImGui::ProgressBar(progress, ImVec2(-1.0f, 0.0f));
+    ResultsTable();
+
+    // Fill the table as the rows arrive
+    if (!study_->done())
+      scheduler_.RequestFrameAt(utils::FrameScheduler::Clock::now() +
+                                std::chrono::milliseconds(33));
+  }
+
+  ImGui::End();
+}
+
+void StudyView::ResultsTable() {
+  constexpr ImGuiTableFlags kTableFlags =
+      ImGuiTableFlags_ScrollY | ImGuiTableFlags_RowBg |
+      ImGuiTableFlags_Borders | ImGuiTableFlags_Resizable;
+  constexpr const char *kColumns[] = {"Q",     "H",     "v",     "rho",
+                                      "eta",   "q",     "h 0.6", "h 0.8",
+                                      "h 1.0", "h 1.2", "flags"};
+
+  if (!ImGui::BeginTable("##study", static_cast<int>(std::size(kColumns)),
+                         kTableFlags))
+    return;
+
+  ImGui::TableSetupScrollFreeze(0, 1);
+  for (const char *column : kColumns) ImGui::TableSetupColumn(column);
+  ImGui::TableHeadersRow();
+
+  std::uint64_t first_visible = study_->rows();
+  std::uint64_t last_visible = 0;
+
+  ImGuiListClipper clipper;
+  clipper.Begin(static_cast<int>(study_->rows()));
+  while (clipper.Step()) {
+    first_visible = std::min<std::uint64_t>(first_visible,
+                                            clipper.DisplayStart);
+    last_visible = std::max<std::uint64_t>(last_visible, clipper.DisplayEnd);
+
+    for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; row++) {
+      vccore::Parameters params;
+      vccore::CorrectionFactors factors;
+      const bool ready = study_->Get(row, params, factors);
+
+      ImGui::TableNextRow();
+      for (double value : {params.flowrate, params.total_head,
+                           params.viscosity, params.density}) {
+        ImGui::TableNextColumn();
+        ImGui::Text("%.3f", value);
+      }
+      if (!ready) {
+        ImGui::TableNextColumn();
+        ImGui::TextDisabled("...");
+        continue;
+      }
+      for (double value : {factors.eta, factors.q, factors.h.at(0),
+                           factors.h.at(1), factors.h.at(2), factors.h.at(3)}) {
+        ImGui::TableNextColumn();
+        ImGui::Text("%.2f", value);
+      }
+      ImGui::TableNextColumn();
+      ImGui::Text("%d", static_cast<int>(factors.error_flag));
+    }
+  }
+  ImGui::EndTable();
+
+  study_->Request(first_visible, last_visible);
+}
+
+}  // namespace visco
+
+}  // namespace spauly
@@ -0,0 +1,168 @@
+// Visco Correct Desktop - Correction factors for centrifugal pumps
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Visco-Correct-Desktop>
+#include "spauly/visco/utils/allocation_counter.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+namespace spauly {
+namespace visco {
+namespace utils {
+
+namespace {
+
+std::atomic<std::uint64_t> g_allocations = 0;
+std::atomic<std::int64_t> g_bytes = 0;
+thread_local std::uint64_t t_allocations = 0;
+
+// The size is stored in front of every block so that unsized deletes can
+// subtract it again. The header keeps the alignment of the block.
+constexpr std::size_t kHeader = alignof(std::max_align_t);
+
+void *Allocate(std::size_t size, std::size_t alignment, bool nothrow) {
+  const std::size_t header = alignment > kHeader ? alignment : kHeader;
+  void *raw = nullptr;
+#ifdef _WIN32
+  raw = ::_aligned_malloc(size + header, header);
+#else
+  if (header == kHeader)
+    raw = std::malloc(size + header);
+  else if (::posix_memalign(&raw, header, size + header) != 0)
+    raw = nullptr;
+#endif
+  if (!raw) {
+    if (nothrow) return nullptr;
+    throw std::bad_alloc();
+  }
+
+  g_allocations.fetch_add(1, std::memory_order_relaxed);
+  g_bytes.fetch_add(static_cast<std::int64_t>(size),
+                    std::memory_order_relaxed);
+  t_allocations++;
+
+  auto *block = static_cast<unsigned char *>(raw) + header;
+  reinterpret_cast<std::size_t *>(block)[-1] = size;
+  reinterpret_cast<std::size_t *>(block)[-2] = header;
+  return block;
+}
+
+void Free(void *pointer) {
+  if (!pointer) return;
+  auto *block = static_cast<unsigned char *>(pointer);
+  const std::size_t size = reinterpret_cast<std::size_t *>(block)[-1];
+  const std::size_t header = reinterpret_cast<std::size_t *>(block)[-2];
+  g_bytes.fetch_sub(static_cast<std::int64_t>(size),
+                    std::memory_order_relaxed);
+#ifdef _WIN32
+  ::_aligned_free(block - header);
+#else
+  std::free(block - header);
+#endif
+}
+
+}  // namespace
+
+std::uint64_t AllocationCount() {
+  return g_allocations.load(std::memory_order_relaxed);
+}
+
+std::uint64_t ThreadAllocationCount() { return t_allocations; }
+
+std::uint64_t AllocatedBytes() {
+  const std::int64_t bytes = g_bytes.load(std::memory_order_relaxed);
+  return bytes > 0 ? static_cast<std::uint64_t>(bytes) : 0;
+}
+
+void *CountedAlloc(std::size_t size, void *) {
+  return Allocate(size, alignof(std::max_align_t), true);
+}
+
+void CountedFree(void *pointer, void *) { Free(pointer); }
+
+}  // namespace utils
+
+}  // namespace visco
+
+}  // namespace spauly
+
+using spauly::visco::utils::Allocate;
+using spauly::visco::utils::Free;
+
+void *operator new(std::size_t size) {
+  return Allocate(size, alignof(std::max_align_t), false);
+}
+void *operator new[](std::size_t size) {
+  return Allocate(size, alignof(std::max_align_t), false);
+}
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept {
+  return Allocate(size, alignof(std::max_align_t), true);
+}
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept {
+  return Allocate(size, alignof(std::max_align_t), true);
+}
+void *operator new(std::size_t size, std::align_val_t alignment) {
+  return Allocate(size, static_cast<std::size_t>(alignment), false);
+}
+void *operator new[](std::size_t size, std::align_val_t alignment) {
+  return Allocate(size, static_cast<std::size_t>(alignment), false);
+}
+void *operator new(std::size_t size, std::align_val_t alignment,
+                   const std::nothrow_t &) noexcept {
+  return Allocate(size, static_cast<std::size_t>(alignment), true);
+}
+void *operator new[](std::size_t size, std::align_val_t alignment,
+                     const std::nothrow_t &) noexcept {
+  return Allocate(size, static_cast<std::size_t>(alignment), true);
+}
+
+void operator delete(void *pointer) noexcept { Free(pointer); }
+void operator delete[](void *pointer) noexcept { Free(pointer); }
+void operator delete(void *pointer, std::size_t) noexcept { Free(pointer); }
+void operator delete[](void *pointer, std::size_t) noexcept { Free(pointer); }
+void operator delete(void *pointer, const std::nothrow_t &) noexcept {
+  Free(pointer);
+}
+void operator delete[](void *pointer, const std::nothrow_t &) noexcept {
+  Free(pointer);
+}
+void operator delete(void *pointer, std::align_val_t) noexcept {
+  Free(pointer);
+}
+void operator delete[](void *pointer, std::align_val_t) noexcept {
+  Free(pointer);
+}
+void operator delete(void *pointer, std::size_t, std::align_val_t) noexcept {
+  Free(pointer);
+}
+void operator delete[](void *pointer, std::size_t, std::align_val_t) noexcept {
+  Free(pointer);
+}
+void operator delete(void *pointer, std::align_val_t,
+                     const std::nothrow_t &) noexcept {
+  Free(pointer);
+}
+void operator delete[](void *pointer, std::align_val_t,
+                       const std::nothrow_t &) noexcept {
+  Free(pointer);
+}
@@ -0,0 +1,112 @@
+// Visco Correct Desktop - Correction factors for centrifugal pumps
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Visco-Correct-Desktop>
+#include "spauly/visco/utils/frame_arena.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+
+namespace spauly {
+namespace visco {
+namespace utils {
+
+namespace {
+
+std::size_t AlignUp(std::size_t value, std::size_t alignment) {
+  return (value + alignment - 1) & ~(alignment - 1);
+}
+
+}  // namespace
+
+FrameArena::FrameArena(std::size_t capacity)
+    : block_(NewBlock(capacity)), capacity_(capacity) {
+  overflow_.reserve(8);
+}
+
+FrameArena::Block FrameArena::NewBlock(std::size_t size) {
+  return Block(static_cast<std::byte *>(
+      ::operator new(size, std::align_val_t{kBlockAlignment})));
+}
+
+void *FrameArena::Allocate(std::size_t size, std::size_t alignment) {
+  const std::size_t offset = AlignUp(used_, alignment);
+  if (offset + size <= capacity_ && alignment <= kBlockAlignment) {
+    used_ = offset + size;
+    return block_.get() + offset;
+  }
+
+  // Every overflow gets its own block, the next Reset() grows block_ so that
+  // the frame fits
+  const std::size_t block_alignment = std::max(alignment, kBlockAlignment);
+  overflow_.push_back(Block(static_cast<std::byte *>(::operator new(
+      size == 0 ? 1 : size, std::align_val_t{block_alignment}))));
+  overflow_used_ += size;
+  growths_++;
+  return overflow_.back().get();
+}
+
+const char *FrameArena::Format(const char *format, ...) {
+  std::va_list args;
+  va_start(args, format);
+  std::va_list retry;
+  va_copy(retry, args);
+
+  // Printed into the rest of the block first, so most strings are formatted
+  // only once
+  const std::size_t available = capacity_ - std::min(capacity_, used_);
+  char *text = reinterpret_cast<char *>(block_.get() + used_);
+  const int length = std::vsnprintf(available > 0 ? text : nullptr, available,
+                                     format, args);
+  va_end(args);
+
+  if (length < 0) {
+    va_end(retry);
+    return "";
+  }
+  const std::size_t size = static_cast<std::size_t>(length) + 1;
+  if (size <= available) {
+    used_ += size;
+  } else {
+    text = static_cast<char *>(Allocate(size, 1));
+    std::vsnprintf(text, size, format, retry);
+  }
+  va_end(retry);
+  return text;
+}
+
+void FrameArena::Reset() {
+  peak_ = std::max(peak_, used());
+  if (!overflow_.empty()) {
+    // Aligned padding of the overflows is not counted, the next power of two
+    // leaves room for it
+    capacity_ = std::bit_ceil(used_ + overflow_used_ + overflow_.size() * 64);
+    block_ = NewBlock(capacity_);
+    overflow_.clear();
+    growths_++;
+  }
+  used_ = 0;
+  overflow_used_ = 0;
+}
+
+}  // namespace utils
+
+}  // namespace visco
+
+}  // namespace spauly
@@ -0,0 +1,82 @@
+// Visco Correct Desktop - Correction factors for centrifugal pumps
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Visco-Correct-Desktop>
+#include "spauly/visco/utils/job_system.h"
+
+#include <thread>
+
+namespace spauly {
+namespace visco {
+namespace utils {
+
+JobSystem::JobSystem(std::size_t thread_count)
+    : completed_(kQueueCapacity), pool_(thread_count) {}
+
+JobSystem::~JobSystem() {
+  // Queued and running jobs see themselves cancelled, the pool then drains
+  // them quickly. Their completions are dropped.
+  shutdown_.store(true, std::memory_order_relaxed);
+}
+
+JobHandle JobSystem::Submit(Work work, Completion on_complete) {
+  auto job = std::make_shared<Job>();
+  job->work_ = std::move(work);
+  job->on_complete_ = std::move(on_complete);
+  job->shutdown_ = &shutdown_;
+
+  pending_.fetch_add(1, std::memory_order_relaxed);
+  pool_.Submit([this, job](std::size_t) { Run(job); });
+  return JobHandle(job);
+}
+
+void JobSystem::Run(const std::shared_ptr<Job> &job) {
+  if (!job->cancelled()) {
+    job->status_.store(JobStatus::kRunning, std::memory_order_release);
+    job->work_(*job);
+  }
+  job->work_ = nullptr;
+  job->status_.store(
+      job->cancelled() ? JobStatus::kCancelled : JobStatus::kFinished,
+      std::memory_order_release);
+
+  // The UI drains the queue every frame, a full queue only lasts a frame
+  std::shared_ptr<Job> completed = job;
+  while (!completed_.TryPush(completed)) {
+    if (shutdown_.load(std::memory_order_relaxed)) return;
+    std::this_thread::yield();
+  }
+  if (wake_) wake_();
+}
+
+std::size_t JobSystem::Poll() {
+  std::size_t count = 0;
+  std::shared_ptr<Job> job;
+  while (completed_.TryPop(job)) {
+    pending_.fetch_sub(1, std::memory_order_relaxed);
+    if (job->on_complete_) job->on_complete_(job->status());
+    job->on_complete_ = nullptr;
+    job.reset();
+    count++;
+  }
+  return count;
+}
+
+}  // namespace utils
+
+}  // namespace visco
+
+}  // namespace spauly
@@ -0,0 +1,138 @@
+// Visco Correct Desktop - Correction factors for centrifugal pumps
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Visco-Correct-Desktop>
+#include "spauly/visco/utils/layerstack.h"
+
+#include <utility>
+
+namespace spauly {
+namespace visco {
+namespace utils {
+
+namespace {
+
+// Gaps are closed once they make up a quarter of the render order, which
+// keeps popping O(1) amortized
+constexpr std::size_t kGapRatio = 4;
+
+}  // namespace
+
+LayerHandle LayerStack::PushLayer(std::shared_ptr<Layer> layer) {
+  overlay_begin_++;
+  return Insert(std::move(layer), overlay_begin_ - 1);
+}
+
+LayerHandle LayerStack::PushOverlay(std::shared_ptr<Layer> overlay) {
+  return Insert(std::move(overlay), order_.size());
+}
+
+LayerHandle LayerStack::Insert(std::shared_ptr<Layer> layer,
+                               std::size_t position) {
+  std::uint32_t index = 0;
+  if (free_slots_.empty()) {
+    index = static_cast<std::uint32_t>(slots_.size());
+    slots_.emplace_back();
+  } else {
+    index = free_slots_.back();
+    free_slots_.pop_back();
+  }
+
+  Slot &slot = slots_[index];
+  slot.layer = std::move(layer);
+  Layer *raw = slot.layer.get();
+  const LayerHandle handle{index, slot.generation};
+
+  // Only the overlays behind the new entry move
+  order_.insert(order_.begin() + position, Entry{raw, index, true});
+  for (std::size_t i = position; i < order_.size(); i++)
+    if (order_[i].layer)
+      slots_[order_[i].slot].position = static_cast<std::uint32_t>(i);
+
+  raw->frame_arena_ = &frame_arena_;
+  raw->event_bus_ = &event_bus_;
+  raw->OnAttach();
+  return handle;
+}
+
+bool LayerStack::PopLayer(LayerHandle handle) {
+  Slot *slot = Find(handle);
+  if (!slot) return false;
+
+  // The entry stays as a gap so the positions of the others remain valid
+  Entry &entry = order_[slot->position];
+  entry.layer = nullptr;
+  entry.visible = false;
+  gaps_++;
+
+  std::shared_ptr<Layer> layer = std::move(slot->layer);
+  if (++slot->generation == 0) slot->generation = 1;
+  free_slots_.push_back(handle.index);
+
+  layer->OnDetach();
+  return true;
+}
+
+bool LayerStack::SetVisible(LayerHandle handle, bool visible) {
+  Slot *slot = Find(handle);
+  if (!slot) return false;
+  order_[slot->position].visible = visible;
+  return true;
+}
+
+void LayerStack::EndFrame() {
+  frame_arena_.Reset();
+  if (gaps_ == 0 || gaps_ * kGapRatio < order_.size()) return;
+
+  std::size_t count = 0;
+  std::size_t overlay_begin = 0;
+  for (std::size_t i = 0; i < order_.size(); i++) {
+    if (i == overlay_begin_) overlay_begin = count;
+    if (!order_[i].layer) continue;
+    order_[count] = order_[i];
+    slots_[order_[count].slot].position = static_cast<std::uint32_t>(count);
+    count++;
+  }
+  if (overlay_begin_ == order_.size()) overlay_begin = count;
+
+  order_.resize(count);
+  overlay_begin_ = overlay_begin;
+  gaps_ = 0;
+}
+
+void LayerStack::clear() {
+  for (const Entry &entry : order_)
+    if (entry.layer) entry.layer->OnDetach();
+  order_.clear();
+  overlay_begin_ = 0;
+  gaps_ = 0;
+
+  free_slots_.clear();
+  for (std::size_t i = slots_.size(); i-- > 0;) {
+    Slot &slot = slots_[i];
+    if (slot.layer) {
+      slot.layer.reset();
+      if (++slot.generation == 0) slot.generation = 1;
+    }
+    free_slots_.push_back(static_cast<std::uint32_t>(i));
+  }
+}
+
+}  // namespace utils
+
+}  // namespace visco
+
+}  // namespace spauly
@@ -0,0 +1,169 @@
+// Visco Correct Desktop - Correction factors for centrifugal pumps
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Visco-Correct-Desktop>
+#include "spauly/visco/utils/profiler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+
+#include "spauly/visco/utils/allocation_counter.h"
+
+namespace spauly {
+namespace visco {
+namespace utils {
+
+namespace {
+
+// Small sequential ids read better in trace viewers than native thread ids
+std::uint32_t ThreadIndex() {
+  static std::atomic<std::uint32_t> next_index = 0;
+  thread_local const std::uint32_t index = next_index++;
+  return index;
+}
+
+}  // namespace
+
+Profiler &Profiler::Get() {
+  static Profiler profiler;
+  return profiler;
+}
+
+Profiler::Profiler() { trace_.reserve(kTraceCapacity); }
+
+Profiler::Scope &Profiler::FindScope(const char *name) {
+  // Identical literals from different translation units may differ in their
+  // address, so fall back to comparing the text
+  for (auto &scope : scopes_)
+    if (scope.name == name) return scope;
+  for (auto &scope : scopes_)
+    if (std::strcmp(scope.name, name) == 0) return scope;
+
+  scopes_.push_back({});
+  scopes_.back().name = name;
+  return scopes_.back();
+}
+
+void Profiler::Record(const char *name, Clock::time_point start,
+                      Clock::time_point end) {
+  using std::chrono::duration_cast;
+  using std::chrono::microseconds;
+
+  const std::uint32_t thread = ThreadIndex();
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  FindScope(name).current +=
+      std::chrono::duration<double, std::milli>(end - start).count();
+
+  // Scopes may start before the profiler is constructed, so the timestamps
+  // are relative to the clock epoch
+  Event event = {name,
+                 duration_cast<microseconds>(start.time_since_epoch()).count(),
+                 duration_cast<microseconds>(end - start).count(), thread};
+  if (trace_.size() < kTraceCapacity) {
+    trace_.push_back(event);
+  } else {
+    trace_[trace_next_] = event;
+    trace_next_ = (trace_next_ + 1) % kTraceCapacity;
+  }
+}
+
+void Profiler::EndFrame() {
+  const std::uint64_t allocations = ThreadAllocationCount();
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  const std::size_t slot = frame_count_ % kWindowFrames;
+  for (auto &scope : scopes_) {
+    scope.window[slot] = static_cast<float>(scope.current);
+    scope.current = 0.0;
+  }
+  allocations_[slot] = allocations - allocation_count_;
+  allocation_count_ = allocations;
+  frame_count_++;
+}
+
+Profiler::AllocationStats Profiler::allocation_stats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  AllocationStats stats;
+  if (frame_count_ == 0) return stats;
+  stats.last = allocations_[(frame_count_ - 1) % kWindowFrames];
+  stats.max = *std::max_element(allocations_.begin(), allocations_.end());
+  stats.total = allocation_count_;
+  return stats;
+}
+
+void Profiler::CollectStats(std::pmr::vector<ScopeStats> &stats) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  const std::size_t frames =
+      std::min<std::uint64_t>(frame_count_, kWindowFrames);
+  stats.clear();
+  if (frames == 0) return;
+  stats.reserve(scopes_.size());
+
+  std::array<float, kWindowFrames> sorted;
+  auto percentile = [&](double p) {
+    return static_cast<double>(
+        sorted[static_cast<std::size_t>(p * (frames - 1) + 0.5)]);
+  };
+
+  const std::size_t last = (frame_count_ - 1) % kWindowFrames;
+  for (const auto &scope : scopes_) {
+    std::copy_n(scope.window.begin(), frames, sorted.begin());
+    std::sort(sorted.begin(), sorted.begin() + frames);
+
+    ScopeStats scope_stats;
+    scope_stats.name = scope.name;
+    scope_stats.p50 = percentile(0.50);
+    scope_stats.p95 = percentile(0.95);
+    scope_stats.p99 = percentile(0.99);
+    scope_stats.max = sorted[frames - 1];
+    scope_stats.last = scope.window[last];
+    stats.push_back(scope_stats);
+  }
+}
+
+bool Profiler::ExportChromeTrace(const std::string &path) const {
+  std::FILE *file = std::fopen(path.c_str(), "wb");
+  if (!file) return false;
+
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  bool ok = std::fputs("{\"traceEvents\":[\n", file) >= 0;
+  // Oldest event first once the ring buffer wrapped around
+  for (std::size_t i = 0; ok && i < trace_.size(); i++) {
+    const Event &event = trace_[(trace_next_ + i) % trace_.size()];
+    ok = std::fprintf(file,
+                      "%s{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%lld,"
+                      "\"dur\":%lld,\"pid\":1,\"tid\":%u}\n",
+                      (i == 0) ? "" : ",", event.name,
+                      static_cast<long long>(event.start_us),
+                      static_cast<long long>(event.duration_us),
+                      event.thread) > 0;
+  }
+  ok = ok && std::fputs("],\"displayTimeUnit\":\"ms\"}\n", file) >= 0;
+
+  return (std::fclose(file) == 0) && ok;
+}
+
+}  // namespace utils
+
+}  // namespace visco
+
+}  // namespace spauly